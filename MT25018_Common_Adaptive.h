@@ -0,0 +1,199 @@
+/*
+ * MT25018 - Graduate Systems PA02
+ * Common: Adaptive transport selection
+ * A per-connection selector that calibrates each send path (two-copy
+ * send(), one-copy sendmsg(), zero-copy sendmsg(MSG_ZEROCOPY)) on the live
+ * connection, routes every following message through the fastest one and
+ * re-calibrates periodically. All paths produce the same byte stream, so
+ * any of the clients can receive from an adaptive server.
+ *
+ * A path's throughput is what the peer acknowledged while it was in use
+ * (SIOCOUTQ before and after its window), not what send() accepted into
+ * the socket buffer. Each path first runs an unmeasured window that
+ * absorbs the previous path's queued bytes, and every round starts with a
+ * different path, so no path is favoured by the buffer state it inherits.
+ */
+
+#ifndef MT25018_COMMON_ADAPTIVE_H
+#define MT25018_COMMON_ADAPTIVE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <linux/sockios.h>
+
+typedef enum {
+    TRANSPORT_TWOCOPY,
+    TRANSPORT_ONECOPY,
+    TRANSPORT_ZEROCOPY,
+    TRANSPORT_NUM_PATHS
+} TransportPath;
+
+static const char *transport_path_names[TRANSPORT_NUM_PATHS] = {
+    "TwoCopy",
+    "OneCopy",
+    "ZeroCopy"
+};
+
+/* Throughputs within this fraction of the best count as a tie, which is
+ * broken by the lower CPU time per byte */
+#define ADAPTIVE_TIE_FRACTION 0.02
+
+/* In steady state the clock is only read every this many messages */
+#define ADAPTIVE_CLOCK_STRIDE 64
+
+/* Result of the most recent calibration of one path */
+typedef struct {
+    double gbps;
+    double cpu_ns_per_byte;
+} AdaptiveMeasurement;
+
+typedef struct {
+    int thread_id;
+    int socket;
+    int message_size;
+    int num_paths;              /* ZeroCopy is skipped when unavailable */
+    uint64_t window_ns;         /* calibration time per path */
+    uint64_t recalibrate_ns;    /* 0 = calibrate once at startup */
+
+    int calibrating;            /* step of the round (0..num_paths-1), or -1 */
+    int measuring;              /* 0 = the step's discarded first window */
+    TransportPath current;      /* path used for the next message */
+    TransportPath chosen;       /* winner of the last calibration */
+    uint64_t window_start_ns;
+    uint64_t window_start_cpu_ns;
+    long long window_bytes;
+    int window_start_unacked;
+    uint64_t next_calibration_ns;
+    unsigned long long messages_since_check;
+
+    AdaptiveMeasurement last[TRANSPORT_NUM_PATHS];
+    long long messages[TRANSPORT_NUM_PATHS];
+    long long bytes[TRANSPORT_NUM_PATHS];
+    int calibrations;
+    int switches;
+} AdaptiveSelector;
+
+static inline uint64_t adaptive_clock_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Bytes sent but not yet acknowledged by the peer (0 if unknown) */
+static inline int adaptive_unacked(int socket) {
+    int unacked = 0;
+    if (ioctl(socket, SIOCOUTQ, &unacked) < 0) {
+        return 0;
+    }
+    return unacked;
+}
+
+/* Start a window of the given round step: the step's path rotates with
+ * the round, so each round begins with a different path */
+static inline void adaptive_start_window(AdaptiveSelector *sel, int step, int measuring) {
+    sel->calibrating = step;
+    sel->measuring = measuring;
+    sel->current = (TransportPath)((sel->calibrations + step) % sel->num_paths);
+    sel->window_bytes = 0;
+    sel->window_start_unacked = measuring ? adaptive_unacked(sel->socket) : 0;
+    sel->window_start_ns = adaptive_clock_ns(CLOCK_MONOTONIC);
+    sel->window_start_cpu_ns = adaptive_clock_ns(CLOCK_THREAD_CPUTIME_ID);
+}
+
+static inline void adaptive_init(AdaptiveSelector *sel, int thread_id, int socket,
+                                 int message_size, int zerocopy_available,
+                                 int window_ms, int recalibrate_sec) {
+    memset(sel, 0, sizeof(*sel));
+    sel->thread_id = thread_id;
+    sel->socket = socket;
+    sel->message_size = message_size;
+    sel->num_paths = zerocopy_available ? TRANSPORT_NUM_PATHS : TRANSPORT_ZEROCOPY;
+    sel->window_ns = (uint64_t)window_ms * 1000000ULL;
+    sel->recalibrate_ns = (uint64_t)recalibrate_sec * 1000000000ULL;
+    adaptive_start_window(sel, 0, 0);
+}
+
+/* Pick the winner of a finished calibration round and log the decision */
+static inline void adaptive_decide(AdaptiveSelector *sel, uint64_t now_ns) {
+    int best = 0;
+    for (int p = 1; p < sel->num_paths; p++) {
+        double best_gbps = sel->last[best].gbps;
+        double gbps = sel->last[p].gbps;
+        if (gbps > best_gbps * (1.0 + ADAPTIVE_TIE_FRACTION) ||
+            (gbps >= best_gbps * (1.0 - ADAPTIVE_TIE_FRACTION) &&
+             sel->last[p].cpu_ns_per_byte < sel->last[best].cpu_ns_per_byte)) {
+            best = p;
+        }
+    }
+
+    if (sel->calibrations > 0 && (TransportPath)best != sel->chosen) {
+        sel->switches++;
+    }
+    sel->calibrations++;
+    sel->chosen = (TransportPath)best;
+    sel->current = (TransportPath)best;
+    sel->calibrating = -1;
+    sel->next_calibration_ns = sel->recalibrate_ns ? now_ns + sel->recalibrate_ns : 0;
+
+    printf("[Thread %d] Adaptive: calibration %d at %d B ->", sel->thread_id,
+           sel->calibrations, sel->message_size);
+    for (int p = 0; p < sel->num_paths; p++) {
+        printf(" %s %.2f Gbps (%.2f cpu-ns/B)%s", transport_path_names[p],
+               sel->last[p].gbps, sel->last[p].cpu_ns_per_byte,
+               p < sel->num_paths - 1 ? "," : "");
+    }
+    printf("; using %s\n", transport_path_names[best]);
+}
+
+/* Path to use for the next message */
+static inline TransportPath adaptive_path(const AdaptiveSelector *sel) {
+    return sel->current;
+}
+
+/* Account one sent message and advance the calibration state machine */
+static inline void adaptive_account(AdaptiveSelector *sel, int bytes) {
+    sel->messages[sel->current]++;
+    sel->bytes[sel->current] += bytes;
+
+    if (sel->calibrating < 0) {
+        if (!sel->next_calibration_ns || ++sel->messages_since_check < ADAPTIVE_CLOCK_STRIDE) {
+            return;
+        }
+        sel->messages_since_check = 0;
+        if (adaptive_clock_ns(CLOCK_MONOTONIC) >= sel->next_calibration_ns) {
+            adaptive_start_window(sel, 0, 0);
+        }
+        return;
+    }
+
+    sel->window_bytes += bytes;
+    uint64_t now = adaptive_clock_ns(CLOCK_MONOTONIC);
+    uint64_t elapsed = now - sel->window_start_ns;
+    if (elapsed < sel->window_ns) {
+        return;
+    }
+    if (!sel->measuring) {
+        adaptive_start_window(sel, sel->calibrating, 1);
+        return;
+    }
+
+    /* Acknowledged during the window: what was queued at its start plus
+     * what it sent, less what is still queued */
+    long long acked = sel->window_start_unacked + sel->window_bytes -
+                      adaptive_unacked(sel->socket);
+    uint64_t cpu = adaptive_clock_ns(CLOCK_THREAD_CPUTIME_ID) - sel->window_start_cpu_ns;
+    AdaptiveMeasurement *m = &sel->last[sel->current];
+    m->gbps = acked > 0 ? (acked * 8.0) / elapsed : 0.0;
+    m->cpu_ns_per_byte = sel->window_bytes ? (double)cpu / sel->window_bytes : 0.0;
+
+    if (sel->calibrating + 1 < sel->num_paths) {
+        adaptive_start_window(sel, sel->calibrating + 1, 0);
+    } else {
+        adaptive_decide(sel, now);
+    }
+}
+
+#endif /* MT25018_COMMON_ADAPTIVE_H */
@@ -0,0 +1,161 @@
+/*
+ * MT25018 - Graduate Systems PA02
+ * Common: Connection churn benchmark
+ * In churn mode a client closes its connection after a fixed number of
+ * messages and reconnects, measuring connection rate and the time from
+ * connect() to the first byte of data. Each new connection starts with a
+ * one-byte hello so the server can use TCP_DEFER_ACCEPT and the client can
+ * carry data in the SYN with TCP_FASTOPEN.
+ */
+
+#ifndef MT25018_COMMON_CHURN_H
+#define MT25018_COMMON_CHURN_H
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include "MT25018_Common_Results.h"
+
+#ifndef MSG_FASTOPEN
+#define MSG_FASTOPEN 0x20000000
+#endif
+
+#ifndef TCPI_OPT_SYN_DATA
+#define TCPI_OPT_SYN_DATA 32
+#endif
+
+/* Pending TFO requests allowed on the listening socket */
+#define CHURN_FASTOPEN_QUEUE 256
+
+/* Seconds the kernel holds a connection in TCP_DEFER_ACCEPT */
+#define CHURN_DEFER_ACCEPT_SEC 5
+
+/* Client-side churn results */
+typedef struct {
+    long long connections;
+    long long failures;
+    long long fastopen_accepted;        /* hello carried in the SYN */
+    LatencyHistogram first_byte_ns;     /* connect() start to first data byte */
+} ChurnStats;
+
+static inline long long churn_time_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* Server: configure the listening socket (before listen()) */
+static inline void churn_configure_listener(int server_socket, int fastopen, int defer_accept) {
+    if (fastopen) {
+        int qlen = CHURN_FASTOPEN_QUEUE;
+        if (setsockopt(server_socket, IPPROTO_TCP, TCP_FASTOPEN, &qlen, sizeof(qlen)) < 0) {
+            perror("Warning: TCP_FASTOPEN failed");
+        }
+    }
+    if (defer_accept) {
+        int secs = CHURN_DEFER_ACCEPT_SEC;
+        if (setsockopt(server_socket, IPPROTO_TCP, TCP_DEFER_ACCEPT, &secs, sizeof(secs)) < 0) {
+            perror("Warning: TCP_DEFER_ACCEPT failed");
+        }
+    }
+}
+
+/* Server: consume the hello byte a churn client opens with, waiting for
+ * it if it has not arrived yet. Only for servers of churn clients: other
+ * clients never send one, and their own first byte must not be eaten.
+ */
+static inline void churn_read_hello(int client_socket) {
+    char hello;
+    (void)recv(client_socket, &hello, 1, 0);
+}
+
+/* Client: send the hello byte on an already connected socket */
+static inline int churn_send_hello(int client_socket) {
+    char hello = 'H';
+    return send(client_socket, &hello, 1, 0) == 1 ? 0 : -1;
+}
+
+/* Client: open a new connection, send the hello (in the SYN with fastopen)
+ * and wait for the first data byte without consuming it, so the caller's
+ * message framing is unaffected. Returns the socket or -1.
+ */
+static inline int churn_reconnect(const struct sockaddr_in *server_addr, int fastopen,
+                                  ChurnStats *stats) {
+    long long start = churn_time_ns();
+    char hello = 'H';
+
+    int client_socket = socket(AF_INET, SOCK_STREAM, 0);
+    if (client_socket < 0) {
+        perror("socket creation failed");
+        stats->failures++;
+        return -1;
+    }
+
+    int ok;
+    if (fastopen) {
+        ok = sendto(client_socket, &hello, 1, MSG_FASTOPEN,
+                    (const struct sockaddr *)server_addr, sizeof(*server_addr)) == 1;
+    } else {
+        ok = connect(client_socket, (const struct sockaddr *)server_addr,
+                     sizeof(*server_addr)) == 0 &&
+             send(client_socket, &hello, 1, 0) == 1;
+    }
+
+    char first;
+    if (!ok || recv(client_socket, &first, 1, MSG_PEEK) != 1) {
+        perror("churn reconnect failed");
+        close(client_socket);
+        stats->failures++;
+        return -1;
+    }
+    latency_hist_record(&stats->first_byte_ns, (uint64_t)(churn_time_ns() - start));
+    stats->connections++;
+
+    if (fastopen) {
+        struct tcp_info info;
+        socklen_t len = sizeof(info);
+        if (getsockopt(client_socket, IPPROTO_TCP, TCP_INFO, &info, &len) == 0 &&
+            (info.tcpi_options & TCPI_OPT_SYN_DATA)) {
+            stats->fastopen_accepted++;
+        }
+    }
+    return client_socket;
+}
+
+static inline void churn_print(const ChurnStats *stats, double elapsed_seconds, int fastopen) {
+    printf("\n=== Connection Churn ===\n");
+    printf("Reconnects: %lld (%.1f conn/s), failures: %lld\n",
+           stats->connections, elapsed_seconds > 0 ? stats->connections / elapsed_seconds : 0.0,
+           stats->failures);
+    if (fastopen) {
+        printf("TCP Fast Open: %lld of %lld hellos carried in the SYN\n",
+               stats->fastopen_accepted, stats->connections);
+    }
+    if (stats->first_byte_ns.samples > 0) {
+        printf("Connect-to-first-byte avg/p50/p99: %.2f / %.2f / %.2f µs\n",
+               stats->first_byte_ns.sum_ns / 1000.0 / stats->first_byte_ns.samples,
+               latency_hist_percentile(&stats->first_byte_ns, 50.0) / 1000.0,
+               latency_hist_percentile(&stats->first_byte_ns, 99.0) / 1000.0);
+    }
+}
+
+static inline void json_churn(JsonWriter *w, const char *key, const ChurnStats *stats,
+                              double elapsed_seconds, int messages_per_connection) {
+    json_begin_object(w, key);
+    json_int(w, "messages_per_connection", messages_per_connection);
+    json_int(w, "connections", stats->connections);
+    json_int(w, "failures", stats->failures);
+    json_int(w, "fastopen_accepted", stats->fastopen_accepted);
+    json_double(w, "connections_per_sec",
+                elapsed_seconds > 0 ? stats->connections / elapsed_seconds : 0.0);
+    json_latency_hist(w, "first_byte_ns", &stats->first_byte_ns);
+    json_end_object(w);
+}
+
+#endif /* MT25018_COMMON_CHURN_H */
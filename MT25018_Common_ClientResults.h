@@ -0,0 +1,121 @@
+/*
+ * MT25018 - Graduate Systems PA02
+ * Common: Result record of the TCP clients
+ * The receive loop, the fan-in engine and the request/response flow all
+ * end in the same JSON-lines record. A ClientResults names what a run
+ * has; sections left NULL are not written.
+ */
+
+#ifndef MT25018_COMMON_CLIENTRESULTS_H
+#define MT25018_COMMON_CLIENTRESULTS_H
+
+#include <stdio.h>
+
+#include "MT25018_Common_PerfCounters.h"
+#include "MT25018_Common_Results.h"
+#include "MT25018_Common_Churn.h"
+#include "MT25018_Common_Duplex.h"
+#include "MT25018_Common_Timestamping.h"
+#include "MT25018_Common_Mptcp.h"
+#include "MT25018_Common_ReqResp.h"
+#include "MT25018_Common_SteadyState.h"
+#include "MT25018_Common_RecvStrategy.h"
+#include "MT25018_Common_FanIn.h"
+
+/* Client statistics */
+typedef struct {
+    long long total_bytes_received;
+    long long total_messages_received;
+    double total_latency_us;
+    long long latency_samples;
+} ClientStats;
+
+typedef struct {
+    const char *transport;
+    const char *server_ip;
+    int message_size;
+    double elapsed_seconds;
+    const ClientStats *stats;
+    const LatencyHistogram *latency_hist;
+    const PerfSample *perf_sample;
+    const ChurnStats *churn;
+    int churn_messages;
+    const DuplexDirection *duplex_tx;           /* duplex_rx is read with it */
+    const DuplexDirection *duplex_rx;
+    const MessageReceiver *receiver;
+    const FanInConfig *fanin_config;            /* read with fanin */
+    const FanInStats *fanin;
+    const TimestampBreakdown *timestamps;
+    int warmup;
+    const SteadyState *steady;                  /* replaces the headline numbers */
+    const MptcpStats *mptcp;
+    const RrStats *rr;
+} ClientResults;
+
+/* Append the run's result record (one JSON line) to path */
+static inline void client_results_write_json(const char *path, const ClientResults *r) {
+    JsonWriter w;
+    if (json_record_open(&w, path) < 0) {
+        return;
+    }
+
+    const ClientStats *stats = r->stats;
+    json_string(&w, "role", "client");
+    json_string(&w, "transport", r->transport);
+    json_string(&w, "server_ip", r->server_ip);
+    json_int(&w, "message_size", r->message_size);
+    if (r->steady) {
+        /* Headline numbers cover only the steady window */
+        const SteadyState *steady = r->steady;
+        json_int(&w, "bytes", steady->bytes);
+        json_int(&w, "messages", steady->messages);
+        json_double(&w, "elapsed_sec", steady->elapsed_sec);
+        json_double(&w, "throughput_gbps", steady->elapsed_sec > 0 ?
+                    (steady->bytes * 8.0) / (steady->elapsed_sec * 1e9) : 0.0);
+        json_double(&w, "avg_latency_us", steady->latency.samples > 0 ?
+                    steady->latency.sum_ns / 1000.0 / steady->latency.samples : 0.0);
+        json_latency_hist(&w, "latency_ns", &steady->latency);
+        json_double(&w, "measured_sec", r->elapsed_seconds);
+        json_steady_state(&w, "steady_state", steady);
+    } else {
+        json_int(&w, "bytes", stats->total_bytes_received);
+        json_int(&w, "messages", stats->total_messages_received);
+        json_double(&w, "elapsed_sec", r->elapsed_seconds);
+        json_double(&w, "throughput_gbps",
+                    (stats->total_bytes_received * 8.0) / (r->elapsed_seconds * 1e9));
+        json_double(&w, "avg_latency_us", stats->latency_samples > 0 ?
+                    stats->total_latency_us / stats->latency_samples : 0.0);
+        json_latency_hist(&w, "latency_ns", r->latency_hist);
+    }
+    if (r->warmup > 0) {
+        json_int(&w, "warmup_sec", r->warmup);
+    }
+    if (r->perf_sample) {
+        json_perf_sample(&w, "perf", r->perf_sample, stats->total_bytes_received);
+    }
+    if (r->churn) {
+        json_churn(&w, "churn", r->churn, r->elapsed_seconds, r->churn_messages);
+    }
+    if (r->duplex_tx) {
+        json_duplex(&w, "duplex", r->duplex_tx, r->duplex_rx, r->elapsed_seconds);
+    }
+    if (r->receiver) {
+        json_receiver(&w, "receiver", r->receiver);
+    }
+    if (r->fanin) {
+        json_fanin(&w, "fanin", r->fanin_config, r->fanin);
+    }
+    if (r->timestamps) {
+        json_timestamps(&w, "timestamps", r->timestamps);
+    }
+    if (r->mptcp) {
+        json_mptcp(&w, "mptcp", r->mptcp);
+    }
+    if (r->rr) {
+        json_rr(&w, "request_response", r->rr);
+    }
+
+    json_record_close(&w);
+}
+
+#endif /* MT25018_COMMON_CLIENTRESULTS_H */
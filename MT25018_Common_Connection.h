@@ -0,0 +1,385 @@
+/*
+ * MT25018 - Graduate Systems PA02
+ * Common: Per-connection plumbing of the TCP servers
+ * Every server handler thread does the same work around its send loop:
+ * perf counters, the syscall probe, the duplex receive worker,
+ * SO_TIMESTAMPING, TCP_INFO and memory accounting, MPTCP subflows, live
+ * metrics, the event trace and the fair scheduler. A ConnectionContext
+ * holds that state, so a handler only has to pick its send path:
+ *
+ *   connection_open(&c, &config, &services, duplex_recv, &rx_args);
+ *   while (server_running) {
+ *       connection_before_send(&c, message_size, path);
+ *       int bytes_sent = send_message(...);
+ *       connection_after_send(&c, bytes_sent, path);
+ *       if (bytes_sent < 0) break;
+ *       connection_account(&c, bytes_sent);
+ *   }
+ *   connection_end(&c);
+ *   lock; connection_merge_locked(&c); unlock;
+ *   connection_close(&c);
+ *
+ * The same header writes the server's shared result record fields.
+ */
+
+#ifndef MT25018_COMMON_CONNECTION_H
+#define MT25018_COMMON_CONNECTION_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "MT25018_Common_PerfCounters.h"
+#include "MT25018_Common_SyscallProbe.h"
+#include "MT25018_Common_Results.h"
+#include "MT25018_Common_Churn.h"
+#include "MT25018_Common_Duplex.h"
+#include "MT25018_Common_Timestamping.h"
+#include "MT25018_Common_TcpInfo.h"
+#include "MT25018_Common_Metrics.h"
+#include "MT25018_Common_Mptcp.h"
+#include "MT25018_Common_MemAccount.h"
+#include "MT25018_Common_Trace.h"
+#include "MT25018_Common_FairSched.h"
+
+#define CONNECTION_MAX_RESULTS 100
+#define CONNECTION_FLUSH_MESSAGES 1000  /* messages between updates of the totals */
+
+/* Per-connection result, recorded when a handler thread exits */
+typedef struct {
+    int thread_id;
+    long long bytes_sent;
+    long long messages_sent;
+    double duration_sec;
+    int weight;                 /* fair scheduler weight, 1 when off */
+} ConnectionResult;
+
+/* What every finished connection adds to the server's statistics */
+typedef struct {
+    long long bytes_sent;
+    long long messages_sent;
+    PerfSample perf;
+    SyscallProbe syscall_probe;
+    ConnectionResult connections[CONNECTION_MAX_RESULTS];  /* the first ones only */
+    int num_connections;
+    long long connections_dropped;                          /* finished after the array filled */
+    JainAccumulator fairness;                               /* over every connection */
+    long long connections_served;
+    DuplexDirection duplex_tx;
+    DuplexDirection duplex_rx;
+    TimestampBreakdown timestamps;
+    MptcpStats mptcp;
+} ConnectionTotals;
+
+/* Server-wide state a connection registers with; lock guards totals */
+typedef struct {
+    pthread_mutex_t *lock;
+    ConnectionTotals *totals;
+    TcpInfoSampler *tcpinfo;
+    MemAccount *mem_account;
+    MetricsExporter *metrics;
+    TraceFile *trace_file;
+    FairScheduler *sched;
+} ConnectionServices;
+
+/* The handler's options */
+typedef struct {
+    int socket;
+    int thread_id;
+    const char *transport;      /* name in the timestamp trace */
+    int perf_counters;
+    int syscall_probe;
+    int persistent;             /* quiet: no per-connection output */
+    int churn;                  /* clients open with a one-byte hello */
+    int duplex;
+    FILE *timestamp_file;
+    int mptcp;
+} ConnectionConfig;
+
+typedef struct {
+    const ConnectionConfig *config;
+    const ConnectionServices *services;
+    int socket;
+    int thread_id;
+    PerfCounters perf;
+    int perf_enabled;
+    PerfSample perf_sample;
+    SyscallProbe probe_state;
+    SyscallProbe *probe;        /* NULL when the probe is off */
+    DuplexWorker rx_worker;
+    DuplexTimer tx_timer;
+    DuplexDirection tx_stats;
+    int duplex_enabled;
+    TxTimestamper tx_ts;
+    int timestamps_enabled;
+    int mptcp_subflow_count;    /* most subflows seen */
+    MetricsSlot *metrics_slot;
+    TraceRing trace_ring;
+    TraceRing *trace;
+    FairFlow fair_flow;
+    FairFlow *flow;
+    struct timeval start_time;
+    struct timeval end_time;
+    long long bytes;            /* whole connection */
+    long long messages;
+    long long pending_bytes;    /* not yet added to the totals */
+    long long pending_messages;
+} ConnectionContext;
+
+/* Set up everything the connection's options ask for and start its clock.
+ * duplex_recv(duplex_ctx) receives one message in duplex mode. The
+ * context must stay in place until connection_close(). */
+static inline void connection_open(ConnectionContext *c, const ConnectionConfig *config,
+                                   const ConnectionServices *services, DuplexIoFn duplex_recv,
+                                   void *duplex_ctx) {
+    memset(c, 0, sizeof(*c));
+    c->config = config;
+    c->services = services;
+    c->socket = config->socket;
+    c->thread_id = config->thread_id;
+
+    /* Consume the one-byte hello a churn client opens with */
+    if (config->churn) {
+        churn_read_hello(c->socket);
+    }
+
+    /* Per-thread counters; they only run around the send loop */
+    c->perf_enabled = config->perf_counters && perf_counters_open(&c->perf) > 0;
+    if (config->perf_counters && !c->perf_enabled) {
+        fprintf(stderr, "[Thread %d] Warning: perf_event_open failed, counters disabled\n",
+                c->thread_id);
+    }
+    if (c->perf_enabled) {
+        perf_counters_start(&c->perf);
+    }
+
+    /* Per-thread syscall probe, merged into the totals on exit */
+    if (config->syscall_probe) {
+        syscall_probe_init(&c->probe_state);
+        c->probe = &c->probe_state;
+    }
+
+    /* Full-duplex: a second thread receives the client's messages */
+    c->duplex_enabled = config->duplex &&
+                        duplex_worker_start(&c->rx_worker, duplex_recv, duplex_ctx) == 0;
+    duplex_timer_start(&c->tx_timer);
+
+    /* SO_TIMESTAMPING trace of every TIMESTAMP_SAMPLE_INTERVAL-th message */
+    c->timestamps_enabled = config->timestamp_file &&
+                            tx_timestamp_init(&c->tx_ts, c->socket, config->transport,
+                                              config->timestamp_file) == 0;
+
+    tcpinfo_register(services->tcpinfo, c->socket, c->thread_id);
+    mem_account_register(services->mem_account, c->socket);
+    /* Extra subflows join after the handshake, so this is re-read later */
+    c->mptcp_subflow_count = config->mptcp ? mptcp_subflows(c->socket) : 0;
+    c->metrics_slot = metrics_slot_acquire(services->metrics, c->thread_id, NULL);
+    c->trace = trace_ring_acquire(services->trace_file, &c->trace_ring, c->thread_id);
+    c->flow = fair_flow_join(services->sched, &c->fair_flow, c->thread_id);
+
+    gettimeofday(&c->start_time, NULL);
+}
+
+/* Call before each send; in a scheduling mode this waits for the
+ * connection's turn. path goes into the trace's aux field. */
+static inline void connection_before_send(ConnectionContext *c, int message_size,
+                                          uint16_t path) {
+    fair_turn(c->services->sched, c->flow, message_size);
+    if (c->timestamps_enabled) {
+        tx_timestamp_before(&c->tx_ts, c->messages);
+    }
+    trace_event(c->trace, TRACE_SEND_BEGIN, 0, 0, path);
+}
+
+/* Call right after the send with its result; errno is left as the send set it */
+static inline void connection_after_send(ConnectionContext *c, int bytes_sent, uint16_t path) {
+    int send_errno = errno;
+    trace_event(c->trace, TRACE_SEND_END, bytes_sent, bytes_sent < 0 ? send_errno : 0, path);
+    if (c->timestamps_enabled) {
+        tx_timestamp_after(&c->tx_ts, bytes_sent);
+    }
+    errno = send_errno;
+}
+
+/* Count a successful send; the totals are updated every
+ * CONNECTION_FLUSH_MESSAGES messages and at the end */
+static inline void connection_account(ConnectionContext *c, int bytes_sent) {
+    c->bytes += bytes_sent;
+    c->messages++;
+    c->pending_bytes += bytes_sent;
+    c->pending_messages++;
+    metrics_slot_add(c->metrics_slot, bytes_sent);
+    fair_charge(c->flow, bytes_sent);
+
+    if (c->pending_messages >= CONNECTION_FLUSH_MESSAGES) {
+        if (c->config->mptcp) {
+            int subflows = mptcp_subflows(c->socket);
+            if (subflows > c->mptcp_subflow_count) {
+                c->mptcp_subflow_count = subflows;
+            }
+        }
+        pthread_mutex_lock(c->services->lock);
+        c->services->totals->bytes_sent += c->pending_bytes;
+        c->services->totals->messages_sent += c->pending_messages;
+        pthread_mutex_unlock(c->services->lock);
+        c->pending_bytes = 0;
+        c->pending_messages = 0;
+    }
+}
+
+/* The send loop is over: stop the clock, the duplex worker and the counters */
+static inline void connection_end(ConnectionContext *c) {
+    fair_flow_leave(c->services->sched, c->flow);
+    gettimeofday(&c->end_time, NULL);
+
+    if (c->duplex_enabled) {
+        duplex_timer_stop(&c->tx_timer, &c->tx_stats);
+        c->tx_stats.bytes = c->bytes;
+        c->tx_stats.messages = c->messages;
+        duplex_worker_stop(&c->rx_worker, c->socket);
+    }
+    if (c->perf_enabled) {
+        perf_counters_stop(&c->perf);
+        perf_counters_read(&c->perf, &c->perf_sample);
+        perf_counters_close(&c->perf);
+    }
+    if (c->timestamps_enabled) {
+        tx_timestamp_finish(&c->tx_ts);
+    }
+}
+
+static inline double connection_duration_sec(const ConnectionContext *c) {
+    return (c->end_time.tv_sec - c->start_time.tv_sec) +
+           (c->end_time.tv_usec - c->start_time.tv_usec) / 1000000.0;
+}
+
+/* Add the finished connection to the totals (services->lock held) */
+static inline void connection_merge_locked(ConnectionContext *c) {
+    ConnectionTotals *t = c->services->totals;
+    t->bytes_sent += c->pending_bytes;
+    t->messages_sent += c->pending_messages;
+    c->pending_bytes = 0;
+    c->pending_messages = 0;
+    if (c->perf_enabled) {
+        perf_sample_add(&t->perf, &c->perf_sample);
+    }
+    if (c->probe) {
+        syscall_probe_merge(&t->syscall_probe, c->probe);
+    }
+    t->connections_served++;
+    if (c->config->mptcp) {
+        mptcp_stats_add(&t->mptcp, c->mptcp_subflow_count);
+    }
+    if (c->timestamps_enabled) {
+        timestamp_breakdown_merge(&t->timestamps, &c->tx_ts.stats);
+    }
+    if (c->duplex_enabled) {
+        duplex_direction_add(&t->duplex_tx, &c->tx_stats);
+        duplex_direction_add(&t->duplex_rx, &c->rx_worker.stats);
+    }
+    /* Fairness: throughput divided by the fair scheduler weight */
+    double duration = connection_duration_sec(c);
+    int weight = c->flow ? c->flow->weight : 1;
+    jain_add(&t->fairness, duration > 0 ? c->bytes / duration / weight : 0.0);
+    if (t->num_connections < CONNECTION_MAX_RESULTS) {
+        ConnectionResult *conn = &t->connections[t->num_connections++];
+        conn->thread_id = c->thread_id;
+        conn->bytes_sent = c->bytes;
+        conn->messages_sent = c->messages;
+        conn->duration_sec = duration;
+        conn->weight = weight;
+    } else {
+        t->connections_dropped++;
+    }
+}
+
+/* Report the connection, unregister it everywhere and close its socket */
+static inline void connection_close(ConnectionContext *c) {
+    if (!c->config->persistent) {
+        printf("[Thread %d] Client disconnected. Messages sent: %lld\n", c->thread_id,
+               c->messages);
+        if (c->perf_enabled) {
+            char prefix[32];
+            snprintf(prefix, sizeof(prefix), "[Thread %d]", c->thread_id);
+            perf_sample_print_brief(prefix, &c->perf_sample, c->bytes);
+        }
+    }
+
+    tcpinfo_unregister(c->services->tcpinfo, c->socket);
+    mem_account_unregister(c->services->mem_account, c->socket);
+    metrics_slot_release(c->services->metrics, c->metrics_slot);
+    trace_ring_release(c->trace);
+    close(c->socket);
+}
+
+/* The server's result record, less transport-specific sections */
+typedef struct {
+    const char *transport;
+    int message_size;
+    int max_threads;
+    double elapsed;
+    const ConnectionTotals *totals;
+    const FairScheduler *sched;
+    int perf_counters;
+    int duplex;
+    int timestamps;
+    int mptcp;
+    const MemAccount *mem_account;  /* NULL when accounting is off */
+} ServerResults;
+
+/* Write r's fields into an open record (the totals' lock held) */
+static inline void server_results_json(JsonWriter *w, const ServerResults *r) {
+    const ConnectionTotals *t = r->totals;
+    json_string(w, "role", "server");
+    json_string(w, "transport", r->transport);
+    json_int(w, "message_size", r->message_size);
+    json_int(w, "max_threads", r->max_threads);
+    json_int(w, "bytes", t->bytes_sent);
+    json_int(w, "messages", t->messages_sent);
+    json_double(w, "elapsed_sec", r->elapsed);
+    json_double(w, "throughput_gbps", (t->bytes_sent * 8.0) / (r->elapsed * 1e9));
+    json_int(w, "connections_served", t->connections_served);
+    json_double(w, "accept_rate_per_sec", t->connections_served / r->elapsed);
+
+    json_begin_array(w, "connections");
+    for (int i = 0; i < t->num_connections; i++) {
+        const ConnectionResult *conn = &t->connections[i];
+        json_begin_object(w, NULL);
+        json_int(w, "thread_id", conn->thread_id);
+        json_int(w, "bytes", conn->bytes_sent);
+        json_int(w, "messages", conn->messages_sent);
+        json_int(w, "weight", conn->weight);
+        json_double(w, "duration_sec", conn->duration_sec);
+        json_double(w, "throughput_gbps", conn->duration_sec > 0 ?
+                    (conn->bytes_sent * 8.0) / (conn->duration_sec * 1e9) : 0.0);
+        json_end_object(w);
+    }
+    json_end_array(w);
+    json_int(w, "connections_dropped", t->connections_dropped);
+    json_double(w, "jain_index", jain_index(&t->fairness));
+    if (r->sched->mode != SCHED_NONE) {
+        json_fair_sched(w, "scheduler", r->sched);
+    }
+
+    if (r->perf_counters) {
+        json_perf_sample(w, "perf", &t->perf, t->bytes_sent);
+    }
+    if (r->duplex) {
+        json_duplex(w, "duplex", &t->duplex_tx, &t->duplex_rx, r->elapsed);
+    }
+    if (r->timestamps) {
+        json_timestamps(w, "timestamps", &t->timestamps);
+    }
+    if (r->mptcp) {
+        json_mptcp(w, "mptcp", &t->mptcp);
+    }
+    if (r->mem_account) {
+        json_mem_account(w, "memory", r->mem_account);
+    }
+}
+
+#endif /* MT25018_COMMON_CONNECTION_H */
@@ -0,0 +1,181 @@
+/*
+ * MT25018 - Graduate Systems PA02
+ * Common: Full-duplex streaming
+ * In duplex mode both ends send and receive on the same connection: the
+ * thread that already drives one direction keeps doing so, and a
+ * DuplexWorker thread drives the other one with the transport's own
+ * send or receive function. Each direction is charged the CPU time of
+ * the thread driving it.
+ */
+
+#ifndef MT25018_COMMON_DUPLEX_H
+#define MT25018_COMMON_DUPLEX_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/socket.h>
+
+#include "MT25018_Common_Results.h"
+
+/* Traffic and cost of one direction */
+typedef struct {
+    long long bytes;
+    long long messages;
+    unsigned long long cpu_ns;      /* CPU time of the driving thread */
+} DuplexDirection;
+
+typedef struct {
+    uint64_t cpu_start_ns;
+} DuplexTimer;
+
+/* Moves one message; returns bytes transferred or -1 when the connection ends */
+typedef int (*DuplexIoFn)(void *ctx);
+
+/* Thread driving the second direction of a connection */
+typedef struct {
+    DuplexIoFn io;
+    void *ctx;
+    volatile int running;
+    int restart;                    /* set by duplex_worker_restart() */
+    DuplexDirection stats;
+    pthread_t thread;
+} DuplexWorker;
+
+static inline uint64_t duplex_thread_cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline void duplex_timer_start(DuplexTimer *t) {
+    t->cpu_start_ns = duplex_thread_cpu_ns();
+}
+
+/* Charge the calling thread's CPU time since duplex_timer_start() to d */
+static inline void duplex_timer_stop(const DuplexTimer *t, DuplexDirection *d) {
+    d->cpu_ns += duplex_thread_cpu_ns() - t->cpu_start_ns;
+}
+
+static inline void *duplex_worker_main(void *arg) {
+    DuplexWorker *w = (DuplexWorker *)arg;
+    DuplexTimer timer;
+    duplex_timer_start(&timer);
+    while (w->running) {
+        /* The stats are only touched by this thread until it is joined */
+        if (__atomic_load_n(&w->restart, __ATOMIC_RELAXED) &&
+            __atomic_exchange_n(&w->restart, 0, __ATOMIC_ACQUIRE)) {
+            memset(&w->stats, 0, sizeof(w->stats));
+            duplex_timer_start(&timer);
+        }
+        int n = w->io(w->ctx);
+        if (n < 0) {
+            break;
+        }
+        w->stats.bytes += n;
+        w->stats.messages++;
+    }
+    duplex_timer_stop(&timer, &w->stats);
+    return NULL;
+}
+
+static inline int duplex_worker_start(DuplexWorker *w, DuplexIoFn io, void *ctx) {
+    memset(w, 0, sizeof(*w));
+    w->io = io;
+    w->ctx = ctx;
+    w->running = 1;
+    if (pthread_create(&w->thread, NULL, duplex_worker_main, w) != 0) {
+        perror("pthread_create failed for duplex worker");
+        return -1;
+    }
+    return 0;
+}
+
+/* Drop the worker's traffic and CPU time so far (e.g. at the end of a
+ * warm-up); the worker clears its own stats before its next message */
+static inline void duplex_worker_restart(DuplexWorker *w) {
+    __atomic_store_n(&w->restart, 1, __ATOMIC_RELEASE);
+}
+
+/* Stop the worker once the main direction is done
+ * shutdown() wakes a worker blocked in send/recv on the socket.
+ */
+static inline void duplex_worker_stop(DuplexWorker *w, int socket) {
+    w->running = 0;
+    shutdown(socket, SHUT_RDWR);
+    pthread_join(w->thread, NULL);
+}
+
+static inline void duplex_direction_add(DuplexDirection *total, const DuplexDirection *d) {
+    total->bytes += d->bytes;
+    total->messages += d->messages;
+    total->cpu_ns += d->cpu_ns;
+}
+
+/* Fill count buffers of field_size bytes with dummy data (for the sender) */
+static inline int duplex_alloc_fields(char **fields, int count, int field_size) {
+    for (int i = 0; i < count; i++) {
+        fields[i] = (char *)malloc(field_size);
+        if (!fields[i]) {
+            perror("malloc failed for duplex fields");
+            while (--i >= 0) {
+                free(fields[i]);
+            }
+            return -1;
+        }
+        for (int j = 0; j < field_size; j++) {
+            fields[i][j] = 'a' + (i + j) % 26;
+        }
+    }
+    return 0;
+}
+
+static inline void duplex_free_fields(char **fields, int count) {
+    for (int i = 0; i < count; i++) {
+        free(fields[i]);
+    }
+}
+
+/* Per-direction throughput over elapsed_seconds and CPU cost */
+static inline void duplex_print(const DuplexDirection *tx, const DuplexDirection *rx,
+                                double elapsed_seconds) {
+    const DuplexDirection *dirs[2] = {tx, rx};
+    const char *names[2] = {"TX", "RX"};
+
+    printf("\n=== Full-Duplex ===\n");
+    printf("%-4s %14s %12s %10s %12s %12s\n",
+           "Dir", "Bytes", "Messages", "Gbps", "CPU cores", "CPU ns/byte");
+    for (int i = 0; i < 2; i++) {
+        const DuplexDirection *d = dirs[i];
+        printf("%-4s %14lld %12lld %10.2f %12.2f %12.3f\n",
+               names[i], d->bytes, d->messages,
+               elapsed_seconds > 0 ? d->bytes * 8.0 / (elapsed_seconds * 1e9) : 0.0,
+               elapsed_seconds > 0 ? d->cpu_ns / (elapsed_seconds * 1e9) : 0.0,
+               d->bytes ? (double)d->cpu_ns / d->bytes : 0.0);
+    }
+}
+
+static inline void json_duplex_direction(JsonWriter *w, const char *key, const DuplexDirection *d,
+                                         double elapsed_seconds) {
+    json_begin_object(w, key);
+    json_int(w, "bytes", d->bytes);
+    json_int(w, "messages", d->messages);
+    json_double(w, "throughput_gbps",
+                elapsed_seconds > 0 ? d->bytes * 8.0 / (elapsed_seconds * 1e9) : 0.0);
+    json_int(w, "cpu_ns", (long long)d->cpu_ns);
+    json_double(w, "cpu_ns_per_byte", d->bytes ? (double)d->cpu_ns / d->bytes : 0.0);
+    json_end_object(w);
+}
+
+static inline void json_duplex(JsonWriter *w, const char *key, const DuplexDirection *tx,
+                               const DuplexDirection *rx, double elapsed_seconds) {
+    json_begin_object(w, key);
+    json_duplex_direction(w, "tx", tx, elapsed_seconds);
+    json_duplex_direction(w, "rx", rx, elapsed_seconds);
+    json_end_object(w);
+}
+
+#endif /* MT25018_COMMON_DUPLEX_H */
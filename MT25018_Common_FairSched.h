@@ -0,0 +1,284 @@
+/*
+ * MT25018 - Graduate Systems PA02
+ * Common: Fair scheduling across connections
+ * With one detached thread per connection, whichever thread the kernel
+ * runs gets the bandwidth. In a scheduling mode the handler threads
+ * instead take turns on a shared pool of workers: at most `workers`
+ * connections send at once, and the others wait in a FIFO run queue. A
+ * turn is a byte quantum times the connection's weight:
+ *   - wrr: weighted round-robin. A turn sends messages until its budget
+ *     is used up; the last message may overrun it, and the overrun is
+ *     forgotten.
+ *   - drr: deficit round-robin. The quantum is added to a deficit
+ *     counter, and a turn sends only whole messages that fit in it. The
+ *     remainder carries over to the next turn, so long-run shares match
+ *     the weights even when the quantum is smaller than a message.
+ * Fairness is judged with Jain's index over the per-connection
+ * throughput divided by the weight: 1 is perfectly fair, and 1/n means
+ * one connection got everything.
+ */
+
+#ifndef MT25018_COMMON_FAIRSCHED_H
+#define MT25018_COMMON_FAIRSCHED_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "MT25018_Common_Results.h"
+
+#define SCHED_DEFAULT_QUANTUM 65536     /* bytes per turn at weight 1 */
+#define SCHED_MAX_WEIGHTS 16
+
+typedef enum {
+    SCHED_NONE = 0,                     /* thread per connection, kernel decides */
+    SCHED_WRR,
+    SCHED_DRR
+} SchedMode;
+
+/* One connection's place in the scheduler */
+typedef struct FairFlow {
+    struct FairFlow *next;              /* run queue link */
+    pthread_cond_t turn;                /* signalled when the flow may run */
+    int weight;
+    int holding;                        /* a turn is in progress */
+    long long budget;                   /* wrr: bytes left in the turn */
+    long long deficit;                  /* drr: bytes the flow may send */
+    long long turns;
+    uint64_t wait_ns;                   /* time spent in the run queue */
+} FairFlow;
+
+typedef struct {
+    SchedMode mode;
+    int quantum;
+    int workers;
+    int weights[SCHED_MAX_WEIGHTS];     /* cycled by connection id */
+    int num_weights;
+    pthread_mutex_t lock;
+    FairFlow *head;
+    FairFlow *tail;
+    int running;                        /* turns in progress */
+    long long turns;
+    uint64_t wait_ns;
+} FairScheduler;
+
+static inline const char *sched_mode_name(SchedMode mode) {
+    switch (mode) {
+    case SCHED_WRR: return "wrr";
+    case SCHED_DRR: return "drr";
+    default: return "none";
+    }
+}
+
+/* Parse "none", "wrr" or "drr"; returns -1 otherwise */
+static inline int sched_mode_parse(const char *name) {
+    if (strcmp(name, "none") == 0) return SCHED_NONE;
+    if (strcmp(name, "wrr") == 0) return SCHED_WRR;
+    if (strcmp(name, "drr") == 0) return SCHED_DRR;
+    return -1;
+}
+
+/* Parse a comma-separated weight list such as "1,2,4"; returns 0 or -1 */
+static inline int fair_sched_parse_weights(FairScheduler *s, const char *list) {
+    s->num_weights = 0;
+    const char *p = list;
+    while (*p && s->num_weights < SCHED_MAX_WEIGHTS) {
+        char *end;
+        long weight = strtol(p, &end, 10);
+        if (end == p || weight < 1 || weight > 1000) {
+            return -1;
+        }
+        s->weights[s->num_weights++] = (int)weight;
+        p = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') {
+            return -1;
+        }
+    }
+    return s->num_weights > 0 ? 0 : -1;
+}
+
+/* One worker per CPU the server may run on, but fewer than the expected
+ * connections: with a worker for every connection nothing ever queues and
+ * the turns decide nothing */
+static inline int fair_sched_default_workers(int connections) {
+    cpu_set_t set;
+    int workers = 1;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        workers = CPU_COUNT(&set);
+    }
+    if (workers >= connections) {
+        workers = connections - 1;
+    }
+    return workers > 0 ? workers : 1;
+}
+
+/* workers <= 0 uses fair_sched_default_workers(connections) */
+static inline void fair_sched_init(FairScheduler *s, SchedMode mode, int quantum, int workers,
+                                   int connections) {
+    s->mode = mode;
+    s->quantum = quantum > 0 ? quantum : SCHED_DEFAULT_QUANTUM;
+    s->workers = workers > 0 ? workers : fair_sched_default_workers(connections);
+    pthread_mutex_init(&s->lock, NULL);
+    s->head = s->tail = NULL;
+    s->running = 0;
+    s->turns = 0;
+    s->wait_ns = 0;
+}
+
+static inline int fair_sched_weight(const FairScheduler *s, int flow_id) {
+    if (s->num_weights == 0 || flow_id < 1) {
+        return 1;
+    }
+    return s->weights[(flow_id - 1) % s->num_weights];
+}
+
+/* Register connection flow_id; returns the flow, or NULL when scheduling is off */
+static inline FairFlow *fair_flow_join(FairScheduler *s, FairFlow *f, int flow_id) {
+    if (s->mode == SCHED_NONE) {
+        return NULL;
+    }
+    memset(f, 0, sizeof(*f));
+    pthread_cond_init(&f->turn, NULL);
+    f->weight = fair_sched_weight(s, flow_id);
+    return f;
+}
+
+static inline uint64_t fair_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Give up the worker and wake the next flow in line (lock held) */
+static inline void fair_turn_end_locked(FairScheduler *s, FairFlow *f) {
+    f->holding = 0;
+    s->running--;
+    if (s->head) {
+        pthread_cond_signal(&s->head->turn);
+    }
+}
+
+/* Call before each send of message_bytes: returns at once while the
+ * current turn has room, otherwise ends the turn, queues the flow behind
+ * the others and waits for its next turn */
+static inline void fair_turn(FairScheduler *s, FairFlow *f, int message_bytes) {
+    if (!f) {
+        return;
+    }
+    for (;;) {
+        if (f->holding && (s->mode == SCHED_WRR ? f->budget > 0 : f->deficit >= message_bytes)) {
+            return;
+        }
+        pthread_mutex_lock(&s->lock);
+        if (f->holding) {
+            fair_turn_end_locked(s, f);
+        }
+        f->next = NULL;
+        if (s->tail) {
+            s->tail->next = f;
+        } else {
+            s->head = f;
+        }
+        s->tail = f;
+        uint64_t queued = fair_now_ns();
+        while (s->head != f || s->running >= s->workers) {
+            pthread_cond_wait(&f->turn, &s->lock);
+        }
+        s->head = f->next;
+        if (!s->head) {
+            s->tail = NULL;
+        }
+        s->running++;
+        /* A free worker left over goes to the new head right away */
+        if (s->head && s->running < s->workers) {
+            pthread_cond_signal(&s->head->turn);
+        }
+        uint64_t waited = fair_now_ns() - queued;
+        f->wait_ns += waited;
+        f->turns++;
+        s->wait_ns += waited;
+        s->turns++;
+        pthread_mutex_unlock(&s->lock);
+
+        f->holding = 1;
+        if (s->mode == SCHED_WRR) {
+            f->budget = (long long)f->weight * s->quantum;
+        } else {
+            f->deficit += (long long)f->weight * s->quantum;
+        }
+    }
+}
+
+/* Charge a completed send to the current turn */
+static inline void fair_charge(FairFlow *f, int bytes) {
+    if (!f || bytes <= 0) {
+        return;
+    }
+    f->budget -= bytes;
+    f->deficit -= bytes;
+    if (f->deficit < 0) {
+        f->deficit = 0;
+    }
+}
+
+/* The connection is done: hand its worker on */
+static inline void fair_flow_leave(FairScheduler *s, FairFlow *f) {
+    if (!f) {
+        return;
+    }
+    pthread_mutex_lock(&s->lock);
+    if (f->holding) {
+        fair_turn_end_locked(s, f);
+    }
+    pthread_mutex_unlock(&s->lock);
+    pthread_cond_destroy(&f->turn);
+}
+
+/* Jain's fairness index, (sum x)^2 / (n * sum x^2), accumulated one value
+ * at a time so it covers every connection of a long-running server */
+typedef struct {
+    long long n;
+    double sum;
+    double sum_sq;
+} JainAccumulator;
+
+static inline void jain_add(JainAccumulator *j, double x) {
+    j->n++;
+    j->sum += x;
+    j->sum_sq += x * x;
+}
+
+static inline double jain_index(const JainAccumulator *j) {
+    return j->n > 0 && j->sum_sq > 0 ? (j->sum * j->sum) / (j->n * j->sum_sq) : 0.0;
+}
+
+static inline void fair_sched_print(const FairScheduler *s) {
+    printf("\n=== Fair Scheduler ===\n");
+    printf("Mode: %s, quantum %d bytes, %d worker(s)", sched_mode_name(s->mode), s->quantum,
+           s->workers);
+    if (s->num_weights > 0) {
+        printf(", weights");
+        for (int i = 0; i < s->num_weights; i++) {
+            printf("%c%d", i ? ',' : ' ', s->weights[i]);
+        }
+    }
+    printf("\nTurns: %lld, avg queue wait %.1f us\n", s->turns,
+           s->turns ? s->wait_ns / 1000.0 / s->turns : 0.0);
+}
+
+static inline void json_fair_sched(JsonWriter *w, const char *key, const FairScheduler *s) {
+    json_begin_object(w, key);
+    json_string(w, "mode", sched_mode_name(s->mode));
+    json_int(w, "quantum", s->quantum);
+    json_int(w, "workers", s->workers);
+    json_int(w, "turns", s->turns);
+    json_double(w, "avg_wait_us", s->turns ? s->wait_ns / 1000.0 / s->turns : 0.0);
+    json_end_object(w);
+}
+
+#endif /* MT25018_COMMON_FAIRSCHED_H */
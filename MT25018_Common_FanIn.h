@@ -0,0 +1,418 @@
+/*
+ * MT25018 - Graduate Systems PA02
+ * Common: Coroutine fan-in client engine
+ * Multiplexes thousands of connections over a few threads. Each thread
+ * owns an epoll instance and a slice of the connections; every connection
+ * runs its transport's receive logic as a stackless coroutine that yields
+ * where the blocking recv_message_* would sleep, and is resumed when epoll
+ * reports the socket readable. Coroutine state lives in FanInConn, so a
+ * connection costs a few dozen bytes plus its socket.
+ */
+
+#ifndef MT25018_COMMON_FANIN_H
+#define MT25018_COMMON_FANIN_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+#include "MT25018_Common_PerfCounters.h"
+#include "MT25018_Common_Results.h"
+
+/* Stackless coroutines (Duff's device): CORO_YIELD records the line it
+ * returns from and the switch in CORO_BEGIN jumps back there on the next
+ * call. Locals do not survive a yield; keep state in the FanInConn. */
+#define CORO_BEGIN(c) switch ((c)->resume) { case 0:
+#define CORO_YIELD(c, value) \
+    do { (c)->resume = __LINE__; return (value); case __LINE__:; } while (0)
+#define CORO_END(c) } (c)->resume = 0
+
+/* Coroutine result when the socket has no more data for now */
+#define FANIN_BLOCKED 0
+
+/* Messages one connection may receive per wakeup before yielding to others */
+#define FANIN_RESUME_BUDGET 16
+
+#define FANIN_MAX_EVENTS 256
+#define FANIN_MAX_THREADS 64
+
+/* One multiplexed connection */
+typedef struct {
+    int fd;
+    int connected;
+    int resume;                     /* coroutine resume point, 0 = start */
+    int field;                      /* coroutine state: current field ... */
+    size_t offset;                  /* ... and bytes received of it (or of the message) */
+    long long msg_start_ns;         /* 0 until the current message's first resume */
+    long long connect_start_ns;
+    long long messages;
+} FanInConn;
+
+/* Transport receive coroutine: receives one message into buffer and
+ * returns its size, FANIN_BLOCKED if it has to wait, or -1 when the
+ * connection ends. The buffer is per thread; payloads are discarded, as in
+ * the blocking receive functions. */
+typedef int (*FanInRecvFn)(FanInConn *c, int field_size, char *buffer);
+
+typedef struct {
+    struct sockaddr_in server_addr;
+    int connections;
+    int threads;
+    int num_fields;
+    int field_size;
+    int duration;
+    int perf_counters;
+    FanInRecvFn recv_message;
+} FanInConfig;
+
+typedef struct {
+    long long bytes;
+    long long messages;
+    long long connected;
+    long long failed;               /* connect() errors */
+    long long closed;               /* closed by the server before the end */
+    long long wakeups;              /* epoll_wait() calls that returned events */
+    long long resumes;
+    long long min_conn_messages;    /* over connections that were established */
+    long long max_conn_messages;
+    LatencyHistogram latency_ns;    /* first resume of a message to its last byte */
+    LatencyHistogram connect_ns;    /* connect() to writable */
+    PerfSample perf;
+    int perf_enabled;
+    double elapsed_seconds;
+} FanInStats;
+
+typedef struct {
+    const FanInConfig *config;
+    FanInConn *conns;
+    int count;
+    long long end_ns;
+    long long stop_ns;              /* when the receive loop ended */
+    FanInStats stats;
+    pthread_t thread;
+} FanInThread;
+
+static inline long long fanin_time_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* Default engine threads: one per CPU, at most 4 and at most one per connection */
+static inline int fanin_default_threads(int connections) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = cpus > 4 ? 4 : (cpus < 1 ? 1 : (int)cpus);
+    return threads < connections ? threads : connections;
+}
+
+/* Raise the open file limit to cover all connections; returns 0 or -1 */
+static inline int fanin_raise_nofile(int connections) {
+    struct rlimit rl;
+    rlim_t need = (rlim_t)connections + 64;
+    if (getrlimit(RLIMIT_NOFILE, &rl) < 0) {
+        perror("getrlimit failed");
+        return -1;
+    }
+    if (rl.rlim_cur >= need) {
+        return 0;
+    }
+    rl.rlim_cur = need;
+    if (rl.rlim_max < need) {
+        rl.rlim_max = need;
+    }
+    if (setrlimit(RLIMIT_NOFILE, &rl) < 0) {
+        fprintf(stderr, "Error: need %llu file descriptors: %s\n",
+                (unsigned long long)need, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+static inline void fanin_close(int epfd, FanInConn *c) {
+    epoll_ctl(epfd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    c->fd = -1;
+}
+
+/* Start a non-blocking connect and watch for its completion */
+static inline void fanin_connect(FanInThread *t, int epfd, FanInConn *c) {
+    c->connect_start_ns = fanin_time_ns();
+    c->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (c->fd < 0) {
+        t->stats.failed++;
+        return;
+    }
+    if (connect(c->fd, (const struct sockaddr *)&t->config->server_addr,
+                sizeof(t->config->server_addr)) < 0 && errno != EINPROGRESS) {
+        close(c->fd);
+        c->fd = -1;
+        t->stats.failed++;
+        return;
+    }
+
+    struct epoll_event ev;
+    ev.events = EPOLLOUT;
+    ev.data.ptr = c;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, c->fd, &ev) < 0) {
+        close(c->fd);
+        c->fd = -1;
+        t->stats.failed++;
+    }
+}
+
+/* The socket became writable: the connect finished, successfully or not */
+static inline void fanin_connected(FanInThread *t, int epfd, FanInConn *c) {
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (getsockopt(c->fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err != 0) {
+        fanin_close(epfd, c);
+        t->stats.failed++;
+        return;
+    }
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = c;
+    epoll_ctl(epfd, EPOLL_CTL_MOD, c->fd, &ev);
+    c->connected = 1;
+    t->stats.connected++;
+    latency_hist_record(&t->stats.connect_ns, (uint64_t)(fanin_time_ns() - c->connect_start_ns));
+}
+
+/* Run a connection's coroutine until it blocks or uses up its budget */
+static inline void fanin_resume(FanInThread *t, int epfd, FanInConn *c, char *buffer) {
+    const FanInConfig *config = t->config;
+    t->stats.resumes++;
+
+    for (int budget = 0; budget < FANIN_RESUME_BUDGET; budget++) {
+        if (c->msg_start_ns == 0) {
+            c->msg_start_ns = fanin_time_ns();
+        }
+        int n = config->recv_message(c, config->field_size, buffer);
+        if (n == FANIN_BLOCKED) {
+            return;
+        }
+        if (n < 0) {
+            fanin_close(epfd, c);
+            t->stats.closed++;
+            return;
+        }
+        latency_hist_record(&t->stats.latency_ns, (uint64_t)(fanin_time_ns() - c->msg_start_ns));
+        c->msg_start_ns = 0;
+        c->messages++;
+        t->stats.bytes += n;
+        t->stats.messages++;
+    }
+}
+
+static inline void *fanin_thread_main(void *arg) {
+    FanInThread *t = (FanInThread *)arg;
+    const FanInConfig *config = t->config;
+    struct epoll_event events[FANIN_MAX_EVENTS];
+    t->stats.min_conn_messages = -1;
+
+    char *buffer = (char *)malloc((size_t)config->num_fields * config->field_size);
+    int epfd = epoll_create1(0);
+    if (!buffer || epfd < 0) {
+        perror("fan-in thread setup failed");
+        free(buffer);
+        t->stats.failed = t->count;
+        return NULL;
+    }
+
+    PerfCounters perf;
+    t->stats.perf_enabled = config->perf_counters && perf_counters_open(&perf) > 0;
+    if (t->stats.perf_enabled) {
+        perf_counters_start(&perf);
+    }
+
+    for (int i = 0; i < t->count; i++) {
+        fanin_connect(t, epfd, &t->conns[i]);
+    }
+
+    while (fanin_time_ns() < t->end_ns) {
+        int n = epoll_wait(epfd, events, FANIN_MAX_EVENTS, 100);
+        if (n < 0 && errno != EINTR) {
+            perror("epoll_wait failed");
+            break;
+        }
+        if (n > 0) {
+            t->stats.wakeups++;
+        }
+        for (int i = 0; i < n; i++) {
+            FanInConn *c = (FanInConn *)events[i].data.ptr;
+            if (c->fd < 0) {
+                continue;
+            }
+            if (!c->connected) {
+                fanin_connected(t, epfd, c);
+            } else {
+                fanin_resume(t, epfd, c, buffer);
+            }
+        }
+    }
+
+    t->stop_ns = fanin_time_ns();
+
+    if (t->stats.perf_enabled) {
+        perf_counters_stop(&perf);
+        perf_counters_read(&perf, &t->stats.perf);
+        perf_counters_close(&perf);
+    }
+
+    for (int i = 0; i < t->count; i++) {
+        FanInConn *c = &t->conns[i];
+        if (c->connected) {
+            if (t->stats.min_conn_messages < 0 || c->messages < t->stats.min_conn_messages) {
+                t->stats.min_conn_messages = c->messages;
+            }
+            if (c->messages > t->stats.max_conn_messages) {
+                t->stats.max_conn_messages = c->messages;
+            }
+        }
+        if (c->fd >= 0) {
+            close(c->fd);
+        }
+    }
+    close(epfd);
+    free(buffer);
+    return NULL;
+}
+
+static inline void fanin_stats_add(FanInStats *total, const FanInStats *s) {
+    total->bytes += s->bytes;
+    total->messages += s->messages;
+    total->connected += s->connected;
+    total->failed += s->failed;
+    total->closed += s->closed;
+    total->wakeups += s->wakeups;
+    total->resumes += s->resumes;
+    if (s->min_conn_messages >= 0 &&
+        (total->min_conn_messages < 0 || s->min_conn_messages < total->min_conn_messages)) {
+        total->min_conn_messages = s->min_conn_messages;
+    }
+    if (s->max_conn_messages > total->max_conn_messages) {
+        total->max_conn_messages = s->max_conn_messages;
+    }
+    latency_hist_merge(&total->latency_ns, &s->latency_ns);
+    latency_hist_merge(&total->connect_ns, &s->connect_ns);
+    if (s->perf_enabled) {
+        perf_sample_add(&total->perf, &s->perf);
+        total->perf_enabled = 1;
+    }
+}
+
+/* Open all connections, receive for the configured duration and merge the
+ * per-thread statistics; returns 0 or -1 */
+static inline int fanin_run(const FanInConfig *config, FanInStats *total) {
+    memset(total, 0, sizeof(*total));
+    total->min_conn_messages = -1;
+
+    if (config->threads < 1 || config->threads > FANIN_MAX_THREADS ||
+        config->connections < config->threads) {
+        fprintf(stderr, "Error: need 1..%d engine threads and at least one connection each\n",
+                FANIN_MAX_THREADS);
+        return -1;
+    }
+    if (fanin_raise_nofile(config->connections) < 0) {
+        return -1;
+    }
+
+    FanInConn *conns = (FanInConn *)calloc(config->connections, sizeof(FanInConn));
+    FanInThread *threads = (FanInThread *)calloc(config->threads, sizeof(FanInThread));
+    if (!conns || !threads) {
+        perror("calloc failed for fan-in connections");
+        free(conns);
+        free(threads);
+        return -1;
+    }
+    for (int i = 0; i < config->connections; i++) {
+        conns[i].fd = -1;
+    }
+
+    long long start = fanin_time_ns();
+    long long end_ns = start + config->duration * 1000000000LL;
+    int started = 0;
+    int first = 0;
+    for (int i = 0; i < config->threads; i++) {
+        FanInThread *t = &threads[i];
+        t->config = config;
+        t->count = config->connections / config->threads +
+                   (i < config->connections % config->threads ? 1 : 0);
+        t->conns = conns + first;
+        t->end_ns = end_ns;
+        first += t->count;
+        if (pthread_create(&t->thread, NULL, fanin_thread_main, t) != 0) {
+            perror("pthread_create failed for fan-in thread");
+            break;
+        }
+        started++;
+    }
+    long long stop = start;
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i].thread, NULL);
+        fanin_stats_add(total, &threads[i].stats);
+        if (threads[i].stop_ns > stop) {
+            stop = threads[i].stop_ns;
+        }
+    }
+    /* Closing thousands of sockets afterwards is not part of the run */
+    total->elapsed_seconds = (stop - start) / 1e9;
+
+    free(conns);
+    free(threads);
+    return started == config->threads ? 0 : -1;
+}
+
+static inline void fanin_print(const FanInConfig *config, const FanInStats *s) {
+    double elapsed = s->elapsed_seconds;
+    printf("\n=== Fan-In Client Statistics ===\n");
+    printf("Connections: %lld of %d established on %d threads, %lld failed, %lld closed early\n",
+           s->connected, config->connections, config->threads, s->failed, s->closed);
+    printf("Total bytes received: %lld\n", s->bytes);
+    printf("Total messages received: %lld\n", s->messages);
+    printf("Elapsed time: %.2f seconds\n", elapsed);
+    printf("Throughput: %.2f Gbps\n", elapsed > 0 ? (s->bytes * 8.0) / (elapsed * 1e9) : 0.0);
+    printf("Messages per connection min/max: %lld / %lld\n",
+           s->min_conn_messages < 0 ? 0 : s->min_conn_messages, s->max_conn_messages);
+    printf("Epoll wakeups: %lld (%.1f connections resumed per wakeup)\n",
+           s->wakeups, s->wakeups ? (double)s->resumes / s->wakeups : 0.0);
+    if (s->connect_ns.samples > 0) {
+        printf("Connect p50/p99/max: %.2f / %.2f / %.2f ms\n",
+               latency_hist_percentile(&s->connect_ns, 50.0) / 1e6,
+               latency_hist_percentile(&s->connect_ns, 99.0) / 1e6,
+               s->connect_ns.max_ns / 1e6);
+    }
+    if (s->latency_ns.samples > 0) {
+        printf("Latency p50/p99/p99.9: %.2f / %.2f / %.2f µs\n",
+               latency_hist_percentile(&s->latency_ns, 50.0) / 1000.0,
+               latency_hist_percentile(&s->latency_ns, 99.0) / 1000.0,
+               latency_hist_percentile(&s->latency_ns, 99.9) / 1000.0);
+    }
+}
+
+static inline void json_fanin(JsonWriter *w, const char *key, const FanInConfig *config,
+                              const FanInStats *s) {
+    json_begin_object(w, key);
+    json_int(w, "connections", config->connections);
+    json_int(w, "threads", config->threads);
+    json_int(w, "connected", s->connected);
+    json_int(w, "failed", s->failed);
+    json_int(w, "closed", s->closed);
+    json_int(w, "min_conn_messages", s->min_conn_messages < 0 ? 0 : s->min_conn_messages);
+    json_int(w, "max_conn_messages", s->max_conn_messages);
+    json_int(w, "epoll_wakeups", s->wakeups);
+    json_double(w, "resumes_per_wakeup", s->wakeups ? (double)s->resumes / s->wakeups : 0.0);
+    json_latency_hist(w, "connect_ns", &s->connect_ns);
+    json_end_object(w);
+}
+
+#endif /* MT25018_COMMON_FANIN_H */
@@ -0,0 +1,297 @@
+/*
+ * MT25018 - Graduate Systems PA02
+ * Common: Per-connection memory accounting
+ * A background thread sums SO_MEMINFO over every registered connection
+ * and reads the process RSS at a fixed interval. It appends one CSV row
+ * per tick with the memory a connection costs: user-space buffers,
+ * reserved thread stack, and kernel socket memory (receive queue, queued
+ * send data, forward allocation). The tick with the most connections is
+ * kept for the summary.
+ */
+
+#ifndef MT25018_COMMON_MEMACCOUNT_H
+#define MT25018_COMMON_MEMACCOUNT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <linux/sock_diag.h>
+
+#include "MT25018_Common_Results.h"
+
+#ifndef SO_MEMINFO
+#define SO_MEMINFO 55
+#endif
+
+/* Connections accounted at once; later ones are not accounted */
+#define MEMACCT_MAX_CONNECTIONS 65536
+
+#define MEMACCT_DEFAULT_INTERVAL_MS 1000
+
+/* One tick, summed over the registered connections */
+typedef struct {
+    double time_sec;
+    int connections;
+    long rss_kb;
+    long long rmem_alloc;               /* bytes in receive queues */
+    long long wmem_queued;              /* bytes queued for sending */
+    long long fwd_alloc;                /* charged but not yet used */
+} MemSample;
+
+typedef struct {
+    FILE *out;
+    int interval_ms;
+    volatile int running;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    struct timespec start;
+    int sockets[MEMACCT_MAX_CONNECTIONS];
+    int num_sockets;
+    long long user_bytes;               /* user-space buffers per connection */
+    size_t stack_bytes;                 /* reserved stack per handler thread */
+    long baseline_rss_kb;
+    MemSample peak;                     /* last tick with the most connections */
+    long long ticks;
+    long long accept_failures;          /* e.g. EMFILE once out of descriptors */
+    long long thread_failures;          /* e.g. EAGAIN once out of threads/memory */
+    int last_accept_error;
+    int last_thread_error;
+} MemAccount;
+
+/* Resident set size of this process in KB (0 if unavailable) */
+static inline long mem_rss_kb(void) {
+    long size = 0, resident = 0;
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (!f) {
+        return 0;
+    }
+    if (fscanf(f, "%ld %ld", &size, &resident) != 2) {
+        resident = 0;
+    }
+    fclose(f);
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+/* Stack size a thread created with default attributes reserves */
+static inline size_t mem_default_stack_bytes(void) {
+    pthread_attr_t attr;
+    size_t size = 0;
+    if (pthread_attr_init(&attr) == 0) {
+        pthread_attr_getstacksize(&attr, &size);
+        pthread_attr_destroy(&attr);
+    }
+    return size;
+}
+
+static inline long long mem_socket_total(const MemSample *m) {
+    return m->rmem_alloc + m->wmem_queued + m->fwd_alloc;
+}
+
+/* Take one tick; caller holds the mutex */
+static inline void mem_account_sample(MemAccount *s) {
+    MemSample m;
+    memset(&m, 0, sizeof(m));
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    m.time_sec = (now.tv_sec - s->start.tv_sec) + (now.tv_nsec - s->start.tv_nsec) / 1e9;
+    m.connections = s->num_sockets;
+    m.rss_kb = mem_rss_kb();
+    for (int i = 0; i < s->num_sockets; i++) {
+        uint32_t info[SK_MEMINFO_VARS];
+        socklen_t len = sizeof(info);
+        memset(info, 0, sizeof(info));
+        if (getsockopt(s->sockets[i], SOL_SOCKET, SO_MEMINFO, info, &len) < 0) {
+            continue;
+        }
+        m.rmem_alloc += info[SK_MEMINFO_RMEM_ALLOC];
+        m.wmem_queued += info[SK_MEMINFO_WMEM_QUEUED];
+        m.fwd_alloc += info[SK_MEMINFO_FWD_ALLOC];
+    }
+
+    fprintf(s->out, "%.3f,%d,%ld,%lld,%lld,%lld,%lld,%lld,%lld\n",
+            m.time_sec, m.connections, m.rss_kb,
+            m.connections * s->user_bytes / 1024,
+            (long long)(m.connections * s->stack_bytes / 1024),
+            m.rmem_alloc / 1024, m.wmem_queued / 1024, m.fwd_alloc / 1024,
+            mem_socket_total(&m) / 1024);
+    fflush(s->out);
+    if (m.connections >= s->peak.connections) {
+        s->peak = m;
+    }
+    s->ticks++;
+}
+
+static inline void *mem_account_main(void *arg) {
+    MemAccount *s = (MemAccount *)arg;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    while (s->running) {
+        /* Absolute deadlines, so the interval does not drift */
+        next.tv_nsec += (long)s->interval_ms * 1000000L;
+        while (next.tv_nsec >= 1000000000L) {
+            next.tv_nsec -= 1000000000L;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+        pthread_mutex_lock(&s->mutex);
+        if (s->running) {
+            mem_account_sample(s);
+        }
+        pthread_mutex_unlock(&s->mutex);
+    }
+    return NULL;
+}
+
+/* Open the CSV and start accounting every interval_ms; user_bytes is the
+ * program's user-space buffer footprint per connection. Returns 0 or -1. */
+static inline int mem_account_start(MemAccount *s, const char *path, int interval_ms,
+                                    long long user_bytes) {
+    memset(s, 0, sizeof(*s));
+    s->interval_ms = interval_ms > 0 ? interval_ms : MEMACCT_DEFAULT_INTERVAL_MS;
+    s->user_bytes = user_bytes;
+    s->stack_bytes = mem_default_stack_bytes();
+    s->baseline_rss_kb = mem_rss_kb();
+    s->out = fopen(path, "w");
+    if (!s->out) {
+        perror("fopen failed for memory accounting");
+        return -1;
+    }
+    fprintf(s->out, "Time_sec,Connections,RSS_KB,UserBuffers_KB,ThreadStacks_KB,"
+                    "SocketRmem_KB,SocketWmemQueued_KB,SocketFwdAlloc_KB,SocketTotal_KB\n");
+    pthread_mutex_init(&s->mutex, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &s->start);
+    s->running = 1;
+    if (pthread_create(&s->thread, NULL, mem_account_main, s) != 0) {
+        perror("pthread_create failed for memory accounting");
+        s->running = 0;
+        fclose(s->out);
+        s->out = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/* Start accounting a connection (no-op when accounting is not running) */
+static inline void mem_account_register(MemAccount *s, int socket) {
+    if (!s->running) {
+        return;
+    }
+    pthread_mutex_lock(&s->mutex);
+    if (s->running && s->num_sockets < MEMACCT_MAX_CONNECTIONS) {
+        s->sockets[s->num_sockets++] = socket;
+    }
+    pthread_mutex_unlock(&s->mutex);
+}
+
+/* Stop accounting a connection; must precede close() */
+static inline void mem_account_unregister(MemAccount *s, int socket) {
+    if (!s->running) {
+        return;
+    }
+    pthread_mutex_lock(&s->mutex);
+    for (int i = 0; i < s->num_sockets; i++) {
+        if (s->sockets[i] == socket) {
+            s->sockets[i] = s->sockets[--s->num_sockets];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&s->mutex);
+}
+
+/* Record a failed accept() or pthread_create() with its error code */
+static inline void mem_account_accept_failed(MemAccount *s, int error) {
+    if (!s->running) {
+        return;
+    }
+    pthread_mutex_lock(&s->mutex);
+    s->accept_failures++;
+    s->last_accept_error = error;
+    pthread_mutex_unlock(&s->mutex);
+}
+
+static inline void mem_account_thread_failed(MemAccount *s, int error) {
+    if (!s->running) {
+        return;
+    }
+    pthread_mutex_lock(&s->mutex);
+    s->thread_failures++;
+    s->last_thread_error = error;
+    pthread_mutex_unlock(&s->mutex);
+}
+
+/* Stop accounting and close the CSV. Like the TCP_INFO sampler, the mutex
+ * stays initialised for handlers that outlive the shutdown wait. */
+static inline void mem_account_stop(MemAccount *s) {
+    if (!s->running) {
+        return;
+    }
+    pthread_mutex_lock(&s->mutex);
+    s->running = 0;
+    pthread_mutex_unlock(&s->mutex);
+    pthread_join(s->thread, NULL);
+    fclose(s->out);
+    s->out = NULL;
+}
+
+/* Process RSS growth over the baseline per connection at the peak */
+static inline double mem_rss_per_conn_kb(const MemAccount *s) {
+    if (s->peak.connections <= 0) {
+        return 0.0;
+    }
+    return (double)(s->peak.rss_kb - s->baseline_rss_kb) / s->peak.connections;
+}
+
+static inline double mem_socket_per_conn_kb(const MemAccount *s) {
+    if (s->peak.connections <= 0) {
+        return 0.0;
+    }
+    return mem_socket_total(&s->peak) / 1024.0 / s->peak.connections;
+}
+
+/* Summary at the peak; max_clients is the program's per-connection
+ * record limit, so the headroom left in it is visible */
+static inline void mem_account_print(const MemAccount *s, int max_clients) {
+    printf("\n=== Memory Accounting ===\n");
+    printf("Peak connections: %d (MAX_CLIENTS %d%s)\n", s->peak.connections, max_clients,
+           s->peak.connections > max_clients ? ", exceeded: later connections are not recorded" : "");
+    printf("User buffers per connection: %lld bytes\n", s->user_bytes);
+    printf("Thread stack per connection: %zu KB reserved\n", s->stack_bytes / 1024);
+    printf("Socket memory per connection: %.1f KB (rmem %lld KB, wmem queued %lld KB, "
+           "fwd alloc %lld KB in total)\n", mem_socket_per_conn_kb(s),
+           s->peak.rmem_alloc / 1024, s->peak.wmem_queued / 1024, s->peak.fwd_alloc / 1024);
+    printf("Process RSS: %ld KB baseline, %ld KB at peak (%.1f KB per connection)\n",
+           s->baseline_rss_kb, s->peak.rss_kb, mem_rss_per_conn_kb(s));
+    if (s->accept_failures > 0) {
+        printf("Failed accepts: %lld (last: %s)\n", s->accept_failures, strerror(s->last_accept_error));
+    }
+    if (s->thread_failures > 0) {
+        printf("Failed handler threads: %lld (last: %s)\n", s->thread_failures,
+               strerror(s->last_thread_error));
+    }
+    printf("Samples: %lld every %d ms\n", s->ticks, s->interval_ms);
+}
+
+static inline void json_mem_account(JsonWriter *w, const char *key, const MemAccount *s) {
+    json_begin_object(w, key);
+    json_int(w, "peak_connections", s->peak.connections);
+    json_int(w, "user_bytes_per_conn", s->user_bytes);
+    json_int(w, "stack_bytes_per_thread", (long long)s->stack_bytes);
+    json_double(w, "socket_kb_per_conn", mem_socket_per_conn_kb(s));
+    json_int(w, "socket_rmem_bytes", s->peak.rmem_alloc);
+    json_int(w, "socket_wmem_queued_bytes", s->peak.wmem_queued);
+    json_int(w, "socket_fwd_alloc_bytes", s->peak.fwd_alloc);
+    json_int(w, "rss_baseline_kb", s->baseline_rss_kb);
+    json_int(w, "rss_peak_kb", s->peak.rss_kb);
+    json_double(w, "rss_kb_per_conn", mem_rss_per_conn_kb(s));
+    json_int(w, "accept_failures", s->accept_failures);
+    json_int(w, "thread_failures", s->thread_failures);
+    json_end_object(w);
+}
+
+#endif /* MT25018_COMMON_MEMACCOUNT_H */
@@ -0,0 +1,367 @@
+/*
+ * MT25018 - Graduate Systems PA02
+ * Common: Live metrics endpoint (Prometheus text format)
+ * A loopback HTTP responder thread serves the current counters on every
+ * request. Each sending/receiving thread owns a MetricsSlot and updates it
+ * with relaxed atomic stores (it is the only writer), so the hot path never
+ * takes a lock; the responder reads the slots with relaxed atomic loads.
+ * A client's latency histogram is exported too; while a slot exposes it,
+ * it is recorded and reset through metrics_latency_record/_reset, which
+ * update it with relaxed atomic operations.
+ */
+
+#ifndef MT25018_COMMON_METRICS_H
+#define MT25018_COMMON_METRICS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <poll.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "MT25018_Common_Results.h"
+
+#define METRICS_MAX_SLOTS 1024
+
+/* Latency histogram buckets exported as le = 2^k ns */
+#define METRICS_LATENCY_MIN_SHIFT 10            /* ~1 µs */
+#define METRICS_LATENCY_MAX_SHIFT 34            /* ~17 s */
+
+#define METRICS_LOAD(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#define METRICS_STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define METRICS_ADD(p, v) __atomic_fetch_add((p), (v), __ATOMIC_RELAXED)
+
+/* Counters of one thread; written only by that thread */
+typedef struct {
+    int active;
+    int thread_id;
+    unsigned long long bytes;
+    unsigned long long messages;
+    unsigned long long zc_completed;     /* MSG_ZEROCOPY sends reported done */
+    unsigned long long zc_copied;        /* ... of which the kernel copied */
+    const LatencyHistogram *latency;     /* client receive latency, or NULL */
+} MetricsSlot;
+
+typedef struct {
+    int enabled;
+    int listen_socket;
+    volatile int running;
+    pthread_t thread;
+    const char *role;
+    const char *transport;
+    int zerocopy;
+    struct timespec start;
+    /* Slot claiming and retirement only; never taken per message */
+    pthread_mutex_t slot_mutex;
+    MetricsSlot slots[METRICS_MAX_SLOTS];
+    int num_slots;
+    long long connections;
+    /* Totals of retired slots */
+    unsigned long long done_bytes;
+    unsigned long long done_messages;
+    unsigned long long done_zc_completed;
+    unsigned long long done_zc_copied;
+    LatencyHistogram done_latency;
+    /* Previous scrape, for the throughput gauge */
+    unsigned long long last_bytes;
+    double last_sec;
+} MetricsExporter;
+
+static inline double metrics_elapsed_sec(const MetricsExporter *m) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - m->start.tv_sec) + (now.tv_nsec - m->start.tv_nsec) / 1e9;
+}
+
+/* Claim a slot for the calling thread; NULL when metrics are disabled */
+static inline MetricsSlot *metrics_slot_acquire(MetricsExporter *m, int thread_id,
+                                                const LatencyHistogram *latency) {
+    if (!m->enabled) {
+        return NULL;
+    }
+    MetricsSlot *slot = NULL;
+    pthread_mutex_lock(&m->slot_mutex);
+    for (int i = 0; i < METRICS_MAX_SLOTS; i++) {
+        if (!m->slots[i].active) {
+            slot = &m->slots[i];
+            memset(slot, 0, sizeof(*slot));
+            slot->thread_id = thread_id;
+            slot->latency = latency;
+            METRICS_STORE(&slot->active, 1);
+            if (i >= m->num_slots) {
+                m->num_slots = i + 1;
+            }
+            m->connections++;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&m->slot_mutex);
+    return slot;
+}
+
+/* Hot path: count one message (single writer, no lock) */
+static inline void metrics_slot_add(MetricsSlot *slot, long long bytes) {
+    if (slot) {
+        METRICS_STORE(&slot->bytes, slot->bytes + bytes);
+        METRICS_STORE(&slot->messages, slot->messages + 1);
+    }
+}
+
+static inline void metrics_slot_zerocopy(MetricsSlot *slot, unsigned long long completed,
+                                         unsigned long long copied) {
+    if (slot) {
+        METRICS_STORE(&slot->zc_completed, slot->zc_completed + completed);
+        METRICS_STORE(&slot->zc_copied, slot->zc_copied + copied);
+    }
+}
+
+/* Hot path: record one latency into h, which slot exports (if any) */
+static inline void metrics_latency_record(MetricsSlot *slot, LatencyHistogram *h, uint64_t ns) {
+    if (!slot) {
+        latency_hist_record(h, ns);
+        return;
+    }
+    METRICS_ADD(&h->counts[latency_hist_index(ns)], 1);
+    METRICS_ADD(&h->samples, 1);
+    METRICS_ADD(&h->sum_ns, ns);
+    if (ns > h->max_ns) {
+        METRICS_STORE(&h->max_ns, ns);
+    }
+}
+
+/* Clear h while the responder may be reading it through slot */
+static inline void metrics_latency_reset(MetricsSlot *slot, LatencyHistogram *h) {
+    if (!slot) {
+        memset(h, 0, sizeof(*h));
+        return;
+    }
+    for (int b = 0; b < LATENCY_HIST_BUCKETS; b++) {
+        METRICS_STORE(&h->counts[b], 0);
+    }
+    METRICS_STORE(&h->samples, 0);
+    METRICS_STORE(&h->sum_ns, 0);
+    METRICS_STORE(&h->max_ns, 0);
+}
+
+/* Fold a finished thread's counters into the totals and free its slot */
+static inline void metrics_slot_release(MetricsExporter *m, MetricsSlot *slot) {
+    if (!slot) {
+        return;
+    }
+    pthread_mutex_lock(&m->slot_mutex);
+    m->done_bytes += slot->bytes;
+    m->done_messages += slot->messages;
+    m->done_zc_completed += slot->zc_completed;
+    m->done_zc_copied += slot->zc_copied;
+    if (slot->latency) {
+        latency_hist_merge(&m->done_latency, slot->latency);
+    }
+    METRICS_STORE(&slot->active, 0);
+    pthread_mutex_unlock(&m->slot_mutex);
+}
+
+static inline void metrics_counter(FILE *out, const MetricsExporter *m, const char *name,
+                                   const char *type, const char *help, double value) {
+    fprintf(out, "# HELP mt25018_%s %s\n# TYPE mt25018_%s %s\n", name, help, name, type);
+    fprintf(out, "mt25018_%s{role=\"%s\",transport=\"%s\"} %.15g\n",
+            name, m->role, m->transport, value);
+}
+
+/* Render the exposition text; slots are read without stopping their writers */
+static inline void metrics_render(MetricsExporter *m, FILE *out) {
+    unsigned long long bytes, messages, zc_completed, zc_copied;
+    int active = 0;
+    long long connections;
+    LatencyHistogram *latency = (LatencyHistogram *)calloc(1, sizeof(LatencyHistogram));
+    int have_latency = 0;
+
+    pthread_mutex_lock(&m->slot_mutex);
+    bytes = m->done_bytes;
+    messages = m->done_messages;
+    zc_completed = m->done_zc_completed;
+    zc_copied = m->done_zc_copied;
+    connections = m->connections;
+    if (latency) {
+        *latency = m->done_latency;
+        have_latency = latency->samples > 0;
+    }
+    for (int i = 0; i < m->num_slots; i++) {
+        MetricsSlot *s = &m->slots[i];
+        if (!METRICS_LOAD(&s->active)) {
+            continue;
+        }
+        active++;
+        bytes += METRICS_LOAD(&s->bytes);
+        messages += METRICS_LOAD(&s->messages);
+        zc_completed += METRICS_LOAD(&s->zc_completed);
+        zc_copied += METRICS_LOAD(&s->zc_copied);
+        if (s->latency && latency) {
+            for (int b = 0; b < LATENCY_HIST_BUCKETS; b++) {
+                latency->counts[b] += METRICS_LOAD(&s->latency->counts[b]);
+            }
+            latency->sum_ns += METRICS_LOAD(&s->latency->sum_ns);
+            have_latency = 1;
+        }
+    }
+    pthread_mutex_unlock(&m->slot_mutex);
+
+    double now = metrics_elapsed_sec(m);
+    double interval = now - m->last_sec;
+    double gbps = interval > 0 ? (bytes - m->last_bytes) * 8.0 / (interval * 1e9) : 0.0;
+    m->last_bytes = bytes;
+    m->last_sec = now;
+
+    metrics_counter(out, m, "uptime_seconds", "gauge", "Seconds since start", now);
+    metrics_counter(out, m, "bytes_total", "counter", "Payload bytes transferred", (double)bytes);
+    metrics_counter(out, m, "messages_total", "counter", "Messages transferred", (double)messages);
+    metrics_counter(out, m, "throughput_gbps", "gauge",
+                    "Throughput since the previous scrape", gbps);
+    metrics_counter(out, m, "connections_active", "gauge", "Open connections", active);
+    metrics_counter(out, m, "connections_total", "counter", "Connections handled",
+                    (double)connections);
+    if (m->zerocopy) {
+        metrics_counter(out, m, "zerocopy_completed_total", "counter",
+                        "MSG_ZEROCOPY sends completed by the kernel", (double)zc_completed);
+        metrics_counter(out, m, "zerocopy_copied_total", "counter",
+                        "MSG_ZEROCOPY sends the kernel fell back to copying", (double)zc_copied);
+    }
+
+    if (have_latency) {
+        const char *name = "mt25018_message_latency_seconds";
+        fprintf(out, "# HELP %s Time to receive one message\n# TYPE %s histogram\n", name, name);
+        unsigned long long cumulative = 0;
+        int bucket = 0;
+        for (int shift = METRICS_LATENCY_MIN_SHIFT; shift <= METRICS_LATENCY_MAX_SHIFT; shift++) {
+            /* Buckets below index(2^shift) hold values < 2^shift */
+            int limit = latency_hist_index(1ULL << shift);
+            for (; bucket < limit; bucket++) {
+                cumulative += latency->counts[bucket];
+            }
+            fprintf(out, "%s_bucket{role=\"%s\",transport=\"%s\",le=\"%.9f\"} %llu\n",
+                    name, m->role, m->transport, (double)(1ULL << shift) / 1e9, cumulative);
+        }
+        /* +Inf and _count use the bucket total, which stays consistent
+         * with the buckets while the writer keeps recording */
+        for (; bucket < LATENCY_HIST_BUCKETS; bucket++) {
+            cumulative += latency->counts[bucket];
+        }
+        fprintf(out, "%s_bucket{role=\"%s\",transport=\"%s\",le=\"+Inf\"} %llu\n",
+                name, m->role, m->transport, cumulative);
+        fprintf(out, "%s_sum{role=\"%s\",transport=\"%s\"} %.9f\n",
+                name, m->role, m->transport, latency->sum_ns / 1e9);
+        fprintf(out, "%s_count{role=\"%s\",transport=\"%s\"} %llu\n",
+                name, m->role, m->transport, cumulative);
+    }
+    free(latency);
+}
+
+/* Answer one HTTP request (any path) with the current metrics */
+static inline void metrics_serve(MetricsExporter *m, int conn) {
+    char request[1024];
+    struct timeval timeout = {1, 0};
+    setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    if (recv(conn, request, sizeof(request), 0) <= 0) {
+        return;
+    }
+
+    char *body = NULL;
+    size_t body_len = 0;
+    FILE *out = open_memstream(&body, &body_len);
+    if (!out) {
+        return;
+    }
+    metrics_render(m, out);
+    fclose(out);
+
+    char header[160];
+    int header_len = snprintf(header, sizeof(header),
+                              "HTTP/1.0 200 OK\r\n"
+                              "Content-Type: text/plain; version=0.0.4\r\n"
+                              "Content-Length: %zu\r\n\r\n", body_len);
+    if (send(conn, header, header_len, MSG_NOSIGNAL) == header_len) {
+        size_t sent = 0;
+        while (sent < body_len) {
+            ssize_t n = send(conn, body + sent, body_len - sent, MSG_NOSIGNAL);
+            if (n <= 0) {
+                break;
+            }
+            sent += n;
+        }
+    }
+    free(body);
+}
+
+static inline void *metrics_main(void *arg) {
+    MetricsExporter *m = (MetricsExporter *)arg;
+    struct pollfd pfd = {m->listen_socket, POLLIN, 0};
+    while (m->running) {
+        /* Wake up regularly to notice metrics_stop() */
+        if (poll(&pfd, 1, 200) <= 0) {
+            continue;
+        }
+        int conn = accept(m->listen_socket, NULL, NULL);
+        if (conn < 0) {
+            continue;
+        }
+        metrics_serve(m, conn);
+        close(conn);
+    }
+    return NULL;
+}
+
+/* Listen on 127.0.0.1:port and serve metrics; returns 0 or -1 */
+static inline int metrics_start(MetricsExporter *m, int port, const char *role,
+                                const char *transport, int zerocopy) {
+    memset(m, 0, sizeof(*m));
+    m->role = role;
+    m->transport = transport;
+    m->zerocopy = zerocopy;
+    pthread_mutex_init(&m->slot_mutex, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &m->start);
+
+    m->listen_socket = socket(AF_INET, SOCK_STREAM, 0);
+    if (m->listen_socket < 0) {
+        perror("socket failed for metrics");
+        return -1;
+    }
+    int opt = 1;
+    setsockopt(m->listen_socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (bind(m->listen_socket, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(m->listen_socket, 16) < 0) {
+        perror("bind/listen failed for metrics");
+        close(m->listen_socket);
+        return -1;
+    }
+
+    m->running = 1;
+    if (pthread_create(&m->thread, NULL, metrics_main, m) != 0) {
+        perror("pthread_create failed for metrics");
+        m->running = 0;
+        close(m->listen_socket);
+        return -1;
+    }
+    m->enabled = 1;
+    printf("Metrics: http://127.0.0.1:%d/metrics\n", port);
+    return 0;
+}
+
+/* Stop serving; slots stay valid for threads that are still running */
+static inline void metrics_stop(MetricsExporter *m) {
+    if (!m->running) {
+        return;
+    }
+    m->running = 0;
+    pthread_join(m->thread, NULL);
+    close(m->listen_socket);
+}
+
+#endif /* MT25018_COMMON_METRICS_H */
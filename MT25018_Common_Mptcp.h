@@ -0,0 +1,113 @@
+/*
+ * MT25018 - Graduate Systems PA02
+ * Common: Multipath TCP
+ * With --mptcp, servers listen and clients connect with IPPROTO_MPTCP.
+ * The path manager opens extra subflows over the addresses the server
+ * announces (MPTCP endpoints set up by the experiment script), and the
+ * transports stay unchanged. The number of subflows each connection
+ * reached is sampled with MPTCP_INFO; 0 means it fell back to plain TCP.
+ */
+
+#ifndef MT25018_COMMON_MPTCP_H
+#define MT25018_COMMON_MPTCP_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "MT25018_Common_Results.h"
+
+#ifndef IPPROTO_MPTCP
+#define IPPROTO_MPTCP 262
+#endif
+
+#ifndef SOL_MPTCP
+#define SOL_MPTCP 284
+#endif
+
+#define MPTCP_INFO_OPT 1
+#define MPTCP_INFO_FALLBACK 0x1
+
+/* Leading part of the kernel's struct mptcp_info (linux/mptcp.h) */
+typedef struct {
+    uint8_t subflows;                   /* subflows beyond the initial one */
+    uint8_t add_addr_signal;
+    uint8_t add_addr_accepted;
+    uint8_t subflows_max;
+    uint8_t add_addr_signal_max;
+    uint8_t add_addr_accepted_max;
+    uint32_t flags;
+    uint32_t token;
+    uint64_t write_seq;
+    uint64_t snd_una;
+    uint64_t rcv_nxt;
+} MptcpInfoRaw;
+
+typedef struct {
+    long long connections;
+    long long fallbacks;
+    long long subflows;                 /* summed over MPTCP connections */
+    int max_subflows;
+} MptcpStats;
+
+/* Stream socket: MPTCP when asked and the kernel allows it, else TCP */
+static inline int mptcp_stream_socket(int mptcp) {
+    if (mptcp) {
+        int s = socket(AF_INET, SOCK_STREAM, IPPROTO_MPTCP);
+        if (s >= 0) {
+            return s;
+        }
+        fprintf(stderr, "Warning: MPTCP not available (%s), using TCP\n", strerror(errno));
+    }
+    return socket(AF_INET, SOCK_STREAM, 0);
+}
+
+/* Subflows of a connection including the initial one; 0 for plain TCP */
+static inline int mptcp_subflows(int socket) {
+    MptcpInfoRaw info;
+    socklen_t len = sizeof(info);
+    memset(&info, 0, sizeof(info));
+    if (getsockopt(socket, SOL_MPTCP, MPTCP_INFO_OPT, &info, &len) < 0 ||
+        (info.flags & MPTCP_INFO_FALLBACK)) {
+        return 0;
+    }
+    return info.subflows + 1;
+}
+
+/* Record one connection by the most subflows it was seen with */
+static inline void mptcp_stats_add(MptcpStats *s, int subflows) {
+    s->connections++;
+    if (subflows <= 0) {
+        s->fallbacks++;
+        return;
+    }
+    s->subflows += subflows;
+    if (subflows > s->max_subflows) {
+        s->max_subflows = subflows;
+    }
+}
+
+static inline double mptcp_avg_subflows(const MptcpStats *s) {
+    long long multipath = s->connections - s->fallbacks;
+    return multipath > 0 ? (double)s->subflows / multipath : 0.0;
+}
+
+static inline void mptcp_print(const MptcpStats *s) {
+    printf("\n=== MPTCP ===\n");
+    printf("Connections: %lld (%lld fell back to TCP)\n", s->connections, s->fallbacks);
+    printf("Subflows per connection: avg %.2f, max %d\n", mptcp_avg_subflows(s), s->max_subflows);
+}
+
+static inline void json_mptcp(JsonWriter *w, const char *key, const MptcpStats *s) {
+    json_begin_object(w, key);
+    json_int(w, "connections", s->connections);
+    json_int(w, "fallbacks", s->fallbacks);
+    json_double(w, "avg_subflows", mptcp_avg_subflows(s));
+    json_int(w, "max_subflows", s->max_subflows);
+    json_end_object(w);
+}
+
+#endif /* MT25018_COMMON_MPTCP_H */
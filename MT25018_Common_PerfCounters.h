@@ -0,0 +1,230 @@
+/*
+ * MT25018 - Graduate Systems PA02
+ * Common: In-process hardware counters via perf_event_open()
+ * Counters are opened per thread (pid=0, cpu=-1) and enabled only around
+ * the steady-state send/recv loop, so accept/setup/teardown are excluded
+ */
+
+#ifndef MT25018_COMMON_PERFCOUNTERS_H
+#define MT25018_COMMON_PERFCOUNTERS_H
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+/* Events collected per thread (same set the old perf stat wrapper used) */
+enum {
+    PERF_EV_CYCLES,
+    PERF_EV_INSTRUCTIONS,
+    PERF_EV_CACHE_MISSES,
+    PERF_EV_L1D_MISSES,
+    PERF_EV_LLC_MISSES,
+    PERF_EV_CONTEXT_SWITCHES,
+    PERF_NUM_EVENTS
+};
+
+/* Open counter file descriptors for one thread */
+typedef struct {
+    int fds[PERF_NUM_EVENTS];
+    int leader_fd;
+} PerfCounters;
+
+/* Counter values read after the measured region */
+typedef struct {
+    unsigned long long values[PERF_NUM_EVENTS];
+    int supported[PERF_NUM_EVENTS];
+} PerfSample;
+
+/* Value layout returned by read() with the read_format below */
+typedef struct {
+    unsigned long long value;
+    unsigned long long time_enabled;
+    unsigned long long time_running;
+} PerfReadValue;
+
+static const char *perf_event_labels[PERF_NUM_EVENTS] = {
+    "Cycles",
+    "Instructions",
+    "Cache misses",
+    "L1D load misses",
+    "LLC load misses",
+    "Context switches"
+};
+
+static inline int perf_event_open_fd(struct perf_event_attr *attr, int group_fd) {
+    return (int)syscall(SYS_perf_event_open, attr, 0, -1, group_fd, 0);
+}
+
+/* Fill perf_event_attr for one of the events above */
+static inline void perf_event_setup_attr(struct perf_event_attr *attr, int event) {
+    memset(attr, 0, sizeof(*attr));
+    attr->size = sizeof(*attr);
+    attr->disabled = 1;
+    attr->exclude_hv = 1;
+    attr->read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    switch (event) {
+    case PERF_EV_CYCLES:
+        attr->type = PERF_TYPE_HARDWARE;
+        attr->config = PERF_COUNT_HW_CPU_CYCLES;
+        break;
+    case PERF_EV_INSTRUCTIONS:
+        attr->type = PERF_TYPE_HARDWARE;
+        attr->config = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+    case PERF_EV_CACHE_MISSES:
+        attr->type = PERF_TYPE_HARDWARE;
+        attr->config = PERF_COUNT_HW_CACHE_MISSES;
+        break;
+    case PERF_EV_L1D_MISSES:
+        attr->type = PERF_TYPE_HW_CACHE;
+        attr->config = PERF_COUNT_HW_CACHE_L1D |
+                       (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                       (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        break;
+    case PERF_EV_LLC_MISSES:
+        attr->type = PERF_TYPE_HW_CACHE;
+        attr->config = PERF_COUNT_HW_CACHE_LL |
+                       (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                       (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        break;
+    case PERF_EV_CONTEXT_SWITCHES:
+        attr->type = PERF_TYPE_SOFTWARE;
+        attr->config = PERF_COUNT_SW_CONTEXT_SWITCHES;
+        break;
+    }
+}
+
+/* Open all counters for the calling thread as one group
+ * The first event that opens becomes the group leader; events the CPU or
+ * kernel cannot group (or cannot count at all) are opened standalone or
+ * left unsupported. Returns the number of events opened.
+ */
+static inline int perf_counters_open(PerfCounters *pc) {
+    struct perf_event_attr attr;
+    int opened = 0;
+
+    pc->leader_fd = -1;
+    for (int i = 0; i < PERF_NUM_EVENTS; i++) {
+        perf_event_setup_attr(&attr, i);
+
+        int fd = perf_event_open_fd(&attr, pc->leader_fd);
+        if (fd < 0 && pc->leader_fd >= 0) {
+            /* Could not join the group - count it on its own */
+            fd = perf_event_open_fd(&attr, -1);
+        } else if (fd >= 0 && pc->leader_fd < 0) {
+            pc->leader_fd = fd;
+        }
+
+        pc->fds[i] = fd;
+        if (fd >= 0) {
+            opened++;
+        }
+    }
+
+    return opened;
+}
+
+/* Reset and enable counters at the start of the measured region */
+static inline void perf_counters_start(PerfCounters *pc) {
+    for (int i = 0; i < PERF_NUM_EVENTS; i++) {
+        if (pc->fds[i] >= 0) {
+            ioctl(pc->fds[i], PERF_EVENT_IOC_RESET, 0);
+        }
+    }
+    for (int i = 0; i < PERF_NUM_EVENTS; i++) {
+        if (pc->fds[i] >= 0) {
+            ioctl(pc->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+/* Disable counters at the end of the measured region */
+static inline void perf_counters_stop(PerfCounters *pc) {
+    for (int i = 0; i < PERF_NUM_EVENTS; i++) {
+        if (pc->fds[i] >= 0) {
+            ioctl(pc->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+}
+
+/* Read counters, scaling for multiplexing when the PMU was oversubscribed */
+static inline void perf_counters_read(PerfCounters *pc, PerfSample *sample) {
+    memset(sample, 0, sizeof(*sample));
+
+    for (int i = 0; i < PERF_NUM_EVENTS; i++) {
+        PerfReadValue rv;
+        if (pc->fds[i] < 0 || read(pc->fds[i], &rv, sizeof(rv)) != sizeof(rv)) {
+            continue;
+        }
+
+        sample->supported[i] = 1;
+        if (rv.time_running > 0 && rv.time_running < rv.time_enabled) {
+            sample->values[i] = (unsigned long long)
+                ((double)rv.value * rv.time_enabled / rv.time_running);
+        } else {
+            sample->values[i] = rv.value;
+        }
+    }
+}
+
+static inline void perf_counters_close(PerfCounters *pc) {
+    for (int i = 0; i < PERF_NUM_EVENTS; i++) {
+        if (pc->fds[i] >= 0) {
+            close(pc->fds[i]);
+            pc->fds[i] = -1;
+        }
+    }
+    pc->leader_fd = -1;
+}
+
+/* Accumulate a per-thread sample into an aggregate */
+static inline void perf_sample_add(PerfSample *total, const PerfSample *sample) {
+    for (int i = 0; i < PERF_NUM_EVENTS; i++) {
+        if (sample->supported[i]) {
+            total->values[i] += sample->values[i];
+            total->supported[i] = 1;
+        }
+    }
+}
+
+static inline double perf_sample_ipc(const PerfSample *s) {
+    if (!s->supported[PERF_EV_CYCLES] || !s->supported[PERF_EV_INSTRUCTIONS] ||
+        s->values[PERF_EV_CYCLES] == 0) {
+        return 0.0;
+    }
+    return (double)s->values[PERF_EV_INSTRUCTIONS] / s->values[PERF_EV_CYCLES];
+}
+
+static inline double perf_sample_cycles_per_byte(const PerfSample *s, long long bytes) {
+    if (!s->supported[PERF_EV_CYCLES] || bytes <= 0) {
+        return 0.0;
+    }
+    return (double)s->values[PERF_EV_CYCLES] / bytes;
+}
+
+/* One-line summary used in per-thread log output */
+static inline void perf_sample_print_brief(const char *prefix, const PerfSample *s, long long bytes) {
+    printf("%s Perf: cycles=%llu instructions=%llu IPC=%.2f cycles/byte=%.2f\n",
+           prefix, s->values[PERF_EV_CYCLES], s->values[PERF_EV_INSTRUCTIONS],
+           perf_sample_ipc(s), perf_sample_cycles_per_byte(s, bytes));
+}
+
+/* Full report; unsupported events are printed as n/a */
+static inline void perf_sample_print(const char *title, const PerfSample *s, long long bytes) {
+    printf("\n=== %s ===\n", title);
+    for (int i = 0; i < PERF_NUM_EVENTS; i++) {
+        if (s->supported[i]) {
+            printf("%s: %llu\n", perf_event_labels[i], s->values[i]);
+        } else {
+            printf("%s: n/a\n", perf_event_labels[i]);
+        }
+    }
+    printf("IPC: %.3f\n", perf_sample_ipc(s));
+    printf("Cycles per byte: %.3f\n", perf_sample_cycles_per_byte(s, bytes));
+}
+
+#endif /* MT25018_COMMON_PERFCOUNTERS_H */
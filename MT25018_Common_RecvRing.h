@@ -0,0 +1,149 @@
+/*
+ * MT25018 - Graduate Systems PA02
+ * Common: Double-mapped receive ring with in-place message parsing
+ * One memfd is mapped twice back to back, so the bytes at
+ * [offset, offset + capacity) are always contiguous in memory, even when
+ * they wrap around the end of the ring. The receiver reads as much as the
+ * socket has into the free space with one recv(), then hands out pointers
+ * to the fields of each complete message without copying them.
+ */
+
+#ifndef MT25018_COMMON_RECVRING_H
+#define MT25018_COMMON_RECVRING_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+
+#include "MT25018_Common_SyscallProbe.h"
+
+/* Smallest ring; it also holds at least RECV_RING_MIN_MESSAGES messages */
+#define RECV_RING_MIN_BYTES (256 * 1024)
+#define RECV_RING_MIN_MESSAGES 4
+
+typedef struct {
+    char *base;                     /* first of the two mappings */
+    size_t capacity;
+    size_t head;                    /* offset of the next unparsed byte, < capacity */
+    size_t used;                    /* received but not yet parsed bytes */
+    int fd;
+    unsigned long long syscalls;
+    unsigned long long bytes;
+    unsigned long long messages;
+    unsigned long long framing_errors;
+} RecvRing;
+
+static inline void recv_ring_destroy(RecvRing *ring) {
+    if (ring->base) {
+        munmap(ring->base, 2 * ring->capacity);
+    }
+    if (ring->fd >= 0) {
+        close(ring->fd);
+    }
+    ring->base = NULL;
+    ring->fd = -1;
+}
+
+/* Create a ring for messages of message_size bytes; returns 0 or -1 */
+static inline int recv_ring_init(RecvRing *ring, size_t message_size) {
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t capacity = message_size * RECV_RING_MIN_MESSAGES;
+    if (capacity < RECV_RING_MIN_BYTES) {
+        capacity = RECV_RING_MIN_BYTES;
+    }
+    capacity = (capacity + page - 1) / page * page;
+
+    ring->fd = (int)syscall(SYS_memfd_create, "mt25018_recv_ring", 0);
+    if (ring->fd < 0) {
+        perror("memfd_create failed");
+        return -1;
+    }
+    if (ftruncate(ring->fd, capacity) < 0) {
+        perror("ftruncate failed");
+        recv_ring_destroy(ring);
+        return -1;
+    }
+
+    /* Reserve 2x the address space, then map the memfd into both halves */
+    void *base = mmap(NULL, 2 * capacity, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        perror("mmap reserve failed");
+        recv_ring_destroy(ring);
+        return -1;
+    }
+    ring->base = (char *)base;
+    ring->capacity = capacity;
+
+    for (int half = 0; half < 2; half++) {
+        void *want = ring->base + half * capacity;
+        void *got = mmap(want, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+                         ring->fd, 0);
+        if (got != want) {
+            perror("mmap ring half failed");
+            recv_ring_destroy(ring);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Drop buffered bytes (the connection they came from is gone) */
+static inline void recv_ring_reset(RecvRing *ring) {
+    ring->head = 0;
+    ring->used = 0;
+}
+
+/* One recv() into all free space; returns bytes read, 0 on EOF, -1 on error */
+static inline ssize_t recv_ring_fill(RecvRing *ring, int socket, SyscallProbe *probe) {
+    size_t tail = (ring->head + ring->used) % ring->capacity;
+    size_t free_bytes = ring->capacity - ring->used;
+
+    uint64_t t0 = syscall_probe_begin(probe);
+    ssize_t n = recv(socket, ring->base + tail, free_bytes, 0);
+    syscall_probe_end(probe, PROBE_SLOT_MESSAGE, t0, n, free_bytes);
+    ring->syscalls++;
+    if (n > 0) {
+        ring->used += n;
+        ring->bytes += n;
+    }
+    return n;
+}
+
+/* Parse the next message in place
+ * Points fields[i] at each of the num_fields fields inside the ring; the
+ * pointers stay valid until the next call. Every field is a NUL-terminated
+ * string of field_size bytes, so a missing terminator is a framing error.
+ * Returns the message size, or -1 when the connection ends.
+ */
+static inline int recv_ring_next_message(RecvRing *ring, int socket, int num_fields,
+                                         int field_size, const char **fields,
+                                         SyscallProbe *probe) {
+    size_t message_size = (size_t)num_fields * field_size;
+    while (ring->used < message_size) {
+        if (recv_ring_fill(ring, socket, probe) <= 0) {
+            return -1;
+        }
+    }
+
+    const char *message = ring->base + ring->head;
+    for (int i = 0; i < num_fields; i++) {
+        fields[i] = message + (size_t)i * field_size;
+        if (fields[i][field_size - 1] != '\0') {
+            ring->framing_errors++;
+        }
+    }
+
+    ring->head = (ring->head + message_size) % ring->capacity;
+    ring->used -= message_size;
+    ring->messages++;
+    return (int)message_size;
+}
+
+#endif /* MT25018_COMMON_RECVRING_H */
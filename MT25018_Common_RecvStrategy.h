@@ -0,0 +1,266 @@
+/*
+ * MT25018 - Graduate Systems PA02
+ * Common: Selectable client receive strategies
+ * Lets every client vary how it receives, independently of how the server
+ * sends:
+ *   native  - the transport's own receive function (default)
+ *   field   - one recv() loop per field
+ *   waitall - one recv(MSG_WAITALL) per message into a single buffer
+ *   bulk    - fixed-size recv() reads, messages counted from the byte stream
+ *   iovec   - one recvmsg(MSG_WAITALL) per message, one iovec per field
+ *   ring    - bulk reads into the double-mapped ring, parsed in place
+ * The receiver counts its own syscalls, so syscalls per message and bytes
+ * per syscall can be compared across strategies.
+ */
+
+#ifndef MT25018_COMMON_RECVSTRATEGY_H
+#define MT25018_COMMON_RECVSTRATEGY_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "MT25018_Common_Results.h"
+#include "MT25018_Common_SyscallProbe.h"
+#include "MT25018_Common_RecvRing.h"
+
+typedef enum {
+    RECV_NATIVE,
+    RECV_FIELD,
+    RECV_WAITALL,
+    RECV_BULK,
+    RECV_IOVEC,
+    RECV_RING,
+    RECV_NUM_STRATEGIES
+} RecvStrategy;
+
+static const char *recv_strategy_names[RECV_NUM_STRATEGIES] = {
+    "native", "field", "waitall", "bulk", "iovec", "ring"
+};
+
+/* Read size of the bulk strategy (at least one message) */
+#define RECV_BULK_BYTES (64 * 1024)
+
+#define RECV_MAX_FIELDS 8
+
+typedef struct {
+    RecvStrategy strategy;
+    int num_fields;
+    int field_size;
+    size_t message_size;
+    char *buffer;                   /* message (field/waitall/iovec) or bulk chunk */
+    size_t buffer_size;
+    size_t pending;                 /* bulk: received bytes not yet counted */
+    RecvRing ring;
+    const char *fields[RECV_MAX_FIELDS];
+    unsigned long long syscalls;
+    unsigned long long bytes;
+    unsigned long long messages;
+} MessageReceiver;
+
+/* Strategy for a name, or -1 if unknown */
+static inline int recv_strategy_parse(const char *name) {
+    for (int i = 0; i < RECV_NUM_STRATEGIES; i++) {
+        if (strcmp(name, recv_strategy_names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* Set up a receiver for any strategy except RECV_NATIVE; returns 0 or -1 */
+static inline int receiver_init(MessageReceiver *r, RecvStrategy strategy, int num_fields,
+                                int field_size) {
+    memset(r, 0, sizeof(*r));
+    r->strategy = strategy;
+    r->num_fields = num_fields;
+    r->field_size = field_size;
+    r->message_size = (size_t)num_fields * field_size;
+
+    if (strategy == RECV_RING) {
+        return recv_ring_init(&r->ring, r->message_size);
+    }
+
+    r->buffer_size = r->message_size;
+    if (strategy == RECV_BULK && r->buffer_size < RECV_BULK_BYTES) {
+        r->buffer_size = RECV_BULK_BYTES;
+    }
+    r->buffer = (char *)malloc(r->buffer_size);
+    if (!r->buffer) {
+        perror("malloc failed for receive buffer");
+        return -1;
+    }
+    return 0;
+}
+
+static inline void receiver_destroy(MessageReceiver *r) {
+    if (r->strategy == RECV_RING) {
+        recv_ring_destroy(&r->ring);
+    }
+    free(r->buffer);
+    r->buffer = NULL;
+}
+
+/* Forget buffered bytes of a closed connection */
+static inline void receiver_reset(MessageReceiver *r) {
+    r->pending = 0;
+    if (r->strategy == RECV_RING) {
+        recv_ring_reset(&r->ring);
+    }
+}
+
+/* One counted recv(); returns bytes or -1 when the connection ends */
+static inline ssize_t receiver_recv(MessageReceiver *r, int socket, char *buf, size_t len,
+                                    int flags, int slot, SyscallProbe *probe) {
+    uint64_t t0 = syscall_probe_begin(probe);
+    ssize_t n = recv(socket, buf, len, flags);
+    syscall_probe_end(probe, slot, t0, n, len);
+    r->syscalls++;
+    if (n <= 0) {
+        return -1;
+    }
+    r->bytes += n;
+    return n;
+}
+
+/* Receive len bytes into buf, repeating short reads */
+static inline int receiver_recv_all(MessageReceiver *r, int socket, char *buf, size_t len,
+                                    int flags, int slot, SyscallProbe *probe) {
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = receiver_recv(r, socket, buf + got, len - got, flags, slot, probe);
+        if (n < 0) {
+            return -1;
+        }
+        got += n;
+    }
+    return 0;
+}
+
+static inline int receiver_next_iovec(MessageReceiver *r, int socket, SyscallProbe *probe) {
+    struct iovec iov[RECV_MAX_FIELDS];
+    for (int i = 0; i < r->num_fields; i++) {
+        iov[i].iov_base = r->buffer + (size_t)i * r->field_size;
+        iov[i].iov_len = r->field_size;
+    }
+
+    struct msghdr msghdr;
+    memset(&msghdr, 0, sizeof(msghdr));
+    msghdr.msg_iov = iov;
+    msghdr.msg_iovlen = r->num_fields;
+
+    size_t got = 0;
+    while (got < r->message_size) {
+        uint64_t t0 = syscall_probe_begin(probe);
+        ssize_t n = recvmsg(socket, &msghdr, MSG_WAITALL);
+        syscall_probe_end(probe, PROBE_SLOT_MESSAGE, t0, n, r->message_size - got);
+        r->syscalls++;
+        if (n <= 0) {
+            return -1;
+        }
+        r->bytes += n;
+        got += n;
+
+        /* MSG_WAITALL only returns short on a signal or shutdown */
+        while (n > 0 && msghdr.msg_iovlen > 0) {
+            if ((size_t)n >= msghdr.msg_iov->iov_len) {
+                n -= msghdr.msg_iov->iov_len;
+                msghdr.msg_iov++;
+                msghdr.msg_iovlen--;
+            } else {
+                msghdr.msg_iov->iov_base = (char *)msghdr.msg_iov->iov_base + n;
+                msghdr.msg_iov->iov_len -= n;
+                n = 0;
+            }
+        }
+    }
+    return 0;
+}
+
+/* Receive the next message; returns its size or -1 when the connection ends */
+static inline int receiver_next(MessageReceiver *r, int socket, SyscallProbe *probe) {
+    int status = 0;
+
+    switch (r->strategy) {
+    case RECV_FIELD:
+        for (int i = 0; i < r->num_fields && status == 0; i++) {
+            status = receiver_recv_all(r, socket, r->buffer + (size_t)i * r->field_size,
+                                       r->field_size, 0, i, probe);
+        }
+        break;
+    case RECV_WAITALL:
+        status = receiver_recv_all(r, socket, r->buffer, r->message_size, MSG_WAITALL,
+                                   PROBE_SLOT_MESSAGE, probe);
+        break;
+    case RECV_BULK:
+        while (status == 0 && r->pending < r->message_size) {
+            ssize_t n = receiver_recv(r, socket, r->buffer, r->buffer_size, 0,
+                                      PROBE_SLOT_MESSAGE, probe);
+            if (n < 0) {
+                status = -1;
+            } else {
+                r->pending += n;
+            }
+        }
+        if (status == 0) {
+            r->pending -= r->message_size;
+        }
+        break;
+    case RECV_IOVEC:
+        status = receiver_next_iovec(r, socket, probe);
+        break;
+    case RECV_RING:
+        status = recv_ring_next_message(&r->ring, socket, r->num_fields, r->field_size,
+                                        r->fields, probe) < 0 ? -1 : 0;
+        break;
+    default:
+        status = -1;
+        break;
+    }
+
+    if (status < 0) {
+        return -1;
+    }
+    r->messages++;
+    return (int)r->message_size;
+}
+
+static inline unsigned long long receiver_syscalls(const MessageReceiver *r) {
+    return r->strategy == RECV_RING ? r->ring.syscalls : r->syscalls;
+}
+
+static inline unsigned long long receiver_bytes(const MessageReceiver *r) {
+    return r->strategy == RECV_RING ? r->ring.bytes : r->bytes;
+}
+
+static inline void receiver_print(const MessageReceiver *r) {
+    unsigned long long syscalls = receiver_syscalls(r);
+    printf("\n=== Receive Strategy: %s ===\n", recv_strategy_names[r->strategy]);
+    printf("Receive syscalls: %llu for %llu messages (%.3f syscalls/message)\n",
+           syscalls, r->messages, r->messages ? (double)syscalls / r->messages : 0.0);
+    printf("Bytes per syscall: %.1f\n",
+           syscalls ? (double)receiver_bytes(r) / syscalls : 0.0);
+    if (r->strategy == RECV_RING) {
+        printf("Ring capacity: %zu bytes (memfd mapped twice), framing errors: %llu\n",
+               r->ring.capacity, r->ring.framing_errors);
+    }
+}
+
+static inline void json_receiver(JsonWriter *w, const char *key, const MessageReceiver *r) {
+    unsigned long long syscalls = receiver_syscalls(r);
+    json_begin_object(w, key);
+    json_string(w, "strategy", recv_strategy_names[r->strategy]);
+    json_int(w, "syscalls", (long long)syscalls);
+    json_int(w, "messages", (long long)r->messages);
+    json_double(w, "syscalls_per_message", r->messages ? (double)syscalls / r->messages : 0.0);
+    json_double(w, "bytes_per_syscall", syscalls ? (double)receiver_bytes(r) / syscalls : 0.0);
+    if (r->strategy == RECV_RING) {
+        json_int(w, "ring_capacity", (long long)r->ring.capacity);
+        json_int(w, "framing_errors", (long long)r->ring.framing_errors);
+    }
+    json_end_object(w);
+}
+
+#endif /* MT25018_COMMON_RECVSTRATEGY_H */
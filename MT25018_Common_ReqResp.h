@@ -0,0 +1,377 @@
+/*
+ * MT25018 - Graduate Systems PA02
+ * Common: Request/response flows and traffic classes
+ * The latency-sensitive half of the mixed-workload benchmark. A server
+ * started with --rr-port also answers small request/response exchanges on
+ * that port, next to its bulk streams; a client started with --rr sends
+ * one request per interval and times every round trip. With --class-mark
+ * both sides tag their sockets: bulk streams TC_PRIO_BULK and
+ * IPTOS_THROUGHPUT, request/response flows TC_PRIO_INTERACTIVE and
+ * IPTOS_LOWDELAY. A prio qdisc with its default priomap then queues the
+ * two classes in separate bands, request/response first.
+ *
+ * Wire format: RrHeader (network byte order), request_bytes of payload;
+ * the reply is response_bytes of payload.
+ */
+
+#ifndef MT25018_COMMON_REQRESP_H
+#define MT25018_COMMON_REQRESP_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <linux/pkt_sched.h>
+
+#include "MT25018_Common_Results.h"
+
+#define RR_DEFAULT_PORT 8081
+#define RR_DEFAULT_INTERVAL_US 1000
+#define RR_MAX_PAYLOAD (1 << 20)
+
+typedef enum {
+    TRAFFIC_BULK,
+    TRAFFIC_LATENCY
+} TrafficClass;
+
+typedef struct {
+    uint32_t request_bytes;
+    uint32_t response_bytes;
+} RrHeader;
+
+/* Responder side (server) */
+typedef struct {
+    int listen_socket;
+    int port;
+    int class_mark;
+    volatile int running;
+    pthread_t thread;
+    long long connections;
+    long long requests;
+} RrServer;
+
+/* Requester side (client) */
+typedef struct {
+    int interval_us;
+    long long requests;
+    long long late;                     /* responses that overran the next slot */
+    double elapsed_seconds;
+    LatencyHistogram rtt_ns;            /* send to response */
+    LatencyHistogram intended_ns;       /* scheduled slot to response, every slot */
+} RrStats;
+
+/* Tag a socket with a traffic class. IP_TOS goes first: setting it also
+ * resets the priority to the TOS default. */
+static inline void traffic_class_mark(int socket, TrafficClass cls) {
+    int tos = cls == TRAFFIC_LATENCY ? IPTOS_LOWDELAY : IPTOS_THROUGHPUT;
+    int priority = cls == TRAFFIC_LATENCY ? TC_PRIO_INTERACTIVE : TC_PRIO_BULK;
+    if (setsockopt(socket, IPPROTO_IP, IP_TOS, &tos, sizeof(tos)) < 0) {
+        perror("Warning: IP_TOS failed");
+    }
+    if (setsockopt(socket, SOL_SOCKET, SO_PRIORITY, &priority, sizeof(priority)) < 0) {
+        perror("Warning: SO_PRIORITY failed");
+    }
+}
+
+static inline int rr_send_all(int socket, const void *buf, size_t len) {
+    const char *p = (const char *)buf;
+    while (len > 0) {
+        ssize_t n = send(socket, p, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/* Returns 0, or -1 on error or when the peer closed the connection */
+static inline int rr_recv_all(int socket, void *buf, size_t len) {
+    char *p = (char *)buf;
+    while (len > 0) {
+        ssize_t n = recv(socket, p, len, 0);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+typedef struct {
+    RrServer *server;
+    int socket;
+} RrConnection;
+
+/* Answer one connection's requests until it closes */
+static inline void *rr_serve_connection(void *arg) {
+    RrConnection *conn = (RrConnection *)arg;
+    RrServer *s = conn->server;
+    int socket = conn->socket;
+    free(conn);
+
+    char *buf = malloc(RR_MAX_PAYLOAD);
+    RrHeader hdr;
+    while (buf && rr_recv_all(socket, &hdr, sizeof(hdr)) == 0) {
+        uint32_t request_bytes = ntohl(hdr.request_bytes);
+        uint32_t response_bytes = ntohl(hdr.response_bytes);
+        if (request_bytes > RR_MAX_PAYLOAD || response_bytes > RR_MAX_PAYLOAD) {
+            break;
+        }
+        if (rr_recv_all(socket, buf, request_bytes) < 0 ||
+            rr_send_all(socket, buf, response_bytes) < 0) {
+            break;
+        }
+        __atomic_add_fetch(&s->requests, 1, __ATOMIC_RELAXED);
+    }
+    free(buf);
+    close(socket);
+    return NULL;
+}
+
+static inline void *rr_server_main(void *arg) {
+    RrServer *s = (RrServer *)arg;
+    while (s->running) {
+        int socket = accept(s->listen_socket, NULL, NULL);
+        if (socket < 0) {
+            if (s->running && errno != EINTR) {
+                perror("accept failed for request/response");
+                usleep(100000);
+            }
+            continue;
+        }
+        int one = 1;
+        setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        /* Accepted sockets keep the listener's TOS but not its priority */
+        if (s->class_mark) {
+            traffic_class_mark(socket, TRAFFIC_LATENCY);
+        }
+
+        RrConnection *conn = (RrConnection *)malloc(sizeof(RrConnection));
+        pthread_t thread;
+        if (!conn) {
+            close(socket);
+            continue;
+        }
+        conn->server = s;
+        conn->socket = socket;
+        if (pthread_create(&thread, NULL, rr_serve_connection, conn) != 0) {
+            perror("pthread_create failed for request/response");
+            free(conn);
+            close(socket);
+            continue;
+        }
+        pthread_detach(thread);
+        __atomic_add_fetch(&s->connections, 1, __ATOMIC_RELAXED);
+    }
+    return NULL;
+}
+
+/* Listen on port and answer requests from a background thread; with
+ * class_mark every connection (and the SYN-ACK) carries the latency
+ * class. Returns 0 or -1. */
+static inline int rr_server_start(RrServer *s, int port, int class_mark) {
+    memset(s, 0, sizeof(*s));
+    s->port = port;
+    s->class_mark = class_mark;
+    s->listen_socket = socket(AF_INET, SOCK_STREAM, 0);
+    if (s->listen_socket < 0) {
+        perror("socket failed for request/response");
+        return -1;
+    }
+    int one = 1;
+    setsockopt(s->listen_socket, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (class_mark) {
+        traffic_class_mark(s->listen_socket, TRAFFIC_LATENCY);
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(port);
+    if (bind(s->listen_socket, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(s->listen_socket, SOMAXCONN) < 0) {
+        perror("bind/listen failed for request/response");
+        close(s->listen_socket);
+        return -1;
+    }
+
+    s->running = 1;
+    if (pthread_create(&s->thread, NULL, rr_server_main, s) != 0) {
+        perror("pthread_create failed for request/response");
+        s->running = 0;
+        close(s->listen_socket);
+        return -1;
+    }
+    return 0;
+}
+
+/* Stop accepting; connections being answered end with their clients */
+static inline void rr_server_stop(RrServer *s) {
+    if (!s->running) {
+        return;
+    }
+    s->running = 0;
+    shutdown(s->listen_socket, SHUT_RDWR);
+    pthread_join(s->thread, NULL);
+    close(s->listen_socket);
+}
+
+static inline void rr_server_print(const RrServer *s) {
+    printf("Request/response (port %d%s): %lld connections, %lld requests answered\n",
+           s->port, s->class_mark ? ", latency class" : "",
+           __atomic_load_n(&s->connections, __ATOMIC_RELAXED),
+           __atomic_load_n(&s->requests, __ATOMIC_RELAXED));
+}
+
+static inline long long rr_time_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* Exchange message_size-byte requests and responses with the server at
+ * addr for duration seconds, one request every interval_us (0: back to
+ * back), recording every round trip. A slow response holds back the
+ * requests due behind it, which rtt_ns never sees (coordinated omission),
+ * so intended_ns also times every slot from when it was due: the request
+ * sent in it, and each slot skipped while a response was late. Returns 0
+ * or -1. */
+static inline int rr_client_run(const struct sockaddr_in *addr, int message_size, int duration,
+                                int interval_us, int class_mark, RrStats *st) {
+    memset(st, 0, sizeof(*st));
+    st->interval_us = interval_us;
+    if (message_size > RR_MAX_PAYLOAD) {
+        fprintf(stderr, "Error: request/response messages are limited to %d bytes\n",
+                RR_MAX_PAYLOAD);
+        return -1;
+    }
+
+    int socket_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (socket_fd < 0) {
+        perror("socket creation failed");
+        return -1;
+    }
+    int one = 1;
+    setsockopt(socket_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (class_mark) {
+        traffic_class_mark(socket_fd, TRAFFIC_LATENCY);
+    }
+    if (connect(socket_fd, (const struct sockaddr *)addr, sizeof(*addr)) < 0) {
+        perror("connection failed");
+        close(socket_fd);
+        return -1;
+    }
+
+    /* Header and request leave in one send() */
+    char *request = calloc(1, sizeof(RrHeader) + message_size);
+    char *response = malloc(message_size > 0 ? message_size : 1);
+    if (!request || !response) {
+        free(request);
+        free(response);
+        close(socket_fd);
+        return -1;
+    }
+    RrHeader hdr = {htonl((uint32_t)message_size), htonl((uint32_t)message_size)};
+    memcpy(request, &hdr, sizeof(hdr));
+
+    long long start = rr_time_ns();
+    long long end = start + (long long)duration * 1000000000LL;
+    long long next = start;
+    int result = 0;
+    while (next < end) {
+        if (rr_time_ns() < next) {
+            struct timespec wake = {next / 1000000000LL, next % 1000000000LL};
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL);
+        }
+
+        long long scheduled = next;
+        long long sent = rr_time_ns();
+        if (rr_send_all(socket_fd, request, sizeof(RrHeader) + message_size) < 0 ||
+            rr_recv_all(socket_fd, response, message_size) < 0) {
+            perror("request/response failed");
+            result = -1;
+            break;
+        }
+        long long done = rr_time_ns();
+        latency_hist_record(&st->rtt_ns, (uint64_t)(done - sent));
+        latency_hist_record(&st->intended_ns, (uint64_t)(done - scheduled));
+        st->requests++;
+        /* A response that overruns the next slot delays the schedule
+         * instead of starting a burst to catch up; the skipped slots
+         * would have waited until now */
+        next += interval_us * 1000LL;
+        if (next < done) {
+            if (interval_us > 0) {
+                st->late++;
+                for (; next < done && next < end; next += interval_us * 1000LL) {
+                    latency_hist_record(&st->intended_ns, (uint64_t)(done - next));
+                }
+            }
+            next = done;
+        }
+    }
+    st->elapsed_seconds = (rr_time_ns() - start) / 1e9;
+
+    free(request);
+    free(response);
+    close(socket_fd);
+    return result;
+}
+
+static inline void rr_print(const RrStats *st, int message_size) {
+    printf("\n=== Request/Response ===\n");
+    printf("Requests: %lld of %d bytes in %.2f s (%.0f/s, interval %d us, %lld late)\n",
+           st->requests, message_size, st->elapsed_seconds,
+           st->elapsed_seconds > 0 ? st->requests / st->elapsed_seconds : 0.0,
+           st->interval_us, st->late);
+    if (st->rtt_ns.samples > 0) {
+        printf("Round trip: avg %.2f us, p50 %.2f us, p99 %.2f us, p99.9 %.2f us, max %.2f us\n",
+               st->rtt_ns.sum_ns / 1000.0 / st->rtt_ns.samples,
+               latency_hist_percentile(&st->rtt_ns, 50.0) / 1000.0,
+               latency_hist_percentile(&st->rtt_ns, 99.0) / 1000.0,
+               latency_hist_percentile(&st->rtt_ns, 99.9) / 1000.0,
+               st->rtt_ns.max_ns / 1000.0);
+        printf("From schedule: p50 %.2f us, p99 %.2f us, p99.9 %.2f us over %llu slots\n",
+               latency_hist_percentile(&st->intended_ns, 50.0) / 1000.0,
+               latency_hist_percentile(&st->intended_ns, 99.0) / 1000.0,
+               latency_hist_percentile(&st->intended_ns, 99.9) / 1000.0,
+               st->intended_ns.samples);
+    }
+}
+
+static inline void json_rr(JsonWriter *w, const char *key, const RrStats *st) {
+    json_begin_object(w, key);
+    json_int(w, "requests", st->requests);
+    json_int(w, "interval_us", st->interval_us);
+    json_int(w, "late", st->late);
+    json_double(w, "p50_us", latency_hist_percentile(&st->rtt_ns, 50.0) / 1000.0);
+    json_double(w, "p99_us", latency_hist_percentile(&st->rtt_ns, 99.0) / 1000.0);
+    json_double(w, "p999_us", latency_hist_percentile(&st->rtt_ns, 99.9) / 1000.0);
+    json_double(w, "intended_p50_us", latency_hist_percentile(&st->intended_ns, 50.0) / 1000.0);
+    json_double(w, "intended_p99_us", latency_hist_percentile(&st->intended_ns, 99.0) / 1000.0);
+    json_double(w, "intended_p999_us",
+                latency_hist_percentile(&st->intended_ns, 99.9) / 1000.0);
+    json_latency_hist(w, "intended_ns", &st->intended_ns);
+    json_end_object(w);
+}
+
+#endif /* MT25018_COMMON_REQRESP_H */
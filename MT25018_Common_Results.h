@@ -0,0 +1,208 @@
+/*
+ * MT25018 - Graduate Systems PA02
+ * Common: Machine-readable result records
+ * Servers and clients append one JSON object per run (JSON lines) so the
+ * experiment runner can aggregate every client instead of grepping text.
+ * Latency is kept in a mergeable log-linear histogram.
+ */
+
+#ifndef MT25018_COMMON_RESULTS_H
+#define MT25018_COMMON_RESULTS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "MT25018_Common_PerfCounters.h"
+
+/* Log-linear histogram: 8 linear sub-buckets per power of two
+ * Values 0..7 map to themselves; a value with highest set bit m >= 3 maps
+ * to (m - 2) * 8 + next three bits. Relative bucket width is <= 12.5%.
+ * MT25018_Part_C_aggregate_results.py decodes the same scheme.
+ */
+#define LATENCY_HIST_SUB_BITS 3
+#define LATENCY_HIST_SUB_BUCKETS (1 << LATENCY_HIST_SUB_BITS)
+#define LATENCY_HIST_BUCKETS 320
+
+typedef struct {
+    unsigned long long counts[LATENCY_HIST_BUCKETS];
+    unsigned long long samples;
+    unsigned long long sum_ns;
+    unsigned long long max_ns;
+} LatencyHistogram;
+
+static inline int latency_hist_index(uint64_t ns) {
+    if (ns < LATENCY_HIST_SUB_BUCKETS) {
+        return (int)ns;
+    }
+    int msb = 63 - __builtin_clzll(ns);
+    int sub = (int)((ns >> (msb - LATENCY_HIST_SUB_BITS)) & (LATENCY_HIST_SUB_BUCKETS - 1));
+    int index = (msb - LATENCY_HIST_SUB_BITS + 1) * LATENCY_HIST_SUB_BUCKETS + sub;
+    return index < LATENCY_HIST_BUCKETS ? index : LATENCY_HIST_BUCKETS - 1;
+}
+
+/* Smallest value that maps to the given bucket */
+static inline uint64_t latency_hist_lower_bound(int index) {
+    if (index < LATENCY_HIST_SUB_BUCKETS) {
+        return (uint64_t)index;
+    }
+    int msb = index / LATENCY_HIST_SUB_BUCKETS + LATENCY_HIST_SUB_BITS - 1;
+    int sub = index % LATENCY_HIST_SUB_BUCKETS;
+    return (uint64_t)(LATENCY_HIST_SUB_BUCKETS + sub) << (msb - LATENCY_HIST_SUB_BITS);
+}
+
+static inline void latency_hist_record(LatencyHistogram *h, uint64_t ns) {
+    h->counts[latency_hist_index(ns)]++;
+    h->samples++;
+    h->sum_ns += ns;
+    if (ns > h->max_ns) {
+        h->max_ns = ns;
+    }
+}
+
+/* Percentile estimate (lower bound of the bucket containing it) */
+static inline uint64_t latency_hist_percentile(const LatencyHistogram *h, double pct) {
+    unsigned long long target = (unsigned long long)(h->samples * pct / 100.0);
+    unsigned long long seen = 0;
+    for (int i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen > target) {
+            return latency_hist_lower_bound(i);
+        }
+    }
+    return h->max_ns;
+}
+
+/* Accumulate a per-thread histogram into an aggregate */
+static inline void latency_hist_merge(LatencyHistogram *total, const LatencyHistogram *h) {
+    for (int i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+        total->counts[i] += h->counts[i];
+    }
+    total->samples += h->samples;
+    total->sum_ns += h->sum_ns;
+    if (h->max_ns > total->max_ns) {
+        total->max_ns = h->max_ns;
+    }
+}
+
+/* Minimal streaming JSON writer for one-line records */
+#define JSON_MAX_DEPTH 8
+
+typedef struct {
+    FILE *fp;
+    int depth;
+    int first[JSON_MAX_DEPTH];
+} JsonWriter;
+
+static inline void json_separator(JsonWriter *w) {
+    if (!w->first[w->depth]) {
+        fputc(',', w->fp);
+    }
+    w->first[w->depth] = 0;
+}
+
+static inline void json_key(JsonWriter *w, const char *key) {
+    json_separator(w);
+    if (key) {
+        fprintf(w->fp, "\"%s\":", key);
+    }
+}
+
+static inline void json_begin_object(JsonWriter *w, const char *key) {
+    if (w->depth > 0 || !w->first[0]) {
+        json_key(w, key);
+    }
+    fputc('{', w->fp);
+    w->first[++w->depth] = 1;
+}
+
+static inline void json_end_object(JsonWriter *w) {
+    fputc('}', w->fp);
+    w->depth--;
+}
+
+static inline void json_begin_array(JsonWriter *w, const char *key) {
+    json_key(w, key);
+    fputc('[', w->fp);
+    w->first[++w->depth] = 1;
+}
+
+static inline void json_end_array(JsonWriter *w) {
+    fputc(']', w->fp);
+    w->depth--;
+}
+
+static inline void json_string(JsonWriter *w, const char *key, const char *value) {
+    json_key(w, key);
+    fprintf(w->fp, "\"%s\"", value);
+}
+
+static inline void json_int(JsonWriter *w, const char *key, long long value) {
+    json_key(w, key);
+    fprintf(w->fp, "%lld", value);
+}
+
+static inline void json_double(JsonWriter *w, const char *key, double value) {
+    json_key(w, key);
+    fprintf(w->fp, "%.6f", value);
+}
+
+/* Sparse histogram: [[bucket_index, count], ...] plus summary fields */
+static inline void json_latency_hist(JsonWriter *w, const char *key, const LatencyHistogram *h) {
+    json_begin_object(w, key);
+    json_int(w, "samples", (long long)h->samples);
+    json_int(w, "sum_ns", (long long)h->sum_ns);
+    json_int(w, "max_ns", (long long)h->max_ns);
+    json_int(w, "sub_bits", LATENCY_HIST_SUB_BITS);
+    json_begin_array(w, "buckets");
+    for (int i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+        if (h->counts[i]) {
+            json_begin_array(w, NULL);
+            json_int(w, NULL, i);
+            json_int(w, NULL, (long long)h->counts[i]);
+            json_end_array(w);
+        }
+    }
+    json_end_array(w);
+    json_end_object(w);
+}
+
+/* Counter object; unsupported events are omitted */
+static inline void json_perf_sample(JsonWriter *w, const char *key, const PerfSample *s, long long bytes) {
+    static const char *names[PERF_NUM_EVENTS] = {
+        "cycles", "instructions", "cache_misses",
+        "l1d_misses", "llc_misses", "context_switches"
+    };
+    json_begin_object(w, key);
+    for (int i = 0; i < PERF_NUM_EVENTS; i++) {
+        if (s->supported[i]) {
+            json_int(w, names[i], (long long)s->values[i]);
+        }
+    }
+    json_double(w, "ipc", perf_sample_ipc(s));
+    json_double(w, "cycles_per_byte", perf_sample_cycles_per_byte(s, bytes));
+    json_end_object(w);
+}
+
+/* Open a results file for appending and start the top-level object */
+static inline int json_record_open(JsonWriter *w, const char *path) {
+    memset(w, 0, sizeof(*w));
+    w->fp = fopen(path, "a");
+    if (!w->fp) {
+        perror("fopen results file failed");
+        return -1;
+    }
+    w->first[0] = 1;
+    json_begin_object(w, NULL);
+    return 0;
+}
+
+/* Finish the record with a newline so the file stays JSON lines */
+static inline void json_record_close(JsonWriter *w) {
+    json_end_object(w);
+    fputc('\n', w->fp);
+    fclose(w->fp);
+    w->fp = NULL;
+}
+
+#endif /* MT25018_COMMON_RESULTS_H */
@@ -0,0 +1,46 @@
+/*
+ * MT25018 - Graduate Systems PA02
+ * Common: Size-specialized builds
+ * `make specialized` compiles every TCP program once per swept message
+ * size with -DSPECIALIZED_MESSAGE_SIZE=N. FIELD_SIZE() then folds to a
+ * constant, so the per-field send/recv loops and iovec setup are compiled
+ * for a known length (unrolled loops, constant lengths and offsets).
+ * A specialized binary refuses any other message size.
+ */
+
+#ifndef MT25018_COMMON_SPECIALIZE_H
+#define MT25018_COMMON_SPECIALIZE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* A runtime field size, or the constant one in a specialized build; the
+ * per-message send/recv functions start with field_size = FIELD_SIZE(...)
+ * (NUM_STRING_FIELDS comes from the including program) */
+#ifdef SPECIALIZED_MESSAGE_SIZE
+#define FIELD_SIZE(field_size) ((void)(field_size), SPECIALIZED_MESSAGE_SIZE / NUM_STRING_FIELDS)
+#else
+#define FIELD_SIZE(field_size) (field_size)
+#endif
+
+/* Exit unless message_size is the size this binary was specialized for */
+static inline void specialize_check_size(int message_size) {
+#ifdef SPECIALIZED_MESSAGE_SIZE
+    if (message_size != SPECIALIZED_MESSAGE_SIZE) {
+        fprintf(stderr, "Error: this binary is specialized for %d-byte messages, got %d\n",
+                SPECIALIZED_MESSAGE_SIZE, message_size);
+        exit(EXIT_FAILURE);
+    }
+#else
+    (void)message_size;
+#endif
+}
+
+/* Build description for the startup banner */
+static inline void specialize_print(void) {
+#ifdef SPECIALIZED_MESSAGE_SIZE
+    printf("Build: specialized for %d-byte messages\n", SPECIALIZED_MESSAGE_SIZE);
+#endif
+}
+
+#endif /* MT25018_COMMON_SPECIALIZE_H */
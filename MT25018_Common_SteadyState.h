@@ -0,0 +1,185 @@
+/*
+ * MT25018 - Graduate Systems PA02
+ * Common: Steady-state detection
+ * The receive loop records bytes, messages and latency per fixed interval.
+ * After the run, the steady window starts at the first run of
+ * STEADY_WINDOW consecutive intervals whose throughput coefficient of
+ * variation is below a threshold, and ends at the last complete interval.
+ * Slow start, first-touch page faults and cold caches fall before it.
+ */
+
+#ifndef MT25018_COMMON_STEADYSTATE_H
+#define MT25018_COMMON_STEADYSTATE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "MT25018_Common_Results.h"
+
+#define STEADY_INTERVAL_MS 100
+/* Intervals kept; longer runs merge neighbours and double the interval */
+#define STEADY_MAX_INTERVALS 512
+/* Consecutive intervals that must agree before the window opens */
+#define STEADY_WINDOW 5
+#define STEADY_DEFAULT_CV_PCT 5.0
+
+typedef struct {
+    long long bytes;
+    long long messages;
+    LatencyHistogram latency;
+} SteadyInterval;
+
+typedef struct {
+    long long start_ns;
+    long long interval_ns;
+    double max_cv;
+    SteadyInterval *intervals;
+    int count;
+    /* Result of steady_state_detect() */
+    int found;
+    int begin;
+    int end;
+    double cv;
+    long long bytes;
+    long long messages;
+    double elapsed_sec;
+    LatencyHistogram latency;
+} SteadyState;
+
+static inline int steady_state_init(SteadyState *s, long long start_ns, double max_cv_pct) {
+    memset(s, 0, sizeof(*s));
+    s->intervals = (SteadyInterval *)calloc(STEADY_MAX_INTERVALS, sizeof(SteadyInterval));
+    if (!s->intervals) {
+        perror("calloc failed for steady-state intervals");
+        return -1;
+    }
+    s->start_ns = start_ns;
+    s->interval_ns = STEADY_INTERVAL_MS * 1000000LL;
+    s->max_cv = max_cv_pct / 100.0;
+    return 0;
+}
+
+/* Merge neighbouring intervals pairwise so a longer run fits */
+static inline void steady_state_coarsen(SteadyState *s) {
+    for (int i = 0; i < STEADY_MAX_INTERVALS / 2; i++) {
+        SteadyInterval *a = &s->intervals[2 * i];
+        SteadyInterval *b = &s->intervals[2 * i + 1];
+        a->bytes += b->bytes;
+        a->messages += b->messages;
+        latency_hist_merge(&a->latency, &b->latency);
+        s->intervals[i] = *a;
+    }
+    memset(&s->intervals[STEADY_MAX_INTERVALS / 2], 0,
+           (STEADY_MAX_INTERVALS / 2) * sizeof(SteadyInterval));
+    s->interval_ns *= 2;
+    s->count = (s->count + 1) / 2;
+}
+
+/* Account one received message at time now_ns */
+static inline void steady_state_record(SteadyState *s, long long now_ns, long long bytes,
+                                       long long latency_ns) {
+    long long index = (now_ns - s->start_ns) / s->interval_ns;
+    while (index >= STEADY_MAX_INTERVALS) {
+        steady_state_coarsen(s);
+        index = (now_ns - s->start_ns) / s->interval_ns;
+    }
+    SteadyInterval *slot = &s->intervals[index];
+    slot->bytes += bytes;
+    slot->messages++;
+    latency_hist_record(&slot->latency, latency_ns);
+    if (index >= s->count) {
+        s->count = (int)index + 1;
+    }
+}
+
+/* Coefficient of variation of interval throughput over [begin, end) */
+static inline double steady_state_cv(const SteadyState *s, int begin, int end) {
+    int n = end - begin;
+    if (n < 2) {
+        return 0.0;
+    }
+    double mean = 0.0;
+    for (int i = begin; i < end; i++) {
+        mean += s->intervals[i].bytes;
+    }
+    mean /= n;
+    if (mean <= 0.0) {
+        return INFINITY;
+    }
+    double var = 0.0;
+    for (int i = begin; i < end; i++) {
+        double d = s->intervals[i].bytes - mean;
+        var += d * d;
+    }
+    return sqrt(var / (n - 1)) / mean;
+}
+
+/* Find the steady window of a run that ended at end_ns and sum it up.
+ * Without a steady run of STEADY_WINDOW intervals, all complete intervals
+ * are reported and found stays 0. */
+static inline void steady_state_detect(SteadyState *s, long long end_ns) {
+    int complete = (int)((end_ns - s->start_ns) / s->interval_ns);
+    if (complete > s->count) {
+        complete = s->count;
+    }
+    s->begin = 0;
+    s->end = complete;
+    s->found = 0;
+    for (int i = 0; i + STEADY_WINDOW <= complete; i++) {
+        if (steady_state_cv(s, i, i + STEADY_WINDOW) <= s->max_cv) {
+            s->begin = i;
+            s->found = 1;
+            break;
+        }
+    }
+    if (complete == 0) {
+        /* Shorter than one interval: keep the whole (partial) run */
+        s->end = s->count;
+    }
+
+    s->bytes = 0;
+    s->messages = 0;
+    memset(&s->latency, 0, sizeof(s->latency));
+    for (int i = s->begin; i < s->end; i++) {
+        s->bytes += s->intervals[i].bytes;
+        s->messages += s->intervals[i].messages;
+        latency_hist_merge(&s->latency, &s->intervals[i].latency);
+    }
+    s->elapsed_sec = complete > 0 ? (s->end - s->begin) * s->interval_ns / 1e9
+                                  : (end_ns - s->start_ns) / 1e9;
+    s->cv = steady_state_cv(s, s->begin, s->end);
+}
+
+static inline void steady_state_print(const SteadyState *s) {
+    double offset = s->begin * s->interval_ns / 1e9;
+    printf("\n=== Steady State (%lld ms intervals, CV <= %.1f%%) ===\n",
+           s->interval_ns / 1000000, s->max_cv * 100.0);
+    if (!s->found) {
+        printf("Not reached: no %d consecutive intervals agreed; reporting all intervals\n",
+               STEADY_WINDOW);
+    }
+    printf("Window: %.2f s to %.2f s (%.2f s, %d intervals, CV %.1f%%)\n",
+           offset, offset + s->elapsed_sec, s->elapsed_sec, s->end - s->begin, s->cv * 100.0);
+    printf("Steady throughput: %.2f Gbps\n",
+           s->elapsed_sec > 0 ? s->bytes * 8.0 / (s->elapsed_sec * 1e9) : 0.0);
+}
+
+static inline void json_steady_state(JsonWriter *w, const char *key, const SteadyState *s) {
+    json_begin_object(w, key);
+    json_int(w, "found", s->found);
+    json_int(w, "interval_ms", s->interval_ns / 1000000);
+    json_double(w, "offset_sec", s->begin * s->interval_ns / 1e9);
+    json_double(w, "length_sec", s->elapsed_sec);
+    json_int(w, "intervals", s->end - s->begin);
+    json_double(w, "cv", s->cv);
+    json_end_object(w);
+}
+
+static inline void steady_state_free(SteadyState *s) {
+    free(s->intervals);
+    s->intervals = NULL;
+}
+
+#endif /* MT25018_COMMON_STEADYSTATE_H */
@@ -0,0 +1,222 @@
+/*
+ * MT25018 - Graduate Systems PA02
+ * Common: Per-syscall cost probe
+ * Wraps each send/sendmsg/recv/recvmsg call with TSC reads and records a
+ * log2 duration histogram, bytes per call, short transfers and
+ * EAGAIN/ENOBUFS counts per message field. Each thread fills its own
+ * SyscallProbe, so the hot path takes no locks.
+ */
+
+#ifndef MT25018_COMMON_SYSCALLPROBE_H
+#define MT25018_COMMON_SYSCALLPROBE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/types.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/* Slots 0..7 are per-field calls (send/recv), the last slot is used by
+ * transports that move the whole message in one call (sendmsg/recvmsg) */
+#define PROBE_NUM_FIELDS 8
+#define PROBE_SLOT_MESSAGE PROBE_NUM_FIELDS
+#define PROBE_NUM_SLOTS (PROBE_NUM_FIELDS + 1)
+
+/* Bucket i counts calls that took [2^i, 2^(i+1)) nanoseconds */
+#define PROBE_HIST_BUCKETS 40
+
+/* Statistics for one call site */
+typedef struct {
+    unsigned long long calls;
+    unsigned long long total_cycles;
+    unsigned long long min_cycles;
+    unsigned long long max_cycles;
+    unsigned long long bytes;
+    unsigned long long short_calls;
+    unsigned long long eagain;
+    unsigned long long enobufs;
+    unsigned long long other_errors;
+    unsigned long long hist[PROBE_HIST_BUCKETS];
+} SyscallProbeSlot;
+
+/* Per-thread probe state */
+typedef struct {
+    SyscallProbeSlot slots[PROBE_NUM_SLOTS];
+} SyscallProbe;
+
+/* TSC ticks per nanosecond, set by syscall_probe_calibrate() */
+static double probe_ticks_per_ns = 1.0;
+
+static inline uint64_t probe_monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Read the time stamp counter (or a nanosecond clock on other CPUs) */
+static inline uint64_t probe_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return probe_monotonic_ns();
+#endif
+}
+
+/* Measure TSC frequency against CLOCK_MONOTONIC_RAW (~20ms, call once) */
+static inline void syscall_probe_calibrate(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    struct timespec pause = {0, 20 * 1000 * 1000};
+    uint64_t ns0 = probe_monotonic_ns();
+    uint64_t t0 = probe_ticks();
+    nanosleep(&pause, NULL);
+    uint64_t t1 = probe_ticks();
+    uint64_t ns1 = probe_monotonic_ns();
+    if (ns1 > ns0 && t1 > t0) {
+        probe_ticks_per_ns = (double)(t1 - t0) / (ns1 - ns0);
+    }
+#endif
+}
+
+static inline void syscall_probe_init(SyscallProbe *probe) {
+    memset(probe, 0, sizeof(*probe));
+    for (int i = 0; i < PROBE_NUM_SLOTS; i++) {
+        probe->slots[i].min_cycles = UINT64_MAX;
+    }
+}
+
+/* Start timing a call; returns 0 when probing is disabled (probe == NULL) */
+static inline uint64_t syscall_probe_begin(SyscallProbe *probe) {
+    return probe ? probe_ticks() : 0;
+}
+
+/* Finish timing a call and classify its result
+ * ret/requested are the syscall return value and requested length.
+ * errno is only read, never modified.
+ */
+static inline void syscall_probe_end(SyscallProbe *probe, int slot, uint64_t start,
+                                     ssize_t ret, size_t requested) {
+    if (!probe) {
+        return;
+    }
+    uint64_t cycles = probe_ticks() - start;
+    SyscallProbeSlot *s = &probe->slots[slot];
+
+    s->calls++;
+    s->total_cycles += cycles;
+    if (cycles < s->min_cycles) s->min_cycles = cycles;
+    if (cycles > s->max_cycles) s->max_cycles = cycles;
+
+    uint64_t ns = (uint64_t)(cycles / probe_ticks_per_ns);
+    int bucket = ns ? 63 - __builtin_clzll(ns) : 0;
+    if (bucket >= PROBE_HIST_BUCKETS) bucket = PROBE_HIST_BUCKETS - 1;
+    s->hist[bucket]++;
+
+    if (ret < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            s->eagain++;
+        } else if (errno == ENOBUFS) {
+            s->enobufs++;
+        } else {
+            s->other_errors++;
+        }
+    } else {
+        s->bytes += (unsigned long long)ret;
+        if ((size_t)ret < requested) {
+            s->short_calls++;
+        }
+    }
+}
+
+/* Merge a per-thread probe into an aggregate (caller holds any lock) */
+static inline void syscall_probe_merge(SyscallProbe *total, const SyscallProbe *probe) {
+    for (int i = 0; i < PROBE_NUM_SLOTS; i++) {
+        SyscallProbeSlot *t = &total->slots[i];
+        const SyscallProbeSlot *s = &probe->slots[i];
+        if (s->calls == 0) {
+            continue;
+        }
+        t->calls += s->calls;
+        t->total_cycles += s->total_cycles;
+        if (s->min_cycles < t->min_cycles) t->min_cycles = s->min_cycles;
+        if (s->max_cycles > t->max_cycles) t->max_cycles = s->max_cycles;
+        t->bytes += s->bytes;
+        t->short_calls += s->short_calls;
+        t->eagain += s->eagain;
+        t->enobufs += s->enobufs;
+        t->other_errors += s->other_errors;
+        for (int b = 0; b < PROBE_HIST_BUCKETS; b++) {
+            t->hist[b] += s->hist[b];
+        }
+    }
+}
+
+/* Upper bound (ns) of the bucket holding the given percentile */
+static inline unsigned long long syscall_probe_percentile_ns(const SyscallProbeSlot *s, double pct) {
+    unsigned long long target = (unsigned long long)(s->calls * pct / 100.0);
+    unsigned long long seen = 0;
+    for (int b = 0; b < PROBE_HIST_BUCKETS; b++) {
+        seen += s->hist[b];
+        if (seen > target) {
+            return 1ULL << (b + 1);
+        }
+    }
+    return 1ULL << PROBE_HIST_BUCKETS;
+}
+
+/* Dump per-slot statistics and histograms */
+static inline void syscall_probe_print(const SyscallProbe *probe, const char *transport,
+                                       const char *syscall_name) {
+    printf("\n=== Syscall Probe: %s() [%s] ===\n", syscall_name, transport);
+    printf("%-8s %12s %10s %10s %10s %12s %12s %8s %8s %8s %8s\n",
+           "Field", "Calls", "Avg(ns)", "p50(ns)", "p99(ns)", "Max(ns)",
+           "Bytes/call", "Short", "EAGAIN", "ENOBUFS", "Errors");
+
+    for (int i = 0; i < PROBE_NUM_SLOTS; i++) {
+        const SyscallProbeSlot *s = &probe->slots[i];
+        if (s->calls == 0) {
+            continue;
+        }
+
+        char name[16];
+        if (i == PROBE_SLOT_MESSAGE) {
+            snprintf(name, sizeof(name), "message");
+        } else {
+            snprintf(name, sizeof(name), "field%d", i + 1);
+        }
+
+        printf("%-8s %12llu %10.0f %10llu %10llu %12.0f %12.1f %8llu %8llu %8llu %8llu\n",
+               name, s->calls,
+               s->total_cycles / probe_ticks_per_ns / s->calls,
+               syscall_probe_percentile_ns(s, 50.0),
+               syscall_probe_percentile_ns(s, 99.0),
+               s->max_cycles / probe_ticks_per_ns,
+               (double)s->bytes / s->calls,
+               s->short_calls, s->eagain, s->enobufs, s->other_errors);
+    }
+
+    printf("Duration histograms (bucket lower bound in ns: calls):\n");
+    for (int i = 0; i < PROBE_NUM_SLOTS; i++) {
+        const SyscallProbeSlot *s = &probe->slots[i];
+        if (s->calls == 0) {
+            continue;
+        }
+        if (i == PROBE_SLOT_MESSAGE) {
+            printf("  message:");
+        } else {
+            printf("  field%d: ", i + 1);
+        }
+        for (int b = 0; b < PROBE_HIST_BUCKETS; b++) {
+            if (s->hist[b]) {
+                printf(" %llu:%llu", 1ULL << b, s->hist[b]);
+            }
+        }
+        printf("\n");
+    }
+}
+
+#endif /* MT25018_COMMON_SYSCALLPROBE_H */
@@ -0,0 +1,224 @@
+/*
+ * MT25018 - Graduate Systems PA02
+ * Common: Periodic TCP_INFO sampler
+ * A background thread polls getsockopt(TCP_INFO) on every registered
+ * connection at a fixed interval and appends one CSV row per connection
+ * and tick, so throughput changes can be lined up with RTT, cwnd,
+ * retransmits, queued bytes and the time the sender spent limited by the
+ * receive window or the send buffer.
+ */
+
+#ifndef MT25018_COMMON_TCPINFO_H
+#define MT25018_COMMON_TCPINFO_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+/* Connections sampled at once; later ones are not sampled */
+#define TCPINFO_MAX_CONNECTIONS 1024
+
+#define TCPINFO_DEFAULT_INTERVAL_MS 100
+
+/* Leading part of the kernel's struct tcp_info (linux/tcp.h); glibc's
+ * netinet/tcp.h copy stops before the fields needed here. Fields beyond
+ * the length the kernel returns read as 0. */
+typedef struct {
+    uint8_t state;
+    uint8_t ca_state;
+    uint8_t retransmits;
+    uint8_t probes;
+    uint8_t backoff;
+    uint8_t options;
+    uint8_t wscale;
+    uint8_t app_limited;
+    uint32_t rto;
+    uint32_t ato;
+    uint32_t snd_mss;
+    uint32_t rcv_mss;
+    uint32_t unacked;
+    uint32_t sacked;
+    uint32_t lost;
+    uint32_t retrans;
+    uint32_t fackets;
+    uint32_t last_data_sent;
+    uint32_t last_ack_sent;
+    uint32_t last_data_recv;
+    uint32_t last_ack_recv;
+    uint32_t pmtu;
+    uint32_t rcv_ssthresh;
+    uint32_t rtt;
+    uint32_t rttvar;
+    uint32_t snd_ssthresh;
+    uint32_t snd_cwnd;
+    uint32_t advmss;
+    uint32_t reordering;
+    uint32_t rcv_rtt;
+    uint32_t rcv_space;
+    uint32_t total_retrans;
+    uint64_t pacing_rate;
+    uint64_t max_pacing_rate;
+    uint64_t bytes_acked;
+    uint64_t bytes_received;
+    uint32_t segs_out;
+    uint32_t segs_in;
+    uint32_t notsent_bytes;
+    uint32_t min_rtt;
+    uint32_t data_segs_in;
+    uint32_t data_segs_out;
+    uint64_t delivery_rate;             /* bytes/s */
+    uint64_t busy_time;                 /* µs */
+    uint64_t rwnd_limited;              /* µs */
+    uint64_t sndbuf_limited;            /* µs */
+} TcpInfoRaw;
+
+typedef struct {
+    int socket;
+    int thread_id;
+    int port;
+} TcpInfoConn;
+
+typedef struct {
+    FILE *out;
+    int interval_ms;
+    volatile int running;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    struct timespec start;
+    TcpInfoConn conns[TCPINFO_MAX_CONNECTIONS];
+    int num_conns;
+    long long rows;
+    int connections_seen;
+} TcpInfoSampler;
+
+static inline double tcpinfo_elapsed_sec(const TcpInfoSampler *s) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - s->start.tv_sec) + (now.tv_nsec - s->start.tv_nsec) / 1e9;
+}
+
+/* Append one row for a connection; caller holds the mutex */
+static inline void tcpinfo_sample(TcpInfoSampler *s, const TcpInfoConn *c) {
+    TcpInfoRaw info;
+    socklen_t len = sizeof(info);
+    memset(&info, 0, sizeof(info));
+    if (getsockopt(c->socket, IPPROTO_TCP, TCP_INFO, &info, &len) < 0) {
+        return;
+    }
+    fprintf(s->out, "%.3f,%d,%d,%u,%u,%u,%u,%u,%u,%u,%u,%.3f,%llu,%llu,%llu,%llu\n",
+            tcpinfo_elapsed_sec(s), c->thread_id, c->port, info.rtt, info.rttvar,
+            info.snd_cwnd, info.snd_ssthresh, info.unacked, info.retrans, info.total_retrans,
+            info.notsent_bytes, info.delivery_rate * 8.0 / 1e6,
+            (unsigned long long)info.busy_time, (unsigned long long)info.rwnd_limited,
+            (unsigned long long)info.sndbuf_limited, (unsigned long long)info.bytes_acked);
+    s->rows++;
+}
+
+static inline void *tcpinfo_sampler_main(void *arg) {
+    TcpInfoSampler *s = (TcpInfoSampler *)arg;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    while (s->running) {
+        /* Absolute deadlines, so the interval does not drift */
+        next.tv_nsec += (long)s->interval_ms * 1000000L;
+        while (next.tv_nsec >= 1000000000L) {
+            next.tv_nsec -= 1000000000L;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+        pthread_mutex_lock(&s->mutex);
+        for (int i = 0; s->running && i < s->num_conns; i++) {
+            tcpinfo_sample(s, &s->conns[i]);
+        }
+        pthread_mutex_unlock(&s->mutex);
+    }
+    return NULL;
+}
+
+/* Open the CSV and start sampling every interval_ms; returns 0 or -1 */
+static inline int tcpinfo_sampler_start(TcpInfoSampler *s, const char *path, int interval_ms) {
+    memset(s, 0, sizeof(*s));
+    s->interval_ms = interval_ms > 0 ? interval_ms : TCPINFO_DEFAULT_INTERVAL_MS;
+    s->out = fopen(path, "w");
+    if (!s->out) {
+        perror("fopen failed for TCP_INFO samples");
+        return -1;
+    }
+    fprintf(s->out, "Time_sec,Thread,Port,RTT_us,RTTVar_us,Cwnd,Ssthresh,Unacked,Retrans,"
+                    "TotalRetrans,NotSent_bytes,DeliveryRate_Mbps,Busy_us,RwndLimited_us,"
+                    "SndbufLimited_us,BytesAcked\n");
+    pthread_mutex_init(&s->mutex, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &s->start);
+    s->running = 1;
+    if (pthread_create(&s->thread, NULL, tcpinfo_sampler_main, s) != 0) {
+        perror("pthread_create failed for TCP_INFO sampler");
+        s->running = 0;
+        fclose(s->out);
+        s->out = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/* Start sampling a connection (no-op when the sampler is not running) */
+static inline void tcpinfo_register(TcpInfoSampler *s, int socket, int thread_id) {
+    if (!s->running) {
+        return;
+    }
+    TcpInfoConn c = {socket, thread_id, 0};
+    struct sockaddr_in peer;
+    socklen_t len = sizeof(peer);
+    if (getpeername(socket, (struct sockaddr *)&peer, &len) == 0) {
+        c.port = ntohs(peer.sin_port);
+    }
+
+    pthread_mutex_lock(&s->mutex);
+    if (s->running && s->num_conns < TCPINFO_MAX_CONNECTIONS) {
+        s->conns[s->num_conns++] = c;
+        s->connections_seen++;
+    }
+    pthread_mutex_unlock(&s->mutex);
+}
+
+/* Take a last sample and stop sampling a connection; must precede close() */
+static inline void tcpinfo_unregister(TcpInfoSampler *s, int socket) {
+    if (!s->running) {
+        return;
+    }
+    pthread_mutex_lock(&s->mutex);
+    for (int i = 0; s->running && i < s->num_conns; i++) {
+        if (s->conns[i].socket == socket) {
+            tcpinfo_sample(s, &s->conns[i]);
+            s->conns[i] = s->conns[--s->num_conns];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&s->mutex);
+}
+
+/* Stop sampling and close the CSV. Handlers still running after the
+ * server's shutdown wait may call register/unregister afterwards, so the
+ * mutex is left initialised. */
+static inline void tcpinfo_sampler_stop(TcpInfoSampler *s) {
+    if (!s->running) {
+        return;
+    }
+    pthread_mutex_lock(&s->mutex);
+    s->running = 0;
+    pthread_mutex_unlock(&s->mutex);
+    pthread_join(s->thread, NULL);
+    fclose(s->out);
+    s->out = NULL;
+    printf("TCP_INFO: %lld samples of %d connections every %d ms\n",
+           s->rows, s->connections_seen, s->interval_ms);
+}
+
+#endif /* MT25018_COMMON_TCPINFO_H */
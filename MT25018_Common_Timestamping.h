@@ -0,0 +1,384 @@
+/*
+ * MT25018 - Graduate Systems PA02
+ * Common: Kernel timestamping (SO_TIMESTAMPING) latency breakdown
+ * Every TIMESTAMP_SAMPLE_INTERVAL-th message of a connection is traced:
+ *   server - software TX timestamps from the error queue when the last
+ *            byte of the message reaches the packet scheduler (SCHED), is
+ *            handed to the driver (SND) and is acknowledged (ACK)
+ *   client - the software RX timestamp of the skb that completed the
+ *            message, reported with recvmsg()
+ * Each side records its own part of the path and appends one CSV line per
+ * sample to a trace file. Both sides use CLOCK_REALTIME, so on one host
+ * MT25018_Part_C_latency_breakdown.py joins the lines on (client port,
+ * message) to get the full per-message breakdown:
+ *   user->kernel  send() entry to SCHED (includes the TCP send queue)
+ *   kernel queue  SCHED to SND (qdisc and driver)
+ *   wire/veth     SND to the client's RX timestamp
+ *   kernel->user  RX timestamp to the client's receive returning
+ */
+
+#ifndef MT25018_COMMON_TIMESTAMPING_H
+#define MT25018_COMMON_TIMESTAMPING_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+
+#include "MT25018_Common_Results.h"
+
+#define TIMESTAMP_SAMPLE_INTERVAL 100
+
+/* TX samples waiting for their timestamps; the oldest is dropped when full */
+#define TIMESTAMP_MAX_PENDING 64
+
+#define TIMESTAMP_REPORT_FLAGS (SOF_TIMESTAMPING_SOFTWARE | SOF_TIMESTAMPING_OPT_ID | \
+                                SOF_TIMESTAMPING_OPT_TSONLY)
+#define TIMESTAMP_TX_FLAGS (SOF_TIMESTAMPING_TX_SCHED | SOF_TIMESTAMPING_TX_SOFTWARE | \
+                            SOF_TIMESTAMPING_TX_ACK)
+
+/* Room for SCM_TIMESTAMPING plus the IP_RECVERR extended error */
+#define TIMESTAMP_CONTROL_BYTES 256
+
+/* Receives the MSG_ZEROCOPY completions found on the error queue */
+typedef void (*ZerocopyCompletionHandler)(void *ctx, const struct sock_extended_err *serr);
+
+/* Latency components of the sampled messages, per side */
+typedef struct {
+    long long samples;
+    long long incomplete;                   /* TX samples without an ACK timestamp */
+    LatencyHistogram user_to_kernel_ns;     /* server: send() entry to SCHED */
+    LatencyHistogram kernel_queue_ns;       /* server: SCHED to SND */
+    LatencyHistogram ack_ns;                /* server: SND to ACK */
+    LatencyHistogram kernel_to_user_ns;     /* client: RX timestamp to receive return */
+} TimestampBreakdown;
+
+typedef struct {
+    long long message;
+    uint32_t end_key;                       /* OPT_ID key of the message's last byte */
+    uint64_t user_ns;
+    uint64_t sched_ns;
+    uint64_t sent_ns;
+} TxSample;
+
+typedef struct {
+    int socket;
+    int port;                               /* client's port, the join key */
+    const char *transport;
+    FILE *out;
+    long long stream_bytes;                 /* bytes sent since OPT_ID was enabled */
+    int armed;
+    TxSample pending[TIMESTAMP_MAX_PENDING];
+    int num_pending;
+    TimestampBreakdown stats;
+    ZerocopyCompletionHandler zerocopy;     /* completions read while draining */
+    void *zerocopy_ctx;
+} TxTimestamper;
+
+typedef struct {
+    int port;
+    const char *transport;
+    FILE *out;
+    uint64_t last_rx_ns;                    /* RX timestamp of the last skb read */
+    union {
+        char buf[TIMESTAMP_CONTROL_BYTES];
+        struct cmsghdr align;
+    } control;
+    TimestampBreakdown stats;
+} RxTimestamper;
+
+static inline uint64_t timestamp_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline uint64_t timestamp_ns(const struct timespec *ts) {
+    return (uint64_t)ts->tv_sec * 1000000000ULL + ts->tv_nsec;
+}
+
+static inline int timestamp_sampled(long long message) {
+    return message % TIMESTAMP_SAMPLE_INTERVAL == 0;
+}
+
+/* Difference of two timestamps, 0 if either is missing or out of order */
+static inline void timestamp_record(LatencyHistogram *h, uint64_t from, uint64_t to) {
+    if (from && to >= from) {
+        latency_hist_record(h, to - from);
+    }
+}
+
+/* Server: report timestamps on a freshly accepted socket; returns 0 or -1
+ * OPT_ID keys are byte offsets from here on, so nothing may be sent yet. */
+static inline int tx_timestamp_init(TxTimestamper *ts, int socket, const char *transport,
+                                    FILE *out) {
+    memset(ts, 0, sizeof(*ts));
+    ts->socket = socket;
+    ts->transport = transport;
+    ts->out = out;
+
+    struct sockaddr_in peer;
+    socklen_t len = sizeof(peer);
+    if (getpeername(socket, (struct sockaddr *)&peer, &len) == 0) {
+        ts->port = ntohs(peer.sin_port);
+    }
+
+    int flags = TIMESTAMP_REPORT_FLAGS;
+    if (setsockopt(socket, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) < 0) {
+        perror("Warning: SO_TIMESTAMPING failed");
+        return -1;
+    }
+    return 0;
+}
+
+static inline void tx_timestamp_complete(TxTimestamper *ts, int index, uint64_t ack_ns) {
+    TxSample *s = &ts->pending[index];
+    timestamp_record(&ts->stats.user_to_kernel_ns, s->user_ns, s->sched_ns);
+    timestamp_record(&ts->stats.kernel_queue_ns, s->sched_ns, s->sent_ns);
+    timestamp_record(&ts->stats.ack_ns, s->sent_ns, ack_ns);
+    ts->stats.samples++;
+    if (ts->out) {
+        fprintf(ts->out, "tx,%s,%d,%lld,%llu,%llu,%llu,%llu\n", ts->transport, ts->port,
+                s->message, (unsigned long long)s->user_ns, (unsigned long long)s->sched_ns,
+                (unsigned long long)s->sent_ns, (unsigned long long)ack_ns);
+    }
+    ts->pending[index] = ts->pending[--ts->num_pending];
+}
+
+static inline void tx_timestamp_report(TxTimestamper *ts, const struct sock_extended_err *serr,
+                                       uint64_t tstamp) {
+    for (int i = 0; i < ts->num_pending; i++) {
+        TxSample *s = &ts->pending[i];
+        if (s->end_key != serr->ee_data) {
+            continue;
+        }
+        if (serr->ee_info == SCM_TSTAMP_SCHED) {
+            s->sched_ns = tstamp;
+        } else if (serr->ee_info == SCM_TSTAMP_SND) {
+            s->sent_ns = tstamp;
+        } else if (serr->ee_info == SCM_TSTAMP_ACK) {
+            tx_timestamp_complete(ts, i, tstamp);
+        }
+        break;
+    }
+}
+
+/* Read the socket's error queue without blocking and dispatch every entry:
+ * SO_EE_ORIGIN_TIMESTAMPING reports to ts, SO_EE_ORIGIN_ZEROCOPY
+ * completions to zerocopy (either may be NULL). Timestamps and zero-copy
+ * completions share the queue, so this is its only reader. */
+static inline void errqueue_drain(int socket, TxTimestamper *ts, ZerocopyCompletionHandler zerocopy,
+                                  void *zerocopy_ctx) {
+    for (;;) {
+        char control[TIMESTAMP_CONTROL_BYTES];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(socket, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+            return;
+        }
+
+        uint64_t tstamp = 0;
+        struct sock_extended_err *serr = NULL;
+        for (struct cmsghdr *c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+            if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPING) {
+                struct scm_timestamping *tss = (struct scm_timestamping *)CMSG_DATA(c);
+                tstamp = timestamp_ns(&tss->ts[0]);
+            } else if (c->cmsg_level == IPPROTO_IP && c->cmsg_type == IP_RECVERR) {
+                serr = (struct sock_extended_err *)CMSG_DATA(c);
+            }
+        }
+        if (!serr) {
+            continue;
+        }
+        if (serr->ee_origin == SO_EE_ORIGIN_TIMESTAMPING && tstamp && ts) {
+            tx_timestamp_report(ts, serr, tstamp);
+        } else if (serr->ee_origin == SO_EE_ORIGIN_ZEROCOPY && serr->ee_errno == 0 && zerocopy) {
+            zerocopy(zerocopy_ctx, serr);
+        }
+    }
+}
+
+/* Collect the timestamps queued so far without blocking; zero-copy
+ * completions read on the way go to the handler set with
+ * tx_timestamp_set_zerocopy_handler() */
+static inline void tx_timestamp_drain(TxTimestamper *ts) {
+    errqueue_drain(ts->socket, ts, ts->zerocopy, ts->zerocopy_ctx);
+}
+
+static inline void tx_timestamp_set_zerocopy_handler(TxTimestamper *ts,
+                                                     ZerocopyCompletionHandler zerocopy,
+                                                     void *ctx) {
+    ts->zerocopy = zerocopy;
+    ts->zerocopy_ctx = ctx;
+}
+
+/* Call before sending message number `message` of the connection */
+static inline void tx_timestamp_before(TxTimestamper *ts, long long message) {
+    if (!timestamp_sampled(message)) {
+        return;
+    }
+    tx_timestamp_drain(ts);
+    if (ts->num_pending == TIMESTAMP_MAX_PENDING) {
+        ts->stats.incomplete++;
+        ts->pending[0] = ts->pending[--ts->num_pending];
+    }
+
+    int flags = TIMESTAMP_REPORT_FLAGS | TIMESTAMP_TX_FLAGS;
+    if (setsockopt(ts->socket, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) < 0) {
+        return;
+    }
+    ts->armed = 1;
+    TxSample *s = &ts->pending[ts->num_pending++];
+    memset(s, 0, sizeof(*s));
+    s->message = message;
+    s->user_ns = timestamp_now_ns();
+}
+
+/* Call after the send with its result; the skb holding the last byte keeps
+ * its timestamp request after the socket flags are reset */
+static inline void tx_timestamp_after(TxTimestamper *ts, int bytes_sent) {
+    if (bytes_sent > 0) {
+        ts->stream_bytes += bytes_sent;
+    }
+    if (!ts->armed) {
+        return;
+    }
+    int flags = TIMESTAMP_REPORT_FLAGS;
+    setsockopt(ts->socket, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags));
+    ts->armed = 0;
+
+    if (bytes_sent < 0) {
+        ts->num_pending--;
+        return;
+    }
+    ts->pending[ts->num_pending - 1].end_key = (uint32_t)(ts->stream_bytes - 1);
+}
+
+/* Collect what has arrived by the end of the connection */
+static inline void tx_timestamp_finish(TxTimestamper *ts) {
+    tx_timestamp_drain(ts);
+    ts->stats.incomplete += ts->num_pending;
+    ts->num_pending = 0;
+}
+
+/* Client: enable RX software timestamps on a connected socket */
+static inline int rx_timestamp_init(RxTimestamper *ts, int socket, const char *transport,
+                                    FILE *out) {
+    memset(ts, 0, sizeof(*ts));
+    ts->transport = transport;
+    ts->out = out;
+
+    struct sockaddr_in local;
+    socklen_t len = sizeof(local);
+    if (getsockname(socket, (struct sockaddr *)&local, &len) == 0) {
+        ts->port = ntohs(local.sin_port);
+    }
+
+    int flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+    if (setsockopt(socket, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) < 0) {
+        perror("Warning: SO_TIMESTAMPING failed");
+        return -1;
+    }
+    return 0;
+}
+
+/* Attach the control buffer to a msghdr before recvmsg() */
+static inline void rx_timestamp_prepare(RxTimestamper *ts, struct msghdr *msg) {
+    msg->msg_control = ts->control.buf;
+    msg->msg_controllen = sizeof(ts->control.buf);
+}
+
+/* Pick up the RX timestamp after recvmsg() */
+static inline void rx_timestamp_parse(RxTimestamper *ts, struct msghdr *msg) {
+    for (struct cmsghdr *c = CMSG_FIRSTHDR(msg); c; c = CMSG_NXTHDR(msg, c)) {
+        if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPING) {
+            struct scm_timestamping *tss = (struct scm_timestamping *)CMSG_DATA(c);
+            ts->last_rx_ns = timestamp_ns(&tss->ts[0]);
+        }
+    }
+}
+
+/* recv() through recvmsg() so the RX timestamp comes along */
+static inline ssize_t rx_timestamp_recv(RxTimestamper *ts, int socket, void *buf, size_t len,
+                                        int flags) {
+    struct iovec iov = {buf, len};
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    rx_timestamp_prepare(ts, &msg);
+    ssize_t n = recvmsg(socket, &msg, flags);
+    if (n > 0) {
+        rx_timestamp_parse(ts, &msg);
+    }
+    return n;
+}
+
+/* Call when message number `message` of the connection has been received */
+static inline void rx_timestamp_message(RxTimestamper *ts, long long message) {
+    if (!timestamp_sampled(message)) {
+        return;
+    }
+    uint64_t user_ns = timestamp_now_ns();
+    timestamp_record(&ts->stats.kernel_to_user_ns, ts->last_rx_ns, user_ns);
+    ts->stats.samples++;
+    if (ts->out) {
+        fprintf(ts->out, "rx,%s,%d,%lld,%llu,%llu\n", ts->transport, ts->port, message,
+                (unsigned long long)ts->last_rx_ns, (unsigned long long)user_ns);
+    }
+}
+
+static inline void timestamp_breakdown_merge(TimestampBreakdown *total,
+                                             const TimestampBreakdown *b) {
+    total->samples += b->samples;
+    total->incomplete += b->incomplete;
+    latency_hist_merge(&total->user_to_kernel_ns, &b->user_to_kernel_ns);
+    latency_hist_merge(&total->kernel_queue_ns, &b->kernel_queue_ns);
+    latency_hist_merge(&total->ack_ns, &b->ack_ns);
+    latency_hist_merge(&total->kernel_to_user_ns, &b->kernel_to_user_ns);
+}
+
+static inline void timestamp_print_row(const char *name, const LatencyHistogram *h) {
+    if (h->samples == 0) {
+        return;
+    }
+    printf("%-14s %10llu %10.2f %10.2f %10.2f\n", name, h->samples,
+           latency_hist_percentile(h, 50.0) / 1000.0,
+           latency_hist_percentile(h, 99.0) / 1000.0,
+           h->sum_ns / 1000.0 / h->samples);
+}
+
+static inline void timestamp_breakdown_print(const TimestampBreakdown *b) {
+    printf("\n=== Kernel Timestamps (every %dth message) ===\n", TIMESTAMP_SAMPLE_INTERVAL);
+    printf("Samples: %lld, incomplete: %lld\n", b->samples, b->incomplete);
+    printf("%-14s %10s %10s %10s %10s\n", "Component", "Samples", "p50 µs", "p99 µs", "avg µs");
+    timestamp_print_row("user->kernel", &b->user_to_kernel_ns);
+    timestamp_print_row("kernel queue", &b->kernel_queue_ns);
+    timestamp_print_row("send->ack", &b->ack_ns);
+    timestamp_print_row("kernel->user", &b->kernel_to_user_ns);
+}
+
+static inline void json_timestamps(JsonWriter *w, const char *key, const TimestampBreakdown *b) {
+    json_begin_object(w, key);
+    json_int(w, "sample_interval", TIMESTAMP_SAMPLE_INTERVAL);
+    json_int(w, "samples", b->samples);
+    json_int(w, "incomplete", b->incomplete);
+    if (b->user_to_kernel_ns.samples > 0) {
+        json_latency_hist(w, "user_to_kernel_ns", &b->user_to_kernel_ns);
+        json_latency_hist(w, "kernel_queue_ns", &b->kernel_queue_ns);
+        json_latency_hist(w, "ack_ns", &b->ack_ns);
+    }
+    if (b->kernel_to_user_ns.samples > 0) {
+        json_latency_hist(w, "kernel_to_user_ns", &b->kernel_to_user_ns);
+    }
+    json_end_object(w);
+}
+
+#endif /* MT25018_COMMON_TIMESTAMPING_H */
@@ -0,0 +1,204 @@
+/*
+ * MT25018 - Graduate Systems PA02
+ * Common: Binary event trace
+ * A flight recorder for postmortems of throughput dips. The trace file is
+ * mmap'd and split into rings, one per connection handler (or client).
+ * Each ring has a single writer, so recording an event is a TSC read, a
+ * 16-byte store and a release store of the ring head; no locks, no
+ * syscalls, no formatting. A full ring overwrites its oldest events. The
+ * data lives in the page cache, so the trace survives a crashed process.
+ * MT25018_Part_C_trace_analyze.py turns it into timelines and
+ * per-interval statistics.
+ *
+ * File layout: TraceFileHeader (TRACE_HEADER_SIZE bytes), then per ring a
+ * TraceRingHeader followed by ring_events TraceEvents.
+ */
+
+#ifndef MT25018_COMMON_TRACE_H
+#define MT25018_COMMON_TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#include "MT25018_Common_SyscallProbe.h"
+
+#define TRACE_MAGIC "MT25TRC1"
+#define TRACE_VERSION 1
+#define TRACE_HEADER_SIZE 128
+#define TRACE_DEFAULT_EVENTS 65536      /* per ring: 1 MiB */
+#define TRACE_MAX_RINGS 1024
+
+/* Event types */
+#define TRACE_SEND_BEGIN 1
+#define TRACE_SEND_END 2                /* value: bytes or -1, err: errno */
+#define TRACE_RECV_BEGIN 3
+#define TRACE_RECV_END 4                /* value: bytes or -1, err: errno */
+#define TRACE_ZEROCOPY_DONE 5           /* value: sends completed, aux: 1 if copied */
+#define TRACE_CONN_START 6              /* value: thread id */
+#define TRACE_CONN_END 7
+
+typedef struct {
+    uint64_t ticks;                     /* probe_ticks(): TSC on x86 */
+    int32_t value;
+    uint8_t type;
+    uint8_t err;                        /* errno, saturated at 255 */
+    uint16_t aux;                       /* send path for adaptive senders */
+} TraceEvent;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t num_rings;
+    uint32_t ring_events;               /* power of two */
+    uint32_t event_size;
+    uint64_t start_ticks;
+    uint64_t start_realtime_ns;
+    double ticks_per_ns;                /* refined by trace_close() */
+    uint32_t closed;
+    uint32_t reserved;
+    char role[8];
+    char transport[16];
+} TraceFileHeader;
+
+typedef struct {
+    uint64_t head;                      /* events ever written to the ring */
+    uint32_t owner;                     /* thread id of the writer, 0 = free */
+    uint32_t reserved;
+    uint64_t pad[6];
+} TraceRingHeader;
+
+/* A writer's view of its ring; NULL when tracing is off */
+typedef struct {
+    TraceRingHeader *hdr;
+    TraceEvent *events;
+    uint64_t mask;
+} TraceRing;
+
+typedef struct {
+    TraceFileHeader *hdr;
+    void *map;
+    size_t size;
+    uint64_t start_ns;                  /* CLOCK_MONOTONIC_RAW at open */
+} TraceFile;
+
+static inline size_t trace_ring_bytes(uint32_t ring_events) {
+    return sizeof(TraceRingHeader) + (size_t)ring_events * sizeof(TraceEvent);
+}
+
+/* Create the trace file with num_rings rings of at least ring_events
+ * events each (rounded up to a power of two); returns 0 or -1 */
+static inline int trace_open(TraceFile *t, const char *path, int num_rings, int ring_events,
+                             const char *role, const char *transport) {
+    memset(t, 0, sizeof(*t));
+    if (num_rings < 1) num_rings = 1;
+    if (num_rings > TRACE_MAX_RINGS) num_rings = TRACE_MAX_RINGS;
+    uint32_t events = 1;
+    while (events < (uint32_t)(ring_events > 0 ? ring_events : TRACE_DEFAULT_EVENTS)) {
+        events <<= 1;
+    }
+
+    size_t size = TRACE_HEADER_SIZE + (size_t)num_rings * trace_ring_bytes(events);
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror("open failed for trace file");
+        return -1;
+    }
+    if (ftruncate(fd, size) < 0) {
+        perror("ftruncate failed for trace file");
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("mmap failed for trace file");
+        return -1;
+    }
+
+    syscall_probe_calibrate();
+    struct timespec real;
+    clock_gettime(CLOCK_REALTIME, &real);
+    t->map = map;
+    t->size = size;
+    t->hdr = (TraceFileHeader *)map;
+    t->start_ns = probe_monotonic_ns();
+    memcpy(t->hdr->magic, TRACE_MAGIC, sizeof(t->hdr->magic));
+    t->hdr->version = TRACE_VERSION;
+    t->hdr->num_rings = num_rings;
+    t->hdr->ring_events = events;
+    t->hdr->event_size = sizeof(TraceEvent);
+    t->hdr->start_ticks = probe_ticks();
+    t->hdr->start_realtime_ns = (uint64_t)real.tv_sec * 1000000000ULL + real.tv_nsec;
+    t->hdr->ticks_per_ns = probe_ticks_per_ns;
+    snprintf(t->hdr->role, sizeof(t->hdr->role), "%s", role);
+    snprintf(t->hdr->transport, sizeof(t->hdr->transport), "%s", transport);
+    return 0;
+}
+
+static inline void trace_event(TraceRing *r, uint8_t type, int32_t value, int err, uint16_t aux) {
+    if (!r) {
+        return;
+    }
+    uint64_t head = r->hdr->head;
+    TraceEvent *e = &r->events[head & r->mask];
+    e->ticks = probe_ticks();
+    e->value = value;
+    e->type = type;
+    e->err = err > 255 ? 255 : (uint8_t)err;
+    e->aux = aux;
+    __atomic_store_n(&r->hdr->head, head + 1, __ATOMIC_RELEASE);
+}
+
+/* Claim a free ring for thread owner (> 0); returns ring, or NULL when
+ * tracing is off or every ring is taken */
+static inline TraceRing *trace_ring_acquire(TraceFile *t, TraceRing *ring, uint32_t owner) {
+    if (!t->hdr) {
+        return NULL;
+    }
+    uint8_t *base = (uint8_t *)t->map + TRACE_HEADER_SIZE;
+    for (uint32_t i = 0; i < t->hdr->num_rings; i++) {
+        TraceRingHeader *hdr = (TraceRingHeader *)(base + i * trace_ring_bytes(t->hdr->ring_events));
+        uint32_t free_owner = 0;
+        if (__atomic_compare_exchange_n(&hdr->owner, &free_owner, owner, 0,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            ring->hdr = hdr;
+            ring->events = (TraceEvent *)(hdr + 1);
+            ring->mask = t->hdr->ring_events - 1;
+            trace_event(ring, TRACE_CONN_START, (int32_t)owner, 0, 0);
+            return ring;
+        }
+    }
+    return NULL;
+}
+
+/* Mark the end of the connection and hand the ring to the next one */
+static inline void trace_ring_release(TraceRing *r) {
+    if (!r) {
+        return;
+    }
+    trace_event(r, TRACE_CONN_END, 0, 0, 0);
+    __atomic_store_n(&r->hdr->owner, 0, __ATOMIC_RELEASE);
+}
+
+/* Refine the tick rate over the whole run and flush the file. Handlers
+ * still running after the server's shutdown wait may keep writing, so the
+ * mapping stays in place until the process exits. */
+static inline void trace_close(TraceFile *t) {
+    if (!t->hdr) {
+        return;
+    }
+    uint64_t ticks = probe_ticks();
+    uint64_t ns = probe_monotonic_ns();
+    if (ns > t->start_ns && ticks > t->hdr->start_ticks) {
+        t->hdr->ticks_per_ns = (double)(ticks - t->hdr->start_ticks) / (ns - t->start_ns);
+    }
+    t->hdr->closed = 1;
+    msync(t->map, t->size, MS_ASYNC);
+}
+
+#endif /* MT25018_COMMON_TRACE_H */
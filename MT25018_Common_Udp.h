@@ -0,0 +1,573 @@
+/*
+ * MT25018 - Graduate Systems PA02
+ * Common: UDP datagram transport
+ * A message is cut into datagrams of at most UDP_DATAGRAM_SIZE bytes, each
+ * led by a UdpHeader. The sender hands the kernel several datagrams per
+ * sendmmsg() call and, with GSO, several equal-sized datagrams per msghdr
+ * (UDP_SEGMENT). The receiver takes them with recvmmsg(), with GRO merging
+ * consecutive datagrams into one buffer (UDP_GRO), and uses the sequence
+ * numbers to count lost and reordered datagrams and to reassemble messages.
+ */
+
+#ifndef MT25018_COMMON_UDP_H
+#define MT25018_COMMON_UDP_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <linux/errqueue.h>
+
+#include "MT25018_Common_Results.h"
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+
+/* Largest datagram that fits a 1500-byte MTU without IP fragmentation */
+#define UDP_DATAGRAM_SIZE 1472
+/* Datagrams per GSO send (kernel UDP_MAX_SEGMENTS) */
+#define UDP_MAX_GSO_SEGMENTS 64
+/* Bytes per GSO send, below the 64 KB IP packet limit */
+#define UDP_MAX_GSO_BYTES 65000
+/* msghdrs per sendmmsg()/recvmmsg() call */
+#define UDP_DEFAULT_BATCH 16
+/* Pages one MSG_ZEROCOPY send may pin: every iovec becomes a page
+ * fragment of a single skb (MAX_SKB_FRAGS is 17) */
+#define UDP_ZEROCOPY_MAX_PAGES 16
+/* Header slots in flight with MSG_ZEROCOPY, in batches */
+#define UDP_HEADER_RING 8
+#define UDP_SOCKET_BUFFER (8 * 1024 * 1024)
+
+/* Control datagrams (hello, bye) are shorter than any data datagram */
+#define UDP_CONTROL_MAGIC 0x4d543235u
+#define UDP_HELLO 1
+#define UDP_BYE 2
+
+typedef struct {
+    uint32_t magic;
+    uint32_t kind;
+} UdpControl;
+
+/* Leads every data datagram; the message index is seq - segment */
+typedef struct {
+    uint64_t seq;               /* datagram number within the flow */
+    uint64_t send_ns;           /* CLOCK_REALTIME when the batch was built */
+    uint32_t segment;           /* datagram number within the message */
+    uint32_t segments;          /* datagrams per message */
+} UdpHeader;
+
+#define UDP_PAYLOAD ((int)(UDP_DATAGRAM_SIZE - sizeof(UdpHeader)))
+
+static inline uint64_t udp_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline int udp_segments(int message_size) {
+    return message_size > 0 ? (message_size + UDP_PAYLOAD - 1) / UDP_PAYLOAD : 1;
+}
+
+/* Payload bytes of one datagram of a message */
+static inline int udp_segment_bytes(int message_size, int segment, int segments) {
+    return segment < segments - 1 ? UDP_PAYLOAD : message_size - (segments - 1) * UDP_PAYLOAD;
+}
+
+static inline int udp_send_control(int socket, const struct sockaddr_in *to, uint32_t kind) {
+    UdpControl c = {UDP_CONTROL_MAGIC, kind};
+    return sendto(socket, &c, sizeof(c), 0, (const struct sockaddr *)to,
+                  to ? sizeof(*to) : 0) == sizeof(c) ? 0 : -1;
+}
+
+/* Kind of a received datagram if it is a control datagram, else 0 */
+static inline uint32_t udp_control_kind(const void *buf, ssize_t len) {
+    UdpControl c;
+    if (len != (ssize_t)sizeof(c)) {
+        return 0;
+    }
+    memcpy(&c, buf, sizeof(c));
+    return c.magic == UDP_CONTROL_MAGIC ? c.kind : 0;
+}
+
+/* Large socket buffers; SO_*BUFFORCE passes net.core.*mem_max when root */
+static inline void udp_set_buffer(int socket, int optname, int force_optname) {
+    int size = UDP_SOCKET_BUFFER;
+    if (setsockopt(socket, SOL_SOCKET, force_optname, &size, sizeof(size)) < 0) {
+        setsockopt(socket, SOL_SOCKET, optname, &size, sizeof(size));
+    }
+}
+
+/* ---- Sender ---- */
+
+typedef struct {
+    char **fields;
+    int num_fields;
+    int field_size;
+    int message_size;
+    int segments;
+    int gso;
+    int zerocopy;
+    int batch;
+    int max_iov;                /* iovecs per datagram */
+    uint64_t next_seq;          /* first datagram not yet sent */
+    UdpHeader *headers;         /* UDP_HEADER_RING slots of batch * 64 headers */
+    struct mmsghdr *msgs;
+    struct iovec *iov;
+    char *control;
+    int *units;                 /* datagrams per msghdr of the current batch */
+    long long batches;
+    /* MSG_ZEROCOPY: notification ids handed out and completed */
+    uint64_t zc_sends;
+    uint64_t zc_completed;
+    uint64_t zc_copied;
+    uint64_t ring_end[UDP_HEADER_RING];
+    /* Totals */
+    long long bytes;
+    long long datagrams;
+    long long send_calls;
+    long long zc_waits;
+} UdpSender;
+
+#define UDP_CONTROL_SPACE CMSG_SPACE(sizeof(uint16_t))
+
+static inline int udp_sender_init(UdpSender *s, char **fields, int num_fields, int field_size,
+                                  int gso, int zerocopy, int batch) {
+    memset(s, 0, sizeof(*s));
+    s->fields = fields;
+    s->num_fields = num_fields;
+    s->field_size = field_size;
+    s->message_size = field_size * num_fields;
+    s->segments = udp_segments(s->message_size);
+    s->gso = gso;
+    s->zerocopy = zerocopy;
+    s->batch = batch > 0 ? batch : UDP_DEFAULT_BATCH;
+    s->max_iov = num_fields + 2;
+
+    int per_msg = gso ? UDP_MAX_GSO_SEGMENTS : 1;
+    size_t slots = (size_t)s->batch * per_msg;
+    s->headers = (UdpHeader *)calloc(slots * UDP_HEADER_RING, sizeof(UdpHeader));
+    s->msgs = (struct mmsghdr *)calloc(s->batch, sizeof(struct mmsghdr));
+    s->iov = (struct iovec *)calloc(slots * s->max_iov, sizeof(struct iovec));
+    s->control = (char *)calloc(s->batch, UDP_CONTROL_SPACE);
+    s->units = (int *)calloc(s->batch, sizeof(int));
+    if (!s->headers || !s->msgs || !s->iov || !s->control || !s->units) {
+        perror("calloc failed for UDP sender");
+        free(s->headers); free(s->msgs); free(s->iov); free(s->control); free(s->units);
+        return -1;
+    }
+    return 0;
+}
+
+static inline void udp_sender_free(UdpSender *s) {
+    free(s->headers);
+    free(s->msgs);
+    free(s->iov);
+    free(s->control);
+    free(s->units);
+}
+
+/* Point iov at the header and payload of datagram seq; returns iovecs used */
+static inline int udp_sender_datagram(UdpSender *s, uint64_t seq, UdpHeader *h, uint64_t now,
+                                      struct iovec *iov, int *len) {
+    int segment = (int)(seq % s->segments);
+    int bytes = udp_segment_bytes(s->message_size, segment, s->segments);
+    h->seq = seq;
+    h->send_ns = now;
+    h->segment = segment;
+    h->segments = s->segments;
+    iov[0].iov_base = h;
+    iov[0].iov_len = sizeof(*h);
+
+    /* The payload is bytes [offset, offset + bytes) of the fields laid end to end */
+    int n = 1;
+    long offset = (long)segment * UDP_PAYLOAD;
+    int left = bytes;
+    while (left > 0) {
+        int field = offset / s->field_size;
+        int within = offset % s->field_size;
+        int chunk = s->field_size - within < left ? s->field_size - within : left;
+        iov[n].iov_base = s->fields[field] + within;
+        iov[n].iov_len = chunk;
+        n++;
+        offset += chunk;
+        left -= chunk;
+    }
+    *len = (int)sizeof(*h) + bytes;
+    return n;
+}
+
+/* Pages spanned by n iovecs */
+static inline int udp_iov_pages(const struct iovec *iov, int n) {
+    int pages = 0;
+    for (int i = 0; i < n; i++) {
+        uintptr_t first = (uintptr_t)iov[i].iov_base / 4096;
+        uintptr_t last = ((uintptr_t)iov[i].iov_base + iov[i].iov_len - 1) / 4096;
+        pages += (int)(last - first) + 1;
+    }
+    return pages;
+}
+
+/* Count MSG_ZEROCOPY notifications; one covers send calls ee_info..ee_data */
+static inline void udp_sender_reap(UdpSender *s, int socket) {
+    char control[128];
+    for (;;) {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(socket, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+            break;
+        }
+        for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+            struct sock_extended_err *serr = (struct sock_extended_err *)CMSG_DATA(cm);
+            if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+                continue;
+            }
+            uint64_t sends = serr->ee_data - serr->ee_info + 1;
+            s->zc_completed += sends;
+            if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+                s->zc_copied += sends;
+            }
+        }
+    }
+}
+
+/* With MSG_ZEROCOPY the kernel reads the headers after sendmmsg() returns,
+ * so a ring slot is only refilled once its sends have completed. The wait
+ * is bounded: a kernel that hands out fewer ids than sends must not stall. */
+static inline void udp_sender_wait_slot(UdpSender *s, int socket, int slot) {
+    for (int tries = 0; s->zc_completed < s->ring_end[slot] && tries < 1000; tries++) {
+        struct pollfd pfd = {socket, 0, 0};
+        if (tries > 0) {
+            poll(&pfd, 1, 1);
+            s->zc_waits += tries == 1;
+        }
+        udp_sender_reap(s, socket);
+    }
+}
+
+/* Send one batch from next_seq on. Returns datagrams sent, 0 when the
+ * kernel had no room, or -1 on an error (errno set, e.g. ECONNREFUSED
+ * once the peer has gone). */
+static inline int udp_sender_send(UdpSender *s, int socket) {
+    int slot = (int)(s->batches % UDP_HEADER_RING);
+    if (s->zerocopy) {
+        udp_sender_wait_slot(s, socket, slot);
+    }
+    int per_msg = s->gso ? UDP_MAX_GSO_SEGMENTS : 1;
+    UdpHeader *headers = s->headers + (size_t)slot * s->batch * per_msg;
+    uint64_t now = udp_now_ns();
+    uint64_t seq = s->next_seq;
+    int h = 0;
+
+    for (int m = 0; m < s->batch; m++) {
+        struct iovec *iov = s->iov + (size_t)h * s->max_iov;
+        int iovlen = 0;
+        int first_len = 0;
+        int count = 0;
+        int total = 0;
+        int pages = 0;
+        /* One GSO unit: equal-sized datagrams, only the last may be shorter */
+        while (count < per_msg) {
+            int len;
+            int segment = (int)(seq % s->segments);
+            int next_len = (int)sizeof(UdpHeader) +
+                           udp_segment_bytes(s->message_size, segment, s->segments);
+            if (count > 0 && (next_len > first_len || total + next_len > UDP_MAX_GSO_BYTES)) {
+                break;
+            }
+            int n = udp_sender_datagram(s, seq, &headers[h], now, iov + iovlen, &len);
+            if (s->zerocopy) {
+                int datagram_pages = udp_iov_pages(iov + iovlen, n);
+                if (count > 0 && pages + datagram_pages > UDP_ZEROCOPY_MAX_PAGES) {
+                    break;
+                }
+                pages += datagram_pages;
+            }
+            iovlen += n;
+            if (count == 0) {
+                first_len = len;
+            }
+            total += len;
+            count++;
+            h++;
+            seq++;
+            if (len < first_len) {
+                break;
+            }
+        }
+
+        struct msghdr *msg = &s->msgs[m].msg_hdr;
+        memset(msg, 0, sizeof(*msg));
+        msg->msg_iov = iov;
+        msg->msg_iovlen = iovlen;
+        if (count > 1) {
+            char *control = s->control + (size_t)m * UDP_CONTROL_SPACE;
+            memset(control, 0, UDP_CONTROL_SPACE);
+            msg->msg_control = control;
+            msg->msg_controllen = UDP_CONTROL_SPACE;
+            struct cmsghdr *cm = CMSG_FIRSTHDR(msg);
+            cm->cmsg_level = SOL_UDP;
+            cm->cmsg_type = UDP_SEGMENT;
+            cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+            uint16_t gso_size = (uint16_t)first_len;
+            memcpy(CMSG_DATA(cm), &gso_size, sizeof(gso_size));
+        }
+        s->units[m] = count;
+    }
+
+    int sent = sendmmsg(socket, s->msgs, s->batch, s->zerocopy ? MSG_ZEROCOPY : 0);
+    s->send_calls++;
+    if (sent < 0) {
+        return (errno == EAGAIN || errno == ENOBUFS || errno == EINTR) ? 0 : -1;
+    }
+
+    /* Unsent msghdrs are rebuilt from the same sequence numbers next time */
+    int datagrams = 0;
+    for (int m = 0; m < sent; m++) {
+        datagrams += s->units[m];
+    }
+    for (int i = 0; i < datagrams; i++) {
+        s->bytes += udp_segment_bytes(s->message_size, (int)((s->next_seq + i) % s->segments),
+                                      s->segments);
+    }
+    s->next_seq += datagrams;
+    s->datagrams += datagrams;
+    if (s->zerocopy) {
+        s->zc_sends += sent;
+        s->ring_end[slot] = s->zc_sends;
+    }
+    s->batches++;
+    return datagrams;
+}
+
+/* Messages whose datagrams have all been handed to the kernel */
+static inline long long udp_sender_messages(const UdpSender *s) {
+    return (long long)(s->next_seq / s->segments);
+}
+
+/* Bounded wait for outstanding MSG_ZEROCOPY notifications before exit */
+static inline void udp_sender_drain(UdpSender *s, int socket) {
+    for (int tries = 0; s->zerocopy && s->zc_completed < s->zc_sends && tries < 100; tries++) {
+        struct pollfd pfd = {socket, 0, 0};
+        poll(&pfd, 1, 1);
+        udp_sender_reap(s, socket);
+    }
+}
+
+/* ---- Receiver ---- */
+
+typedef struct {
+    int batch;
+    int gro;
+    size_t buffer_size;
+    char *buffers;
+    struct mmsghdr *msgs;
+    struct iovec *iov;
+    char *control;
+    struct sockaddr_in *peers;
+    /* Iteration over the datagrams of the last batch */
+    int received;
+    int index;
+    int offset;
+    int gso_size;
+    /* Sequence accounting */
+    uint64_t expected;
+    long long datagrams;
+    long long lost;
+    long long reordered;
+    /* Reassembly of the message in progress */
+    uint64_t message_seq;
+    uint32_t message_received;
+    int message_active;
+    long long incomplete;
+    /* Totals */
+    long long recv_calls;
+    long long buffers_received;
+    long long payload_bytes;
+} UdpReceiver;
+
+#define UDP_GRO_CONTROL_SPACE CMSG_SPACE(sizeof(int))
+
+static inline int udp_receiver_init(UdpReceiver *r, int batch, int gro) {
+    memset(r, 0, sizeof(*r));
+    r->batch = batch > 0 ? batch : UDP_DEFAULT_BATCH;
+    r->gro = gro;
+    r->buffer_size = gro ? 65536 : UDP_DATAGRAM_SIZE;
+    r->buffers = (char *)malloc(r->batch * r->buffer_size);
+    r->msgs = (struct mmsghdr *)calloc(r->batch, sizeof(struct mmsghdr));
+    r->iov = (struct iovec *)calloc(r->batch, sizeof(struct iovec));
+    r->control = (char *)calloc(r->batch, UDP_GRO_CONTROL_SPACE);
+    r->peers = (struct sockaddr_in *)calloc(r->batch, sizeof(struct sockaddr_in));
+    if (!r->buffers || !r->msgs || !r->iov || !r->control || !r->peers) {
+        perror("malloc failed for UDP receiver");
+        free(r->buffers); free(r->msgs); free(r->iov); free(r->control); free(r->peers);
+        return -1;
+    }
+    return 0;
+}
+
+static inline void udp_receiver_free(UdpReceiver *r) {
+    free(r->buffers);
+    free(r->msgs);
+    free(r->iov);
+    free(r->control);
+    free(r->peers);
+}
+
+/* Receive at least one buffer; returns buffers received or -1 (errno set,
+ * EAGAIN on SO_RCVTIMEO timeout) */
+static inline int udp_receiver_recv(UdpReceiver *r, int socket) {
+    for (int i = 0; i < r->batch; i++) {
+        r->iov[i].iov_base = r->buffers + (size_t)i * r->buffer_size;
+        r->iov[i].iov_len = r->buffer_size;
+        struct msghdr *msg = &r->msgs[i].msg_hdr;
+        memset(msg, 0, sizeof(*msg));
+        msg->msg_iov = &r->iov[i];
+        msg->msg_iovlen = 1;
+        msg->msg_name = &r->peers[i];
+        msg->msg_namelen = sizeof(r->peers[i]);
+        if (r->gro) {
+            msg->msg_control = r->control + (size_t)i * UDP_GRO_CONTROL_SPACE;
+            msg->msg_controllen = UDP_GRO_CONTROL_SPACE;
+        }
+    }
+    int n = recvmmsg(socket, r->msgs, r->batch, MSG_WAITFORONE, NULL);
+    r->recv_calls++;
+    r->received = n > 0 ? n : 0;
+    r->index = 0;
+    r->offset = 0;
+    r->gso_size = -1;
+    if (n > 0) {
+        r->buffers_received += n;
+    }
+    return n;
+}
+
+/* Next datagram of the batch, NULL when done; control datagrams and runts
+ * are skipped. *len is the payload length. */
+static inline const UdpHeader *udp_receiver_next(UdpReceiver *r, int *len) {
+    while (r->index < r->received) {
+        struct msghdr *msg = &r->msgs[r->index].msg_hdr;
+        int total = (int)r->msgs[r->index].msg_len;
+        if (r->gso_size < 0) {
+            /* A GRO buffer holds datagrams of gso_size bytes, the last may be shorter */
+            r->gso_size = total;
+            for (struct cmsghdr *cm = CMSG_FIRSTHDR(msg); cm; cm = CMSG_NXTHDR(msg, cm)) {
+                if (cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO) {
+                    int size;
+                    memcpy(&size, CMSG_DATA(cm), sizeof(size));
+                    if (size > 0) {
+                        r->gso_size = size;
+                    }
+                }
+            }
+        }
+        if (r->offset < total) {
+            char *datagram = (char *)r->iov[r->index].iov_base + r->offset;
+            int size = total - r->offset < r->gso_size ? total - r->offset : r->gso_size;
+            r->offset += size;
+            if (size >= (int)sizeof(UdpHeader)) {
+                *len = size - (int)sizeof(UdpHeader);
+                return (const UdpHeader *)datagram;
+            }
+            continue;
+        }
+        r->index++;
+        r->offset = 0;
+        r->gso_size = -1;
+    }
+    return NULL;
+}
+
+/* Account one datagram: a gap in the sequence counts as lost until the
+ * missing datagrams arrive late, which then count as reordered. Returns 1
+ * when the datagram completes its message. */
+static inline int udp_receiver_account(UdpReceiver *r, const UdpHeader *h, int len) {
+    r->datagrams++;
+    r->payload_bytes += len;
+    if (h->seq == r->expected) {
+        r->expected++;
+    } else if (h->seq > r->expected) {
+        r->lost += h->seq - r->expected;
+        r->expected = h->seq + 1;
+    } else {
+        r->reordered++;
+        if (r->lost > 0) {
+            r->lost--;
+        }
+        /* Too late for reassembly: its message has been given up */
+        return 0;
+    }
+
+    uint64_t message_seq = h->seq - h->segment;
+    if (!r->message_active || message_seq != r->message_seq) {
+        if (r->message_active) {
+            r->incomplete++;
+        }
+        r->message_seq = message_seq;
+        r->message_received = 0;
+        r->message_active = 1;
+    }
+    if (++r->message_received == h->segments) {
+        r->message_active = 0;
+        return 1;
+    }
+    return 0;
+}
+
+/* Sender address of the current datagram */
+static inline const struct sockaddr_in *udp_receiver_peer(const UdpReceiver *r) {
+    return &r->peers[r->index < r->received ? r->index : 0];
+}
+
+static inline void udp_receiver_print(const UdpReceiver *r) {
+    long long expected = r->datagrams + r->lost;
+    printf("\n=== UDP (recvmmsg batch %d, GRO %s) ===\n", r->batch, r->gro ? "on" : "off");
+    printf("Datagrams: %lld received, %lld lost (%.3f%%), %lld reordered\n",
+           r->datagrams, r->lost, expected > 0 ? r->lost * 100.0 / expected : 0.0,
+           r->reordered);
+    printf("Incomplete messages: %lld\n", r->incomplete);
+    printf("Per recvmmsg(): %.2f buffers, %.2f datagrams\n",
+           r->recv_calls > 0 ? (double)r->buffers_received / r->recv_calls : 0.0,
+           r->recv_calls > 0 ? (double)r->datagrams / r->recv_calls : 0.0);
+}
+
+static inline void json_udp_receiver(JsonWriter *w, const char *key, const UdpReceiver *r) {
+    long long expected = r->datagrams + r->lost;
+    json_begin_object(w, key);
+    json_int(w, "batch", r->batch);
+    json_int(w, "gro", r->gro);
+    json_int(w, "datagrams", r->datagrams);
+    json_int(w, "lost", r->lost);
+    json_double(w, "loss_pct", expected > 0 ? r->lost * 100.0 / expected : 0.0);
+    json_int(w, "reordered", r->reordered);
+    json_int(w, "incomplete_messages", r->incomplete);
+    json_int(w, "payload_bytes", r->payload_bytes);
+    json_int(w, "recv_calls", r->recv_calls);
+    json_double(w, "datagrams_per_call", r->recv_calls > 0 ?
+                (double)r->datagrams / r->recv_calls : 0.0);
+    json_end_object(w);
+}
+
+#endif /* MT25018_COMMON_UDP_H */
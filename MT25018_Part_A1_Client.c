@@ -13,20 +13,36 @@
 #include <sys/time.h>
 #include <errno.h>
 #include <time.h>
+#include <signal.h>
+#include <getopt.h>
+
+#include "MT25018_Common_PerfCounters.h"
+#include "MT25018_Common_SyscallProbe.h"
+#include "MT25018_Common_Results.h"
+#include "MT25018_Common_Churn.h"
+#include "MT25018_Common_Duplex.h"
+#include "MT25018_Common_Timestamping.h"
+#include "MT25018_Common_Metrics.h"
+#include "MT25018_Common_Mptcp.h"
+#include "MT25018_Common_Specialize.h"
+#include "MT25018_Common_Trace.h"
+#include "MT25018_Common_ReqResp.h"
+#include "MT25018_Common_SteadyState.h"
+#include "MT25018_Common_RecvStrategy.h"
+#include "MT25018_Common_FanIn.h"
+#include "MT25018_Common_ClientResults.h"
 
 #define PORT 8080
 #define NUM_STRING_FIELDS 8
 
-/* Client statistics */
-typedef struct {
-    long long total_bytes_received;
-    long long total_messages_received;
-    double total_latency_us;
-    long long latency_samples;
-} ClientStats;
+/* Live metrics endpoint (--metrics) */
+MetricsExporter metrics;
+TraceFile trace_file;
 
 /* Receive message using recv() - baseline two-copy approach */
-int recv_message_twocopy(int socket, int field_size) {
+int recv_message_twocopy(int socket, int field_size, SyscallProbe *probe,
+                         RxTimestamper *rx_ts) {
+    field_size = FIELD_SIZE(field_size);
     char *buffer = (char *)malloc(field_size);
     if (!buffer) {
         perror("malloc failed");
@@ -39,7 +55,11 @@ int recv_message_twocopy(int socket, int field_size) {
     for (int i = 0; i < NUM_STRING_FIELDS; i++) {
         int bytes_received = 0;
         while (bytes_received < field_size) {
-            int n = recv(socket, buffer + bytes_received, field_size - bytes_received, 0);
+            uint64_t t0 = syscall_probe_begin(probe);
+            int n = rx_ts ? rx_timestamp_recv(rx_ts, socket, buffer + bytes_received,
+                                              field_size - bytes_received, 0)
+                          : recv(socket, buffer + bytes_received, field_size - bytes_received, 0);
+            syscall_probe_end(probe, i, t0, n, field_size - bytes_received);
             if (n <= 0) {
                 free(buffer);
                 return -1;
@@ -53,6 +73,56 @@ int recv_message_twocopy(int socket, int field_size) {
     return total_received;
 }
 
+/* recv_message_twocopy() as a coroutine for the fan-in engine: the socket is
+ * non-blocking and the coroutine yields where recv() would block */
+int recv_message_twocopy_coro(FanInConn *c, int field_size, char *buffer) {
+    field_size = FIELD_SIZE(field_size);
+    CORO_BEGIN(c);
+    for (c->field = 0; c->field < NUM_STRING_FIELDS; c->field++) {
+        c->offset = 0;
+        while (c->offset < (size_t)field_size) {
+            int n = recv(c->fd, buffer + c->offset, field_size - c->offset, 0);
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                CORO_YIELD(c, FANIN_BLOCKED);
+                continue;
+            }
+            if (n <= 0) {
+                return -1;
+            }
+            c->offset += n;
+        }
+    }
+    CORO_END(c);
+    
+    return field_size * NUM_STRING_FIELDS;
+}
+
+/* Send message fields one by one using send() (full-duplex mode) */
+int send_message_twocopy(int socket, char **fields, int field_size) {
+    field_size = FIELD_SIZE(field_size);
+    int total_sent = 0;
+    
+    for (int i = 0; i < NUM_STRING_FIELDS; i++) {
+        int bytes_sent = send(socket, fields[i], field_size, 0);
+        if (bytes_sent < 0) return -1;
+        total_sent += bytes_sent;
+    }
+    
+    return total_sent;
+}
+
+/* Send side of a full-duplex connection */
+typedef struct {
+    int socket;
+    int field_size;
+    char *fields[NUM_STRING_FIELDS];
+} DuplexSendArgs;
+
+int duplex_send(void *arg) {
+    DuplexSendArgs *tx = (DuplexSendArgs *)arg;
+    return send_message_twocopy(tx->socket, tx->fields, tx->field_size);
+}
+
 /* Get current time in microseconds */
 long long get_time_us() {
     struct timeval tv;
@@ -60,35 +130,263 @@ long long get_time_us() {
     return (long long)tv.tv_sec * 1000000 + tv.tv_usec;
 }
 
+/* Get monotonic time in nanoseconds (per-message latency) */
+long long get_time_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* Print command line usage */
+void print_usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [options] <server_ip> <message_size> <duration_seconds>\n", prog);
+    fprintf(stderr, "  server_ip: IP address of the server\n");
+    fprintf(stderr, "  message_size: Total message size in bytes (must be multiple of 8)\n");
+    fprintf(stderr, "  duration_seconds: How long to run the test\n");
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  --perf-counters  Count cycles/instructions/cache misses around\n");
+    fprintf(stderr, "                   the receive loop (perf_event_open)\n");
+    fprintf(stderr, "  --syscall-probe  Time every recv() call with the TSC and dump\n");
+    fprintf(stderr, "                   per-field histograms and error counts at exit\n");
+    fprintf(stderr, "  --json PATH      Append a JSON-lines result record to PATH\n");
+    fprintf(stderr, "  --churn MSGS     Reconnect after every MSGS messages and report\n");
+    fprintf(stderr, "                   connections/s and connect-to-first-byte latency\n");
+    fprintf(stderr, "  --fastopen       Send the churn hello in the SYN (TCP Fast Open)\n");
+    fprintf(stderr, "  --duplex         Also send messages to the server from a second\n");
+    fprintf(stderr, "                   thread (server must use --duplex too)\n");
+    fprintf(stderr, "  --recv-strategy S  Receive with S instead of per-field recv():\n");
+    fprintf(stderr, "                   field, waitall, bulk, iovec or ring\n");
+    fprintf(stderr, "  --ring           Same as --recv-strategy ring (bulk reads into a\n");
+    fprintf(stderr, "                   double-mapped ring, messages parsed in place)\n");
+    fprintf(stderr, "  --connections N  Fan-in mode: open N non-blocking connections and\n");
+    fprintf(stderr, "                   receive on all of them with epoll and coroutines\n");
+    fprintf(stderr, "  --engine-threads T  Threads sharing the fan-in connections\n");
+    fprintf(stderr, "                   (default: one per CPU, at most 4)\n");
+    fprintf(stderr, "  --timestamps PATH  Trace every %d-th message with SO_TIMESTAMPING\n",
+            TIMESTAMP_SAMPLE_INTERVAL);
+    fprintf(stderr, "                   RX timestamps and append CSV lines to PATH\n");
+    fprintf(stderr, "  --metrics PORT   Serve live counters and the latency histogram in\n");
+    fprintf(stderr, "                   Prometheus text format on http://127.0.0.1:PORT/metrics\n");
+    fprintf(stderr, "  --warmup SEC     Receive for SEC seconds before measuring (the test\n");
+    fprintf(stderr, "                   then runs for duration_seconds more)\n");
+    fprintf(stderr, "  --steady-state   Report only the steady window: from the first %d\n",
+            STEADY_WINDOW);
+    fprintf(stderr, "                   %d ms intervals whose throughput CV is below the\n",
+            STEADY_INTERVAL_MS);
+    fprintf(stderr, "                   threshold to the end of the run\n");
+    fprintf(stderr, "  --steady-cv PCT  Steady-state CV threshold in percent (default %.0f)\n",
+            STEADY_DEFAULT_CV_PCT);
+    fprintf(stderr, "  --mptcp          Connect with IPPROTO_MPTCP (falls back to TCP when\n");
+    fprintf(stderr, "                   the kernel has no MPTCP support)\n");
+    fprintf(stderr, "  --trace PATH     Record receive begin/end of every message into a\n");
+    fprintf(stderr, "                   binary trace file\n");
+    fprintf(stderr, "  --trace-events N Trace ring size in events (default %d)\n",
+            TRACE_DEFAULT_EVENTS);
+    fprintf(stderr, "  --rr PORT        Latency-sensitive flow: exchange message_size-byte\n");
+    fprintf(stderr, "                   requests and responses with a server's --rr-port\n");
+    fprintf(stderr, "                   instead of streaming, and report round-trip times\n");
+    fprintf(stderr, "  --rr-interval US One request every US microseconds (default %d,\n",
+            RR_DEFAULT_INTERVAL_US);
+    fprintf(stderr, "                   0 = back to back)\n");
+    fprintf(stderr, "  --class-mark     Mark the socket as bulk (TC_PRIO_BULK/IPTOS_THROUGHPUT),\n");
+    fprintf(stderr, "                   or with --rr as TC_PRIO_INTERACTIVE/IPTOS_LOWDELAY\n");
+}
+
 int main(int argc, char *argv[]) {
-    if (argc != 4) {
-        fprintf(stderr, "Usage: %s <server_ip> <message_size> <duration_seconds>\n", argv[0]);
-        fprintf(stderr, "  server_ip: IP address of the server\n");
-        fprintf(stderr, "  message_size: Total message size in bytes (must be multiple of 8)\n");
-        fprintf(stderr, "  duration_seconds: How long to run the test\n");
+    int perf_counters = 0;
+    int syscall_probe = 0;
+    const char *json_path = NULL;
+    int churn_messages = 0;
+    int fastopen = 0;
+    int duplex = 0;
+    RecvStrategy recv_strategy = RECV_NATIVE;
+    int fanin_connections = 0;
+    int fanin_threads = 0;
+    const char *timestamp_path = NULL;
+    int metrics_port = 0;
+    int warmup = 0;
+    int steady_state = 0;
+    double steady_cv = STEADY_DEFAULT_CV_PCT;
+    int mptcp = 0;
+    const char *trace_path = NULL;
+    int trace_events = TRACE_DEFAULT_EVENTS;
+    int rr_port = 0;
+    int rr_interval_us = RR_DEFAULT_INTERVAL_US;
+    int class_mark = 0;
+    
+    static struct option long_options[] = {
+        {"perf-counters", no_argument, 0, 'c'},
+        {"syscall-probe", no_argument, 0, 's'},
+        {"json", required_argument, 0, 'j'},
+        {"churn", required_argument, 0, 'n'},
+        {"fastopen", no_argument, 0, 'f'},
+        {"duplex", no_argument, 0, 'x'},
+        {"ring", no_argument, 0, 'g'},
+        {"recv-strategy", required_argument, 0, 'r'},
+        {"connections", required_argument, 0, 'm'},
+        {"engine-threads", required_argument, 0, 't'},
+        {"timestamps", required_argument, 0, 'T'},
+        {"metrics", required_argument, 0, 'M'},
+        {"warmup", required_argument, 0, 'W'},
+        {"steady-state", no_argument, 0, 'S'},
+        {"steady-cv", required_argument, 0, 'V'},
+        {"mptcp", no_argument, 0, 'P'},
+        {"trace", required_argument, 0, 'e'},
+        {"trace-events", required_argument, 0, 'E'},
+        {"rr", required_argument, 0, 'o'},
+        {"rr-interval", required_argument, 0, 'O'},
+        {"class-mark", no_argument, 0, 'k'},
+        {0, 0, 0, 0}
+    };
+    
+    int opt_char;
+    while ((opt_char = getopt_long(argc, argv, "csj:n:fxgr:m:t:T:M:W:SV:Pe:E:o:O:k", long_options, NULL)) != -1) {
+        switch (opt_char) {
+        case 'c':
+            perf_counters = 1;
+            break;
+        case 's':
+            syscall_probe = 1;
+            break;
+        case 'j':
+            json_path = optarg;
+            break;
+        case 'n':
+            churn_messages = atoi(optarg);
+            break;
+        case 'f':
+            fastopen = 1;
+            break;
+        case 'x':
+            duplex = 1;
+            break;
+        case 'g':
+            recv_strategy = RECV_RING;
+            break;
+        case 'r':
+            if (recv_strategy_parse(optarg) < 0) {
+                fprintf(stderr, "Error: unknown receive strategy '%s'\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            recv_strategy = (RecvStrategy)recv_strategy_parse(optarg);
+            break;
+        case 'm':
+            fanin_connections = atoi(optarg);
+            break;
+        case 't':
+            fanin_threads = atoi(optarg);
+            break;
+        case 'T':
+            timestamp_path = optarg;
+            break;
+        case 'M':
+            metrics_port = atoi(optarg);
+            break;
+        case 'W':
+            warmup = atoi(optarg);
+            break;
+        case 'S':
+            steady_state = 1;
+            break;
+        case 'V':
+            steady_cv = atof(optarg);
+            break;
+        case 'P':
+            mptcp = 1;
+            break;
+        case 'e':
+            trace_path = optarg;
+            break;
+        case 'E':
+            trace_events = atoi(optarg);
+            break;
+        case 'o':
+            rr_port = atoi(optarg);
+            break;
+        case 'O':
+            rr_interval_us = atoi(optarg);
+            break;
+        case 'k':
+            class_mark = 1;
+            break;
+        default:
+            print_usage(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    
+    if (argc - optind != 3) {
+        print_usage(argv[0]);
         exit(EXIT_FAILURE);
     }
     
-    char *server_ip = argv[1];
-    int message_size = atoi(argv[2]);
-    int duration = atoi(argv[3]);
-    int field_size = message_size / NUM_STRING_FIELDS;
+    if (duplex && churn_messages > 0) {
+        fprintf(stderr, "Error: --duplex cannot be combined with --churn\n");
+        exit(EXIT_FAILURE);
+    }
+    if (fanin_connections > 0 && (duplex || churn_messages > 0 || syscall_probe ||
+                                  recv_strategy != RECV_NATIVE)) {
+        fprintf(stderr, "Error: --connections cannot be combined with --duplex, --churn,\n"
+                        "       --syscall-probe or --recv-strategy\n");
+        exit(EXIT_FAILURE);
+    }
+    if (timestamp_path && (fanin_connections > 0 || churn_messages > 0 ||
+                           recv_strategy != RECV_NATIVE)) {
+        fprintf(stderr, "Error: --timestamps needs the native receive path on one connection\n"
+                        "       (no --connections, --churn or --recv-strategy)\n");
+        exit(EXIT_FAILURE);
+    }
+    if (metrics_port > 0 && fanin_connections > 0) {
+        fprintf(stderr, "Error: --metrics cannot be combined with --connections\n");
+        exit(EXIT_FAILURE);
+    }
+    if ((warmup > 0 || steady_state) && fanin_connections > 0) {
+        fprintf(stderr, "Error: --warmup and --steady-state cannot be combined with --connections\n");
+        exit(EXIT_FAILURE);
+    }
+    if (mptcp && (fanin_connections > 0 || churn_messages > 0)) {
+        fprintf(stderr, "Error: --mptcp cannot be combined with --connections or --churn\n");
+        exit(EXIT_FAILURE);
+    }
+    if (trace_path && fanin_connections > 0) {
+        fprintf(stderr, "Error: --trace cannot be combined with --connections\n");
+        exit(EXIT_FAILURE);
+    }
+    if (rr_port > 0 && (fanin_connections > 0 || churn_messages > 0 || duplex || timestamp_path ||
+                        recv_strategy != RECV_NATIVE || warmup > 0 || steady_state || mptcp ||
+                        trace_path)) {
+        fprintf(stderr, "Error: --rr runs alone (no --connections, --churn, --duplex, --timestamps,\n"
+                        "       --recv-strategy, --warmup, --steady-state, --mptcp or --trace)\n");
+        exit(EXIT_FAILURE);
+    }
+    if (duplex) {
+        /* The send thread sees EPIPE instead of being killed at shutdown */
+        signal(SIGPIPE, SIG_IGN);
+    }
+    
+    char *server_ip = argv[optind];
+    int message_size = atoi(argv[optind + 1]);
+    int duration = atoi(argv[optind + 2]);
+    int field_size = FIELD_SIZE(message_size / NUM_STRING_FIELDS);
     
     if (message_size % NUM_STRING_FIELDS != 0) {
         fprintf(stderr, "Error: message_size must be divisible by %d\n", NUM_STRING_FIELDS);
         exit(EXIT_FAILURE);
     }
+    specialize_check_size(message_size);
     
     printf("=== MT25018 Part A1 Client (Two-Copy) ===\n");
     printf("Server IP: %s\n", server_ip);
     printf("Message size: %d bytes (%d bytes per field)\n", message_size, field_size);
+    specialize_print();
     printf("Duration: %d seconds\n", duration);
-    
-    /* Create socket */
-    int client_socket = socket(AF_INET, SOCK_STREAM, 0);
-    if (client_socket < 0) {
-        perror("socket creation failed");
-        exit(EXIT_FAILURE);
+    printf("Receive strategy: %s\n", recv_strategy_names[recv_strategy]);
+    if (warmup > 0) {
+        printf("Warm-up: %d seconds (not measured)\n", warmup);
+    }
+    if (churn_messages > 0) {
+        printf("Churn: reconnecting every %d messages%s\n", churn_messages,
+               fastopen ? " (TCP Fast Open)" : "");
     }
     
     /* Setup server address */
@@ -102,27 +400,244 @@ int main(int argc, char *argv[]) {
         exit(EXIT_FAILURE);
     }
     
+    /* Fan-in mode: many non-blocking connections multiplexed on a few threads */
+    if (fanin_connections > 0) {
+        FanInConfig config;
+        memset(&config, 0, sizeof(config));
+        config.server_addr = server_addr;
+        config.connections = fanin_connections;
+        config.threads = fanin_threads > 0 ? fanin_threads : fanin_default_threads(fanin_connections);
+        config.num_fields = NUM_STRING_FIELDS;
+        config.field_size = field_size;
+        config.duration = duration;
+        config.perf_counters = perf_counters;
+        config.recv_message = recv_message_twocopy_coro;
+        
+        printf("Fan-in: %d connections on %d threads (epoll + coroutines)\n",
+               config.connections, config.threads);
+        FanInStats fanin;
+        if (fanin_run(&config, &fanin) < 0) {
+            exit(EXIT_FAILURE);
+        }
+        fanin_print(&config, &fanin);
+        if (fanin.perf_enabled) {
+            perf_sample_print("Hardware Counters (fan-in engine threads)",
+                              &fanin.perf, fanin.bytes);
+        }
+        
+        if (json_path) {
+            ClientStats stats = {fanin.bytes, fanin.messages, fanin.latency_ns.sum_ns / 1000.0,
+                                 (long long)fanin.latency_ns.samples};
+            ClientResults results = {
+                .transport = "TwoCopy",
+                .server_ip = server_ip,
+                .message_size = message_size,
+                .elapsed_seconds = fanin.elapsed_seconds,
+                .stats = &stats,
+                .latency_hist = &fanin.latency_ns,
+                .perf_sample = fanin.perf_enabled ? &fanin.perf : NULL,
+                .fanin_config = &config,
+                .fanin = &fanin
+            };
+            client_results_write_json(json_path, &results);
+        }
+        return 0;
+    }
+    
+    /* Request/response mode: the latency-sensitive flow of a mixed workload */
+    if (rr_port > 0) {
+        struct sockaddr_in rr_addr = server_addr;
+        rr_addr.sin_port = htons(rr_port);
+        printf("Request/response: port %d, one request every %d us%s\n", rr_port,
+               rr_interval_us, class_mark ? " (latency class)" : "");
+        RrStats rr;
+        if (rr_client_run(&rr_addr, message_size, duration, rr_interval_us, class_mark, &rr) < 0 &&
+            rr.requests == 0) {
+            exit(EXIT_FAILURE);
+        }
+        rr_print(&rr, message_size);
+        
+        if (json_path) {
+            ClientStats stats = {rr.requests * message_size, rr.requests, rr.rtt_ns.sum_ns / 1000.0,
+                                 (long long)rr.rtt_ns.samples};
+            ClientResults results = {
+                .transport = "TwoCopy",
+                .server_ip = server_ip,
+                .message_size = message_size,
+                .elapsed_seconds = rr.elapsed_seconds,
+                .stats = &stats,
+                .latency_hist = &rr.rtt_ns,
+                .rr = &rr
+            };
+            client_results_write_json(json_path, &results);
+        }
+        return 0;
+    }
+    
+    /* Create socket */
+    int client_socket = mptcp_stream_socket(mptcp);
+    if (client_socket < 0) {
+        perror("socket creation failed");
+        exit(EXIT_FAILURE);
+    }
+    if (class_mark) {
+        traffic_class_mark(client_socket, TRAFFIC_BULK);
+    }
+    
     /* Connect to server */
-    printf("Connecting to server...\n");
+    printf("Connecting to server%s...\n", mptcp ? " (MPTCP)" : "");
     if (connect(client_socket, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
         perror("connection failed");
         exit(EXIT_FAILURE);
     }
+    if (churn_messages > 0 && churn_send_hello(client_socket) < 0) {
+        perror("hello failed");
+        exit(EXIT_FAILURE);
+    }
     printf("Connected successfully!\n\n");
     
     /* Initialize statistics */
     ClientStats stats = {0, 0, 0.0, 0};
     
-    /* Record start time */
+    /* Churn mode: reconnects after churn_messages messages on a connection */
+    ChurnStats churn;
+    memset(&churn, 0, sizeof(churn));
+    long long connection_messages = 0;
+    
+    /* Every message's receive time goes into the histogram */
+    LatencyHistogram latency_hist;
+    memset(&latency_hist, 0, sizeof(latency_hist));
+    
+    /* Live counters for scrapers; the receive loop updates them lock-free */
+    if (metrics_port > 0 && metrics_start(&metrics, metrics_port, "client", "TwoCopy", 0) < 0) {
+        exit(EXIT_FAILURE);
+    }
+    MetricsSlot *metrics_slot = metrics_slot_acquire(&metrics, 1, &latency_hist);
+    /* Binary event trace of the receive loop, one ring */
+    if (trace_path && trace_open(&trace_file, trace_path, 1, trace_events, "client", "TwoCopy") < 0) {
+        exit(EXIT_FAILURE);
+    }
+    TraceRing trace_ring;
+    TraceRing *trace = trace_ring_acquire(&trace_file, &trace_ring, 1);
+    
+    /* Open counters for this thread; they only run around the receive loop */
+    PerfCounters perf;
+    PerfSample perf_sample;
+    int perf_enabled = perf_counters && perf_counters_open(&perf) > 0;
+    if (perf_counters && !perf_enabled) {
+        fprintf(stderr, "Warning: perf_event_open failed, counters disabled\n");
+    }
+    
+    /* Per-call timing of every receive syscall */
+    SyscallProbe probe_state;
+    SyscallProbe *probe = NULL;
+    if (syscall_probe) {
+        syscall_probe_calibrate();
+        syscall_probe_init(&probe_state);
+        probe = &probe_state;
+    }
+    
+    /* SO_TIMESTAMPING trace of every TIMESTAMP_SAMPLE_INTERVAL-th message */
+    FILE *timestamp_file = NULL;
+    RxTimestamper rx_ts;
+    int timestamps_enabled = 0;
+    if (timestamp_path) {
+        timestamp_file = fopen(timestamp_path, "a");
+        if (!timestamp_file) {
+            perror("fopen failed for timestamp trace");
+            exit(EXIT_FAILURE);
+        }
+        /* One write() per line, so servers and clients can share a trace file */
+        setvbuf(timestamp_file, NULL, _IOLBF, 0);
+        timestamps_enabled = rx_timestamp_init(&rx_ts, client_socket, "TwoCopy", timestamp_file) == 0;
+    }
+    
+    /* Receiver for strategies other than the transport's own function */
+    MessageReceiver receiver;
+    int use_receiver = recv_strategy != RECV_NATIVE;
+    if (use_receiver && receiver_init(&receiver, recv_strategy, NUM_STRING_FIELDS, field_size) < 0) {
+        exit(EXIT_FAILURE);
+    }
+    
+    /* Full-duplex: a second thread sends messages back to the server */
+    DuplexWorker tx_worker;
+    DuplexSendArgs tx_args;
+    DuplexTimer rx_timer;
+    DuplexDirection rx_stats = {0, 0, 0};
+    int duplex_enabled = 0;
+    if (duplex) {
+        tx_args.socket = client_socket;
+        tx_args.field_size = field_size;
+        if (duplex_alloc_fields(tx_args.fields, NUM_STRING_FIELDS, field_size) == 0) {
+            duplex_enabled = duplex_worker_start(&tx_worker, duplex_send, &tx_args) == 0;
+            if (!duplex_enabled) {
+                duplex_free_fields(tx_args.fields, NUM_STRING_FIELDS);
+            }
+        }
+    }
+    duplex_timer_start(&rx_timer);
+    
+    /* Record start time; the measured duration follows the warm-up */
     long long start_time = get_time_us();
-    long long end_time = start_time + (duration * 1000000LL);
+    long long warmup_end = start_time + (warmup * 1000000LL);
+    long long end_time = warmup_end + (duration * 1000000LL);
+    int warming_up = warmup > 0;
+    
+    /* Per-interval throughput for the steady-state detector */
+    SteadyState steady;
+    int steady_enabled = steady_state && steady_state_init(&steady, get_time_ns(), steady_cv) == 0;
     
     /* Receive messages for specified duration */
     printf("Receiving data...\n");
+    if (perf_enabled && !warming_up) {
+        perf_counters_start(&perf);
+    }
     while (get_time_us() < end_time) {
-        long long msg_start = get_time_us();
+        /* Warm-up over: drop everything recorded so far and start measuring */
+        if (warming_up && get_time_us() >= warmup_end) {
+            warming_up = 0;
+            start_time = get_time_us();
+            memset(&stats, 0, sizeof(stats));
+            metrics_latency_reset(metrics_slot, &latency_hist);
+            memset(&churn, 0, sizeof(churn));
+            if (probe) {
+                syscall_probe_init(probe);
+            }
+            duplex_timer_start(&rx_timer);
+            if (duplex_enabled) {
+                duplex_worker_restart(&tx_worker);
+            }
+            if (steady_enabled) {
+                steady.start_ns = get_time_ns();
+            }
+            if (perf_enabled) {
+                perf_counters_start(&perf);
+            }
+        }
+        
+        if (churn_messages > 0 && connection_messages >= churn_messages) {
+            close(client_socket);
+            client_socket = churn_reconnect(&server_addr, fastopen, &churn);
+            if (client_socket < 0) {
+                break;
+            }
+            connection_messages = 0;
+            if (use_receiver) {
+                receiver_reset(&receiver);
+            }
+        }
+        
+        long long msg_start = get_time_ns();
         
-        int bytes_received = recv_message_twocopy(client_socket, field_size);
+        int bytes_received;
+        trace_event(trace, TRACE_RECV_BEGIN, 0, 0, 0);
+        if (use_receiver) {
+            bytes_received = receiver_next(&receiver, client_socket, probe);
+        } else {
+            bytes_received = recv_message_twocopy(client_socket, field_size, probe,
+                                                  timestamps_enabled ? &rx_ts : NULL);
+        }
+        trace_event(trace, TRACE_RECV_END, bytes_received, bytes_received < 0 ? errno : 0, 0);
         if (bytes_received < 0) {
             if (errno == ECONNRESET) {
                 printf("Server closed connection\n");
@@ -132,14 +647,24 @@ int main(int argc, char *argv[]) {
             break;
         }
         
-        long long msg_end = get_time_us();
+        long long msg_end = get_time_ns();
+        if (timestamps_enabled) {
+            rx_timestamp_message(&rx_ts, connection_messages);
+        }
         
         stats.total_bytes_received += bytes_received;
         stats.total_messages_received++;
+        connection_messages++;
+        
+        metrics_latency_record(metrics_slot, &latency_hist, msg_end - msg_start);
+        metrics_slot_add(metrics_slot, bytes_received);
+        if (steady_enabled && !warming_up) {
+            steady_state_record(&steady, msg_end, bytes_received, msg_end - msg_start);
+        }
         
         /* Sample latency every 100 messages to avoid overhead */
         if (stats.total_messages_received % 100 == 0) {
-            stats.total_latency_us += (msg_end - msg_start);
+            stats.total_latency_us += (msg_end - msg_start) / 1000.0;
             stats.latency_samples++;
         }
         
@@ -154,7 +679,33 @@ int main(int argc, char *argv[]) {
     
     /* Calculate final statistics */
     long long actual_end = get_time_us();
+    if (duplex_enabled) {
+        duplex_timer_stop(&rx_timer, &rx_stats);
+        rx_stats.bytes = stats.total_bytes_received;
+        rx_stats.messages = stats.total_messages_received;
+        duplex_worker_stop(&tx_worker, client_socket);
+        duplex_free_fields(tx_args.fields, NUM_STRING_FIELDS);
+    }
+    if (perf_enabled) {
+        perf_counters_stop(&perf);
+        perf_counters_read(&perf, &perf_sample);
+        perf_counters_close(&perf);
+    }
     double elapsed_seconds = (actual_end - start_time) / 1000000.0;
+    if (steady_enabled) {
+        steady_state_detect(&steady, get_time_ns());
+    }
+    metrics_slot_release(&metrics, metrics_slot);
+    metrics_stop(&metrics);
+    trace_ring_release(trace);
+    trace_close(&trace_file);
+    
+    /* Subflows the path manager added by the end of the run */
+    MptcpStats mptcp_stats;
+    memset(&mptcp_stats, 0, sizeof(mptcp_stats));
+    if (mptcp && client_socket >= 0) {
+        mptcp_stats_add(&mptcp_stats, mptcp_subflows(client_socket));
+    }
     
     printf("\n=== Client Statistics ===\n");
     printf("Total bytes received: %lld\n", stats.total_bytes_received);
@@ -169,7 +720,73 @@ int main(int argc, char *argv[]) {
         double avg_latency = stats.total_latency_us / stats.latency_samples;
         printf("Average latency: %.2f µs\n", avg_latency);
     }
+    if (latency_hist.samples > 0) {
+        printf("Latency p50/p99/p99.9: %.2f / %.2f / %.2f µs\n",
+               latency_hist_percentile(&latency_hist, 50.0) / 1000.0,
+               latency_hist_percentile(&latency_hist, 99.0) / 1000.0,
+               latency_hist_percentile(&latency_hist, 99.9) / 1000.0);
+    }
+    if (steady_enabled) {
+        steady_state_print(&steady);
+    }
+    if (churn_messages > 0) {
+        churn_print(&churn, elapsed_seconds, fastopen);
+    }
+    if (duplex_enabled) {
+        duplex_print(&tx_worker.stats, &rx_stats, elapsed_seconds);
+    }
+    if (use_receiver) {
+        receiver_print(&receiver);
+    }
+    if (timestamps_enabled) {
+        timestamp_breakdown_print(&rx_ts.stats);
+    }
+    if (mptcp) {
+        mptcp_print(&mptcp_stats);
+    }
     
-    close(client_socket);
+    if (perf_enabled) {
+        perf_sample_print("Hardware Counters (steady-state receive loop)",
+                          &perf_sample, stats.total_bytes_received);
+    }
+    
+    if (probe) {
+        syscall_probe_print(probe, "TwoCopy", "recv");
+    }
+    
+    if (json_path) {
+        ClientResults results = {
+            .transport = "TwoCopy",
+            .server_ip = server_ip,
+            .message_size = message_size,
+            .elapsed_seconds = elapsed_seconds,
+            .stats = &stats,
+            .latency_hist = &latency_hist,
+            .perf_sample = perf_enabled ? &perf_sample : NULL,
+            .churn = churn_messages > 0 ? &churn : NULL,
+            .churn_messages = churn_messages,
+            .duplex_tx = duplex_enabled ? &tx_worker.stats : NULL,
+            .duplex_rx = &rx_stats,
+            .receiver = use_receiver ? &receiver : NULL,
+            .timestamps = timestamps_enabled ? &rx_ts.stats : NULL,
+            .warmup = warmup,
+            .steady = steady_enabled ? &steady : NULL,
+            .mptcp = mptcp ? &mptcp_stats : NULL
+        };
+        client_results_write_json(json_path, &results);
+    }
+    
+    if (use_receiver) {
+        receiver_destroy(&receiver);
+    }
+    if (steady_enabled) {
+        steady_state_free(&steady);
+    }
+    if (timestamp_file) {
+        fclose(timestamp_file);
+    }
+    if (client_socket >= 0) {
+        close(client_socket);
+    }
     return 0;
 }
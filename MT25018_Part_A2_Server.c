@@ -4,6 +4,8 @@
  * Uses sendmsg() with iovec to reduce one copy
  */
 
+#define _GNU_SOURCE             /* sched_getaffinity() */
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -15,6 +17,24 @@
 #include <sys/uio.h>
 #include <errno.h>
 #include <signal.h>
+#include <getopt.h>
+#include <time.h>
+
+#include "MT25018_Common_PerfCounters.h"
+#include "MT25018_Common_SyscallProbe.h"
+#include "MT25018_Common_Results.h"
+#include "MT25018_Common_Churn.h"
+#include "MT25018_Common_Duplex.h"
+#include "MT25018_Common_Timestamping.h"
+#include "MT25018_Common_TcpInfo.h"
+#include "MT25018_Common_Metrics.h"
+#include "MT25018_Common_Mptcp.h"
+#include "MT25018_Common_Specialize.h"
+#include "MT25018_Common_MemAccount.h"
+#include "MT25018_Common_Trace.h"
+#include "MT25018_Common_ReqResp.h"
+#include "MT25018_Common_FairSched.h"
+#include "MT25018_Common_Connection.h"
 
 #define PORT 8080
 #define MAX_CLIENTS 100
@@ -34,21 +54,41 @@ typedef struct {
 
 /* Thread arguments */
 typedef struct {
-    int client_socket;
+    ConnectionConfig conn;
     int message_size;
-    int thread_id;
 } ThreadArgs;
 
 /* Global statistics */
 typedef struct {
-    long long total_bytes_sent;
-    long long total_messages_sent;
+    ConnectionTotals totals;
     struct timeval start_time;
     pthread_mutex_t stats_mutex;
+    int active_threads;
+    pthread_cond_t threads_done;
+    /* Message buffers of finished connections, reused by new ones */
+    Message *message_pool[MAX_CLIENTS];
+    int message_pool_size;
 } ServerStats;
 
-ServerStats global_stats = {0, 0, {0, 0}, PTHREAD_MUTEX_INITIALIZER};
+ServerStats global_stats = {
+    .stats_mutex = PTHREAD_MUTEX_INITIALIZER,
+    .threads_done = PTHREAD_COND_INITIALIZER
+};
 volatile int server_running = 1;
+TcpInfoSampler tcpinfo_sampler;
+MemAccount mem_account;
+TraceFile trace_file;
+MetricsExporter metrics;
+FairScheduler fair_sched;
+ConnectionServices connection_services = {
+    .lock = &global_stats.stats_mutex,
+    .totals = &global_stats.totals,
+    .tcpinfo = &tcpinfo_sampler,
+    .mem_account = &mem_account,
+    .metrics = &metrics,
+    .trace_file = &trace_file,
+    .sched = &fair_sched
+};
 
 /* Allocate message with heap-allocated string fields (pre-registered buffers) */
 Message* allocate_message(int field_size) {
@@ -115,12 +155,35 @@ void free_message(Message *msg) {
     }
 }
 
+/* Take a message buffer left by an earlier connection, or allocate one */
+Message* acquire_message(int field_size) {
+    Message *msg = NULL;
+    pthread_mutex_lock(&global_stats.stats_mutex);
+    if (global_stats.message_pool_size > 0) {
+        msg = global_stats.message_pool[--global_stats.message_pool_size];
+    }
+    pthread_mutex_unlock(&global_stats.stats_mutex);
+    return msg ? msg : allocate_message(field_size);
+}
+
+/* Return a message buffer for reuse (freed if the pool is full) */
+void release_message(Message *msg) {
+    pthread_mutex_lock(&global_stats.stats_mutex);
+    if (global_stats.message_pool_size < MAX_CLIENTS) {
+        global_stats.message_pool[global_stats.message_pool_size++] = msg;
+        msg = NULL;
+    }
+    pthread_mutex_unlock(&global_stats.stats_mutex);
+    free_message(msg);
+}
+
 /* Send message using sendmsg() with iovec - one-copy approach
  * This eliminates one copy by using scatter-gather I/O
  * The kernel can directly access the pre-registered buffers without
  * an intermediate copy to a contiguous buffer
  */
-int send_message_onecopy(int socket, Message *msg, int field_size) {
+int send_message_onecopy(int socket, Message *msg, int field_size, SyscallProbe *probe) {
+    field_size = FIELD_SIZE(field_size);
     struct iovec iov[NUM_STRING_FIELDS];
     struct msghdr msghdr;
     
@@ -148,35 +211,125 @@ int send_message_onecopy(int socket, Message *msg, int field_size) {
     msghdr.msg_iovlen = NUM_STRING_FIELDS;
     
     /* Send using sendmsg - kernel performs scatter-gather I/O */
+    uint64_t t0 = syscall_probe_begin(probe);
     ssize_t bytes_sent = sendmsg(socket, &msghdr, 0);
+    syscall_probe_end(probe, PROBE_SLOT_MESSAGE, t0, bytes_sent,
+                      (size_t)field_size * NUM_STRING_FIELDS);
     
     return bytes_sent;
 }
 
+/* Receive message using recvmsg() with iovec - one-copy approach */
+int recv_message_onecopy(int socket, int field_size, SyscallProbe *probe) {
+    field_size = FIELD_SIZE(field_size);
+    /* Allocate buffers for each field */
+    char *buffers[NUM_STRING_FIELDS];
+    struct iovec iov[NUM_STRING_FIELDS];
+    struct msghdr msghdr;
+    
+    /* Setup buffers and iovec */
+    for (int i = 0; i < NUM_STRING_FIELDS; i++) {
+        buffers[i] = (char *)malloc(field_size);
+        if (!buffers[i]) {
+            /* Free previously allocated buffers */
+            for (int j = 0; j < i; j++) {
+                free(buffers[j]);
+            }
+            return -1;
+        }
+        iov[i].iov_base = buffers[i];
+        iov[i].iov_len = field_size;
+    }
+    
+    /* Setup message header */
+    memset(&msghdr, 0, sizeof(msghdr));
+    msghdr.msg_iov = iov;
+    msghdr.msg_iovlen = NUM_STRING_FIELDS;
+    
+    int total_received = 0;
+    int expected_bytes = field_size * NUM_STRING_FIELDS;
+    
+    /* Receive data using recvmsg */
+    while (total_received < expected_bytes) {
+        uint64_t t0 = syscall_probe_begin(probe);
+        ssize_t n = recvmsg(socket, &msghdr, 0);
+        syscall_probe_end(probe, PROBE_SLOT_MESSAGE, t0, n, expected_bytes - total_received);
+        if (n <= 0) {
+            /* Free all buffers */
+            for (int i = 0; i < NUM_STRING_FIELDS; i++) {
+                free(buffers[i]);
+            }
+            return -1;
+        }
+        total_received += n;
+        
+        /* Adjust iovec for remaining data if needed */
+        if (total_received < expected_bytes) {
+            ssize_t bytes_to_adjust = n;
+            
+            for (int i = 0; i < NUM_STRING_FIELDS && bytes_to_adjust > 0; i++) {
+                if ((size_t)bytes_to_adjust >= iov[i].iov_len) {
+                    bytes_to_adjust -= iov[i].iov_len;
+                    iov[i].iov_len = 0;
+                } else {
+                    iov[i].iov_base = (char *)iov[i].iov_base + bytes_to_adjust;
+                    iov[i].iov_len -= bytes_to_adjust;
+                    bytes_to_adjust = 0;
+                }
+            }
+        }
+    }
+    
+    /* Free all buffers */
+    for (int i = 0; i < NUM_STRING_FIELDS; i++) {
+        free(buffers[i]);
+    }
+    
+    return total_received;
+}
+
+/* Receive side of a full-duplex connection */
+typedef struct {
+    int socket;
+    int field_size;
+} DuplexRecvArgs;
+
+int duplex_recv(void *arg) {
+    DuplexRecvArgs *rx = (DuplexRecvArgs *)arg;
+    return recv_message_onecopy(rx->socket, rx->field_size, NULL);
+}
+
 /* Client handler thread */
 void* client_handler(void *args) {
     ThreadArgs *thread_args = (ThreadArgs *)args;
-    int client_socket = thread_args->client_socket;
+    const ConnectionConfig *config = &thread_args->conn;
     int message_size = thread_args->message_size;
-    int field_size = message_size / NUM_STRING_FIELDS;
+    int field_size = FIELD_SIZE(message_size / NUM_STRING_FIELDS);
     
-    printf("[Thread %d] Started handling client, field_size=%d bytes\n", 
-           thread_args->thread_id, field_size);
+    if (!config->persistent) {
+        printf("[Thread %d] Started handling client, field_size=%d bytes\n", 
+               config->thread_id, field_size);
+    }
     
-    /* Allocate message structure with pre-registered buffers */
-    Message *msg = allocate_message(field_size);
+    /* Allocate message structure */
+    Message *msg = acquire_message(field_size);
     if (!msg) {
-        close(client_socket);
+        close(config->socket);
         free(thread_args);
         return NULL;
     }
     
-    long long local_bytes = 0;
-    long long local_messages = 0;
+    /* Counters, probes, duplex worker and registrations of the connection */
+    ConnectionContext conn;
+    DuplexRecvArgs rx_args = {config->socket, field_size};
+    connection_open(&conn, config, &connection_services, duplex_recv, &rx_args);
     
-    /* Send messages continuously until client disconnects */
+    /* Send messages continuously until client disconnects; in a
+     * scheduling mode each send waits for the connection's turn */
     while (server_running) {
-        int bytes_sent = send_message_onecopy(client_socket, msg, field_size);
+        connection_before_send(&conn, message_size, 0);
+        int bytes_sent = send_message_onecopy(conn.socket, msg, field_size, conn.probe);
+        connection_after_send(&conn, bytes_sent, 0);
         if (bytes_sent < 0) {
             if (errno == EPIPE || errno == ECONNRESET) {
                 break; /* Client disconnected */
@@ -184,33 +337,24 @@ void* client_handler(void *args) {
             perror("sendmsg failed");
             break;
         }
-        
-        local_bytes += bytes_sent;
-        local_messages++;
-        
-        /* Update global stats periodically */
-        if (local_messages % 1000 == 0) {
-            pthread_mutex_lock(&global_stats.stats_mutex);
-            global_stats.total_bytes_sent += local_bytes;
-            global_stats.total_messages_sent += local_messages;
-            pthread_mutex_unlock(&global_stats.stats_mutex);
-            local_bytes = 0;
-            local_messages = 0;
-        }
+        connection_account(&conn, bytes_sent);
     }
+    connection_end(&conn);
     
     /* Final stats update */
     pthread_mutex_lock(&global_stats.stats_mutex);
-    global_stats.total_bytes_sent += local_bytes;
-    global_stats.total_messages_sent += local_messages;
+    connection_merge_locked(&conn);
     pthread_mutex_unlock(&global_stats.stats_mutex);
     
-    printf("[Thread %d] Client disconnected. Messages sent: %lld\n", 
-           thread_args->thread_id, local_messages);
-    
-    free_message(msg);
-    close(client_socket);
+    connection_close(&conn);
+    release_message(msg);
     free(thread_args);
+    
+    /* Let main() know this handler is done */
+    pthread_mutex_lock(&global_stats.stats_mutex);
+    global_stats.active_threads--;
+    pthread_cond_signal(&global_stats.threads_done);
+    pthread_mutex_unlock(&global_stats.stats_mutex);
     return NULL;
 }
 
@@ -221,34 +365,258 @@ void signal_handler(int signum) {
     server_running = 0;
 }
 
+/* Append this run's result record (one JSON line) to path */
+void write_results_json(const char *path, const ServerResults *results) {
+    JsonWriter w;
+    if (json_record_open(&w, path) < 0) {
+        return;
+    }
+    
+    pthread_mutex_lock(&global_stats.stats_mutex);
+    server_results_json(&w, results);
+    pthread_mutex_unlock(&global_stats.stats_mutex);
+    
+    json_record_close(&w);
+}
+
+/* Print command line usage */
+void print_usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [options] <message_size> <max_threads>\n", prog);
+    fprintf(stderr, "  message_size: Total message size in bytes (must be multiple of 8)\n");
+    fprintf(stderr, "  max_threads: Maximum number of client threads\n");
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  --perf-counters  Count cycles/instructions/cache misses per thread\n");
+    fprintf(stderr, "                   around the send loop (perf_event_open)\n");
+    fprintf(stderr, "  --syscall-probe  Time every sendmsg() call with the TSC and dump\n");
+    fprintf(stderr, "                   per-field histograms and error counts at exit\n");
+    fprintf(stderr, "  --json PATH      Append a JSON-lines result record to PATH\n");
+    fprintf(stderr, "  --persistent     Keep accepting until SIGINT, serving at most\n");
+    fprintf(stderr, "                   max_threads connections at a time\n");
+    fprintf(stderr, "  --fastopen       Accept TCP Fast Open (data in SYN) connections\n");
+    fprintf(stderr, "  --defer-accept   Wake accept() only once the client's hello arrives\n");
+    fprintf(stderr, "  --churn          Serve churn clients: read the one-byte hello every\n");
+    fprintf(stderr, "                   connection opens with (implied by --fastopen and\n");
+    fprintf(stderr, "                   --defer-accept)\n");
+    fprintf(stderr, "  --duplex         Also receive the client's messages on each connection\n");
+    fprintf(stderr, "                   (clients must use --duplex too)\n");
+    fprintf(stderr, "  --timestamps PATH  Trace every %d-th message with SO_TIMESTAMPING\n",
+            TIMESTAMP_SAMPLE_INTERVAL);
+    fprintf(stderr, "                   TX timestamps and append CSV lines to PATH\n");
+    fprintf(stderr, "  --tcp-info PATH  Sample TCP_INFO of every connection and write a\n");
+    fprintf(stderr, "                   per-connection time series CSV to PATH\n");
+    fprintf(stderr, "  --tcp-info-ms MS TCP_INFO sampling interval (default %d)\n",
+            TCPINFO_DEFAULT_INTERVAL_MS);
+    fprintf(stderr, "  --mem-account PATH  Account memory per connection (user buffers, thread\n");
+    fprintf(stderr, "                   stack, SO_MEMINFO, RSS) and write a CSV time series\n");
+    fprintf(stderr, "  --mem-account-ms MS  Memory accounting interval (default %d)\n",
+            MEMACCT_DEFAULT_INTERVAL_MS);
+    fprintf(stderr, "  --trace PATH     Record send begin/end and zero-copy completions of\n");
+    fprintf(stderr, "                   every connection into a binary trace file\n");
+    fprintf(stderr, "  --trace-events N Trace ring size per connection in events (default %d)\n",
+            TRACE_DEFAULT_EVENTS);
+    fprintf(stderr, "  --rr-port PORT   Also answer request/response clients (--rr) on PORT,\n");
+    fprintf(stderr, "                   next to the bulk streams\n");
+    fprintf(stderr, "  --class-mark     Mark bulk streams TC_PRIO_BULK/IPTOS_THROUGHPUT and\n");
+    fprintf(stderr, "                   request/response TC_PRIO_INTERACTIVE/IPTOS_LOWDELAY\n");
+    fprintf(stderr, "  --metrics PORT   Serve live counters in Prometheus text format on\n");
+    fprintf(stderr, "                   http://127.0.0.1:PORT/metrics\n");
+    fprintf(stderr, "  --mptcp          Listen with IPPROTO_MPTCP (falls back to TCP when\n");
+    fprintf(stderr, "                   the kernel has no MPTCP support)\n");
+    fprintf(stderr, "  --sched MODE     Serve connections in turns from a shared worker pool:\n");
+    fprintf(stderr, "                   wrr (weighted round-robin) or drr (deficit\n");
+    fprintf(stderr, "                   round-robin); none (default) lets the kernel decide\n");
+    fprintf(stderr, "  --sched-quantum BYTES  Bytes per turn at weight 1 (default %d)\n",
+            SCHED_DEFAULT_QUANTUM);
+    fprintf(stderr, "  --sched-workers N  Connections sending at once (default: CPUs of\n");
+    fprintf(stderr, "                   the server, fewer than max_threads)\n");
+    fprintf(stderr, "  --sched-weights LIST  Comma-separated weights, cycled over the\n");
+    fprintf(stderr, "                   connections in accept order (default 1)\n");
+}
+
 int main(int argc, char *argv[]) {
-    if (argc != 3) {
-        fprintf(stderr, "Usage: %s <message_size> <max_threads>\n", argv[0]);
-        fprintf(stderr, "  message_size: Total message size in bytes (must be multiple of 8)\n");
-        fprintf(stderr, "  max_threads: Maximum number of client threads\n");
+    int perf_counters = 0;
+    int syscall_probe = 0;
+    const char *json_path = NULL;
+    int persistent = 0;
+    int fastopen = 0;
+    int defer_accept = 0;
+    int churn = 0;
+    int duplex = 0;
+    const char *timestamp_path = NULL;
+    const char *tcpinfo_path = NULL;
+    int tcpinfo_ms = TCPINFO_DEFAULT_INTERVAL_MS;
+    const char *mem_account_path = NULL;
+    int mem_account_ms = MEMACCT_DEFAULT_INTERVAL_MS;
+    const char *trace_path = NULL;
+    int trace_events = TRACE_DEFAULT_EVENTS;
+    int rr_port = 0;
+    int class_mark = 0;
+    int metrics_port = 0;
+    int mptcp = 0;
+    int sched_mode = SCHED_NONE;
+    int sched_quantum = SCHED_DEFAULT_QUANTUM;
+    int sched_workers = 0;
+    
+    static struct option long_options[] = {
+        {"perf-counters", no_argument, 0, 'c'},
+        {"syscall-probe", no_argument, 0, 's'},
+        {"json", required_argument, 0, 'j'},
+        {"persistent", no_argument, 0, 'p'},
+        {"fastopen", no_argument, 0, 'f'},
+        {"defer-accept", no_argument, 0, 'd'},
+        {"churn", no_argument, 0, 'C'},
+        {"duplex", no_argument, 0, 'x'},
+        {"timestamps", required_argument, 0, 't'},
+        {"tcp-info", required_argument, 0, 'i'},
+        {"tcp-info-ms", required_argument, 0, 'I'},
+        {"mem-account", required_argument, 0, 'u'},
+        {"mem-account-ms", required_argument, 0, 'U'},
+        {"trace", required_argument, 0, 'e'},
+        {"trace-events", required_argument, 0, 'E'},
+        {"rr-port", required_argument, 0, 'o'},
+        {"class-mark", no_argument, 0, 'k'},
+        {"metrics", required_argument, 0, 'M'},
+        {"mptcp", no_argument, 0, 'P'},
+        {"sched", required_argument, 0, 'q'},
+        {"sched-quantum", required_argument, 0, 'Q'},
+        {"sched-workers", required_argument, 0, 'n'},
+        {"sched-weights", required_argument, 0, 'W'},
+        {0, 0, 0, 0}
+    };
+    
+    int opt_char;
+    while ((opt_char = getopt_long(argc, argv, "csj:pfdCxt:i:I:u:U:e:E:o:kM:Pq:Q:n:W:", long_options, NULL)) != -1) {
+        switch (opt_char) {
+        case 'c':
+            perf_counters = 1;
+            break;
+        case 's':
+            syscall_probe = 1;
+            break;
+        case 'j':
+            json_path = optarg;
+            break;
+        case 'p':
+            persistent = 1;
+            break;
+        case 'f':
+            fastopen = 1;
+            break;
+        case 'd':
+            defer_accept = 1;
+            break;
+        case 'C':
+            churn = 1;
+            break;
+        case 'x':
+            duplex = 1;
+            break;
+        case 't':
+            timestamp_path = optarg;
+            break;
+        case 'i':
+            tcpinfo_path = optarg;
+            break;
+        case 'I':
+            tcpinfo_ms = atoi(optarg);
+            break;
+        case 'u':
+            mem_account_path = optarg;
+            break;
+        case 'U':
+            mem_account_ms = atoi(optarg);
+            break;
+        case 'e':
+            trace_path = optarg;
+            break;
+        case 'E':
+            trace_events = atoi(optarg);
+            break;
+        case 'o':
+            rr_port = atoi(optarg);
+            break;
+        case 'k':
+            class_mark = 1;
+            break;
+        case 'M':
+            metrics_port = atoi(optarg);
+            break;
+        case 'P':
+            mptcp = 1;
+            break;
+        case 'q':
+            sched_mode = sched_mode_parse(optarg);
+            if (sched_mode < 0) {
+                fprintf(stderr, "Error: --sched must be none, wrr or drr\n");
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'Q':
+            sched_quantum = atoi(optarg);
+            break;
+        case 'n':
+            sched_workers = atoi(optarg);
+            break;
+        case 'W':
+            if (fair_sched_parse_weights(&fair_sched, optarg) < 0) {
+                fprintf(stderr, "Error: --sched-weights takes weights 1..1000, e.g. 1,2,4\n");
+                exit(EXIT_FAILURE);
+            }
+            break;
+        default:
+            print_usage(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    
+    if (argc - optind != 2) {
+        print_usage(argv[0]);
         exit(EXIT_FAILURE);
     }
     
-    int message_size = atoi(argv[1]);
-    int max_threads = atoi(argv[2]);
+    int message_size = atoi(argv[optind]);
+    int max_threads = atoi(argv[optind + 1]);
     
     if (message_size % NUM_STRING_FIELDS != 0) {
         fprintf(stderr, "Error: message_size must be divisible by %d\n", NUM_STRING_FIELDS);
         exit(EXIT_FAILURE);
     }
+    specialize_check_size(message_size);
     
     printf("=== MT25018 Part A2 Server (One-Copy) ===\n");
     printf("Message size: %d bytes (%d bytes per field)\n", 
            message_size, message_size / NUM_STRING_FIELDS);
-    printf("Max threads: %d\n", max_threads);
+    specialize_print();
+    printf("Max threads: %d%s\n", max_threads, persistent ? " concurrent (persistent mode)" : "");
     printf("Using sendmsg() with iovec for scatter-gather I/O\n");
     
-    /* Setup signal handlers */
-    signal(SIGINT, signal_handler);
-    signal(SIGTERM, signal_handler);
+    if (syscall_probe) {
+        syscall_probe_calibrate();
+        syscall_probe_init(&global_stats.totals.syscall_probe);
+    }
+    
+    FILE *timestamp_file = NULL;
+    if (timestamp_path) {
+        timestamp_file = fopen(timestamp_path, "a");
+        if (!timestamp_file) {
+            perror("fopen failed for timestamp trace");
+            exit(EXIT_FAILURE);
+        }
+        /* One write() per line, so servers and clients can share a trace file */
+        setvbuf(timestamp_file, NULL, _IOLBF, 0);
+    }
+    
+    /* Setup signal handlers (without SA_RESTART, so a blocked accept() returns) */
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = signal_handler;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    /* Report client disconnects as EPIPE instead of terminating */
+    signal(SIGPIPE, SIG_IGN);
     
     /* Create server socket */
-    int server_socket = socket(AF_INET, SOCK_STREAM, 0);
+    int server_socket = mptcp_stream_socket(mptcp);
     if (server_socket < 0) {
         perror("socket creation failed");
         exit(EXIT_FAILURE);
@@ -273,58 +641,141 @@ int main(int argc, char *argv[]) {
         exit(EXIT_FAILURE);
     }
     
+    churn_configure_listener(server_socket, fastopen, defer_accept);
+    
     /* Listen for connections */
-    if (listen(server_socket, max_threads) < 0) {
+    if (listen(server_socket, persistent ? SOMAXCONN : max_threads) < 0) {
         perror("listen failed");
         exit(EXIT_FAILURE);
     }
     
-    printf("Server listening on port %d...\n", PORT);
+    printf("Server listening on port %d%s...\n", PORT, mptcp ? " (MPTCP)" : "");
+    if (tcpinfo_path && tcpinfo_sampler_start(&tcpinfo_sampler, tcpinfo_path, tcpinfo_ms) < 0) {
+        exit(EXIT_FAILURE);
+    }
+    /* Per connection: the message buffers and the handler's arguments */
+    if (mem_account_path &&
+        mem_account_start(&mem_account, mem_account_path, mem_account_ms,
+                          (long long)sizeof(Message) + message_size + sizeof(ThreadArgs)) < 0) {
+        exit(EXIT_FAILURE);
+    }
+    /* One ring per concurrent handler; a finished handler's ring is reused */
+    if (trace_path && trace_open(&trace_file, trace_path, max_threads, trace_events, "server",
+                                 "OneCopy") < 0) {
+        exit(EXIT_FAILURE);
+    }
+    RrServer rr_server;
+    memset(&rr_server, 0, sizeof(rr_server));
+    if (rr_port > 0 && rr_server_start(&rr_server, rr_port, class_mark) < 0) {
+        exit(EXIT_FAILURE);
+    }
+    if (metrics_port > 0 && metrics_start(&metrics, metrics_port, "server", "OneCopy", 0) < 0) {
+        exit(EXIT_FAILURE);
+    }
+    fair_sched_init(&fair_sched, sched_mode, sched_quantum, sched_workers, max_threads);
+    if (sched_mode != SCHED_NONE) {
+        printf("Fair scheduling: %s, quantum %d bytes, %d worker(s)\n",
+               sched_mode_name(fair_sched.mode), fair_sched.quantum, fair_sched.workers);
+    }
     gettimeofday(&global_stats.start_time, NULL);
     
-    /* Accept clients and create threads */
+    /* Accept clients and create threads; persistent mode keeps accepting
+     * and only waits while max_threads connections are being served */
     int thread_count = 0;
-    pthread_t threads[MAX_CLIENTS];
     
-    while (server_running && thread_count < max_threads) {
+    while (server_running && (persistent || thread_count < max_threads)) {
+        if (persistent) {
+            pthread_mutex_lock(&global_stats.stats_mutex);
+            while (server_running && global_stats.active_threads >= max_threads) {
+                struct timespec deadline;
+                clock_gettime(CLOCK_REALTIME, &deadline);
+                deadline.tv_sec += 1;
+                pthread_cond_timedwait(&global_stats.threads_done, &global_stats.stats_mutex,
+                                       &deadline);
+            }
+            pthread_mutex_unlock(&global_stats.stats_mutex);
+        }
+        
         struct sockaddr_in client_addr;
         socklen_t client_len = sizeof(client_addr);
         
         int client_socket = accept(server_socket, (struct sockaddr *)&client_addr, &client_len);
         if (client_socket < 0) {
+            int accept_error = errno;
             if (server_running) {
                 perror("accept failed");
+                mem_account_accept_failed(&mem_account, accept_error);
+            }
+            /* Out of descriptors: back off instead of spinning on accept() */
+            if (accept_error == EMFILE || accept_error == ENFILE) {
+                usleep(100000);
             }
             continue;
         }
+        /* Accepted sockets keep the listener's TOS but not its priority */
+        if (class_mark) {
+            traffic_class_mark(client_socket, TRAFFIC_BULK);
+        }
         
-        printf("Client %d connected from %s:%d\n", 
-               thread_count + 1,
-               inet_ntoa(client_addr.sin_addr),
-               ntohs(client_addr.sin_port));
+        if (!persistent) {
+            printf("Client %d connected from %s:%d\n", 
+                   thread_count + 1,
+                   inet_ntoa(client_addr.sin_addr),
+                   ntohs(client_addr.sin_port));
+        }
         
         /* Create thread arguments */
         ThreadArgs *args = (ThreadArgs *)malloc(sizeof(ThreadArgs));
-        args->client_socket = client_socket;
+        args->conn.socket = client_socket;
+        args->conn.thread_id = thread_count + 1;
+        args->conn.transport = "OneCopy";
+        args->conn.perf_counters = perf_counters;
+        args->conn.syscall_probe = syscall_probe;
+        args->conn.persistent = persistent;
+        args->conn.churn = churn || fastopen || defer_accept;
+        args->conn.duplex = duplex;
+        args->conn.timestamp_file = timestamp_file;
+        args->conn.mptcp = mptcp;
         args->message_size = message_size;
-        args->thread_id = thread_count + 1;
         
         /* Create client handler thread */
-        if (pthread_create(&threads[thread_count], NULL, client_handler, args) != 0) {
-            perror("pthread_create failed");
+        pthread_mutex_lock(&global_stats.stats_mutex);
+        global_stats.active_threads++;
+        pthread_mutex_unlock(&global_stats.stats_mutex);
+        
+        pthread_t thread;
+        int create_error = pthread_create(&thread, NULL, client_handler, args);
+        if (create_error != 0) {
+            fprintf(stderr, "pthread_create failed: %s\n", strerror(create_error));
+            mem_account_thread_failed(&mem_account, create_error);
+            pthread_mutex_lock(&global_stats.stats_mutex);
+            global_stats.active_threads--;
+            pthread_mutex_unlock(&global_stats.stats_mutex);
             close(client_socket);
             free(args);
             continue;
         }
         
-        pthread_detach(threads[thread_count]);
+        pthread_detach(thread);
         thread_count++;
     }
     
     printf("Maximum threads reached or shutdown requested. Waiting for clients...\n");
     
-    /* Wait for all threads to complete */
-    sleep(2);
+    /* Wait for all threads to complete (at most 2 more seconds once
+     * shutdown has been requested) */
+    int shutdown_wait = 0;
+    pthread_mutex_lock(&global_stats.stats_mutex);
+    while (global_stats.active_threads > 0 && shutdown_wait < 2) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += 1;
+        pthread_cond_timedwait(&global_stats.threads_done, &global_stats.stats_mutex, &deadline);
+        if (!server_running) {
+            shutdown_wait++;
+        }
+    }
+    pthread_mutex_unlock(&global_stats.stats_mutex);
     
     /* Print final statistics */
     struct timeval end_time;
@@ -333,12 +784,92 @@ int main(int argc, char *argv[]) {
                      (end_time.tv_usec - global_stats.start_time.tv_usec) / 1000000.0;
     
     printf("\n=== Server Statistics ===\n");
-    printf("Total bytes sent: %lld\n", global_stats.total_bytes_sent);
-    printf("Total messages sent: %lld\n", global_stats.total_messages_sent);
+    printf("Total bytes sent: %lld\n", global_stats.totals.bytes_sent);
+    printf("Total messages sent: %lld\n", global_stats.totals.messages_sent);
     printf("Elapsed time: %.2f seconds\n", elapsed);
     printf("Throughput: %.2f Gbps\n", 
-           (global_stats.total_bytes_sent * 8.0) / (elapsed * 1e9));
+           (global_stats.totals.bytes_sent * 8.0) / (elapsed * 1e9));
+    printf("Connections served: %lld (%.1f accepts/s)\n",
+           global_stats.totals.connections_served, global_stats.totals.connections_served / elapsed);
+    pthread_mutex_lock(&global_stats.stats_mutex);
+    printf("Per-connection fairness: Jain's index %.4f over %lld connections\n",
+           jain_index(&global_stats.totals.fairness), global_stats.totals.fairness.n);
+    pthread_mutex_unlock(&global_stats.stats_mutex);
+    if (sched_mode != SCHED_NONE) {
+        fair_sched_print(&fair_sched);
+    }
+    if (mptcp) {
+        pthread_mutex_lock(&global_stats.stats_mutex);
+        mptcp_print(&global_stats.totals.mptcp);
+        pthread_mutex_unlock(&global_stats.stats_mutex);
+    }
+    
+    if (duplex) {
+        pthread_mutex_lock(&global_stats.stats_mutex);
+        duplex_print(&global_stats.totals.duplex_tx, &global_stats.totals.duplex_rx, elapsed);
+        pthread_mutex_unlock(&global_stats.stats_mutex);
+    }
     
+    tcpinfo_sampler_stop(&tcpinfo_sampler);
+    mem_account_stop(&mem_account);
+    if (mem_account_path) {
+        mem_account_print(&mem_account, MAX_CLIENTS);
+    }
+    metrics_stop(&metrics);
+    trace_close(&trace_file);
+    rr_server_stop(&rr_server);
+    if (rr_port > 0) {
+        rr_server_print(&rr_server);
+    }
+    if (trace_path) {
+        printf("Event trace written to %s\n", trace_path);
+    }
+    
+    if (timestamp_file) {
+        pthread_mutex_lock(&global_stats.stats_mutex);
+        timestamp_breakdown_print(&global_stats.totals.timestamps);
+        pthread_mutex_unlock(&global_stats.stats_mutex);
+    }
+    
+    if (perf_counters) {
+        pthread_mutex_lock(&global_stats.stats_mutex);
+        perf_sample_print("Hardware Counters (steady-state send loop)",
+                          &global_stats.totals.perf, global_stats.totals.bytes_sent);
+        pthread_mutex_unlock(&global_stats.stats_mutex);
+    }
+    
+    if (syscall_probe) {
+        pthread_mutex_lock(&global_stats.stats_mutex);
+        syscall_probe_print(&global_stats.totals.syscall_probe, "OneCopy", "sendmsg");
+        pthread_mutex_unlock(&global_stats.stats_mutex);
+    }
+    
+    if (json_path) {
+        ServerResults results = {
+            .transport = "OneCopy",
+            .message_size = message_size,
+            .max_threads = max_threads,
+            .elapsed = elapsed,
+            .totals = &global_stats.totals,
+            .sched = &fair_sched,
+            .perf_counters = perf_counters,
+            .duplex = duplex,
+            .timestamps = timestamp_file != NULL,
+            .mptcp = mptcp,
+            .mem_account = mem_account_path ? &mem_account : NULL
+        };
+        write_results_json(json_path, &results);
+    }
+    
+    pthread_mutex_lock(&global_stats.stats_mutex);
+    while (global_stats.message_pool_size > 0) {
+        free_message(global_stats.message_pool[--global_stats.message_pool_size]);
+    }
+    pthread_mutex_unlock(&global_stats.stats_mutex);
+    
+    if (timestamp_file) {
+        fclose(timestamp_file);
+    }
     close(server_socket);
     pthread_mutex_destroy(&global_stats.stats_mutex);
     
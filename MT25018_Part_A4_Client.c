@@ -0,0 +1,414 @@
+/*
+ * MT25018 - Graduate Systems PA02
+ * Part A4: UDP Implementation - Client
+ * Receives datagrams with recvmmsg() and UDP GRO, counts lost and
+ * reordered datagrams and reassembles messages from their segments
+ */
+
+#define _GNU_SOURCE             /* sendmmsg(), recvmmsg() */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <errno.h>
+#include <time.h>
+#include <getopt.h>
+
+#include "MT25018_Common_PerfCounters.h"
+#include "MT25018_Common_Results.h"
+#include "MT25018_Common_SteadyState.h"
+#include "MT25018_Common_Udp.h"
+
+#define PORT 8080
+#define NUM_STRING_FIELDS 8
+/* Hello retry interval (SO_RCVTIMEO) and how long to keep trying */
+#define HELLO_INTERVAL_MS 200
+#define HELLO_TIMEOUT_SEC 10
+
+/* Client statistics */
+typedef struct {
+    long long total_bytes_received;
+    long long total_messages_received;
+    double total_latency_us;
+    long long latency_samples;
+} ClientStats;
+
+/* Get current time in microseconds */
+long long get_time_us() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (long long)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+/* Get monotonic time in nanoseconds */
+long long get_time_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* Append this run's result record (one JSON line) to path */
+void write_results_json(const char *path, const char *server_ip, int message_size,
+                        double elapsed_seconds, const ClientStats *stats,
+                        const LatencyHistogram *latency_hist, const PerfSample *perf_sample,
+                        const UdpReceiver *receiver, int warmup, const SteadyState *steady) {
+    JsonWriter w;
+    if (json_record_open(&w, path) < 0) {
+        return;
+    }
+    
+    json_string(&w, "role", "client");
+    json_string(&w, "transport", "UDP");
+    json_string(&w, "server_ip", server_ip);
+    json_int(&w, "message_size", message_size);
+    if (steady) {
+        /* Headline numbers cover only the steady window */
+        json_int(&w, "bytes", steady->bytes);
+        json_int(&w, "messages", steady->messages);
+        json_double(&w, "elapsed_sec", steady->elapsed_sec);
+        json_double(&w, "throughput_gbps", steady->elapsed_sec > 0 ?
+                    (steady->bytes * 8.0) / (steady->elapsed_sec * 1e9) : 0.0);
+        json_double(&w, "avg_latency_us", steady->latency.samples > 0 ?
+                    steady->latency.sum_ns / 1000.0 / steady->latency.samples : 0.0);
+        json_latency_hist(&w, "latency_ns", &steady->latency);
+        json_double(&w, "measured_sec", elapsed_seconds);
+        json_steady_state(&w, "steady_state", steady);
+    } else {
+        json_int(&w, "bytes", stats->total_bytes_received);
+        json_int(&w, "messages", stats->total_messages_received);
+        json_double(&w, "elapsed_sec", elapsed_seconds);
+        json_double(&w, "throughput_gbps",
+                    (stats->total_bytes_received * 8.0) / (elapsed_seconds * 1e9));
+        json_double(&w, "avg_latency_us", stats->latency_samples > 0 ?
+                    stats->total_latency_us / stats->latency_samples : 0.0);
+        json_latency_hist(&w, "latency_ns", latency_hist);
+    }
+    if (warmup > 0) {
+        json_int(&w, "warmup_sec", warmup);
+    }
+    if (perf_sample) {
+        json_perf_sample(&w, "perf", perf_sample, stats->total_bytes_received);
+    }
+    json_udp_receiver(&w, "udp", receiver);
+    
+    json_record_close(&w);
+}
+
+/* Print command line usage */
+void print_usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [options] <server_ip> <message_size> <duration_seconds>\n", prog);
+    fprintf(stderr, "  server_ip: IP address of the server\n");
+    fprintf(stderr, "  message_size: Total message size in bytes (must be multiple of 8)\n");
+    fprintf(stderr, "  duration_seconds: How long to run the test\n");
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  --perf-counters  Count cycles/instructions/cache misses around\n");
+    fprintf(stderr, "                   the receive loop (perf_event_open)\n");
+    fprintf(stderr, "  --json PATH      Append a JSON-lines result record to PATH\n");
+    fprintf(stderr, "  --batch N        Buffers per recvmmsg() call (default %d)\n",
+            UDP_DEFAULT_BATCH);
+    fprintf(stderr, "  --no-gro         One datagram per buffer instead of kernel-merged\n");
+    fprintf(stderr, "                   runs of datagrams (UDP_GRO)\n");
+    fprintf(stderr, "  --warmup SEC     Receive for SEC seconds before measuring (the test\n");
+    fprintf(stderr, "                   then runs for duration_seconds more)\n");
+    fprintf(stderr, "  --steady-state   Report only the steady window: from the first %d\n",
+            STEADY_WINDOW);
+    fprintf(stderr, "                   %d ms intervals whose throughput CV is below the\n",
+            STEADY_INTERVAL_MS);
+    fprintf(stderr, "                   threshold to the end of the run\n");
+    fprintf(stderr, "  --steady-cv PCT  Steady-state CV threshold in percent (default %.0f)\n",
+            STEADY_DEFAULT_CV_PCT);
+    fprintf(stderr, "Latency is one-way (server send to reassembly) and needs both ends\n");
+    fprintf(stderr, "on one clock, e.g. the runner's network namespaces.\n");
+}
+
+int main(int argc, char *argv[]) {
+    int perf_counters = 0;
+    const char *json_path = NULL;
+    int batch = UDP_DEFAULT_BATCH;
+    int gro = 1;
+    int warmup = 0;
+    int steady_state = 0;
+    double steady_cv = STEADY_DEFAULT_CV_PCT;
+    
+    static struct option long_options[] = {
+        {"perf-counters", no_argument, 0, 'c'},
+        {"json", required_argument, 0, 'j'},
+        {"batch", required_argument, 0, 'b'},
+        {"no-gro", no_argument, 0, 'G'},
+        {"warmup", required_argument, 0, 'W'},
+        {"steady-state", no_argument, 0, 'S'},
+        {"steady-cv", required_argument, 0, 'V'},
+        {0, 0, 0, 0}
+    };
+    
+    int opt_char;
+    while ((opt_char = getopt_long(argc, argv, "cj:b:GW:SV:", long_options, NULL)) != -1) {
+        switch (opt_char) {
+        case 'c':
+            perf_counters = 1;
+            break;
+        case 'j':
+            json_path = optarg;
+            break;
+        case 'b':
+            batch = atoi(optarg);
+            break;
+        case 'G':
+            gro = 0;
+            break;
+        case 'W':
+            warmup = atoi(optarg);
+            break;
+        case 'S':
+            steady_state = 1;
+            break;
+        case 'V':
+            steady_cv = atof(optarg);
+            break;
+        default:
+            print_usage(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    
+    if (argc - optind != 3) {
+        print_usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    
+    char *server_ip = argv[optind];
+    int message_size = atoi(argv[optind + 1]);
+    int duration = atoi(argv[optind + 2]);
+    int field_size = message_size / NUM_STRING_FIELDS;
+    
+    if (message_size % NUM_STRING_FIELDS != 0) {
+        fprintf(stderr, "Error: message_size must be divisible by %d\n", NUM_STRING_FIELDS);
+        exit(EXIT_FAILURE);
+    }
+    if (batch <= 0 || batch > 1024) {
+        fprintf(stderr, "Error: --batch must be between 1 and 1024\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    printf("=== MT25018 Part A4 Client (UDP) ===\n");
+    printf("Server IP: %s\n", server_ip);
+    printf("Message size: %d bytes (%d bytes per field, %d datagram(s))\n", message_size,
+           field_size, udp_segments(message_size));
+    printf("Duration: %d seconds\n", duration);
+    if (warmup > 0) {
+        printf("Warm-up: %d seconds (not measured)\n", warmup);
+    }
+    printf("Using recvmmsg() with %d buffers per call%s\n", batch, gro ? ", UDP GRO" : "");
+    
+    /* Setup server address */
+    struct sockaddr_in server_addr;
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(PORT);
+    
+    if (inet_pton(AF_INET, server_ip, &server_addr.sin_addr) <= 0) {
+        perror("Invalid address");
+        exit(EXIT_FAILURE);
+    }
+    
+    /* Create socket */
+    int client_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (client_socket < 0) {
+        perror("socket creation failed");
+        exit(EXIT_FAILURE);
+    }
+    udp_set_buffer(client_socket, SO_RCVBUF, SO_RCVBUFFORCE);
+    int opt = 1;
+    if (gro && setsockopt(client_socket, SOL_UDP, UDP_GRO, &opt, sizeof(opt)) < 0) {
+        fprintf(stderr, "Warning: UDP_GRO not supported, receiving single datagrams\n");
+        gro = 0;
+    }
+    /* The timeout paces hello retries and ends the run if the server stops */
+    struct timeval timeout = {0, HELLO_INTERVAL_MS * 1000};
+    setsockopt(client_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    
+    UdpReceiver receiver;
+    if (udp_receiver_init(&receiver, batch, gro) < 0) {
+        exit(EXIT_FAILURE);
+    }
+    
+    /* Register with the server; hellos are repeated until data arrives */
+    printf("Registering with server...\n");
+    int registered = 0;
+    for (int i = 0; i < HELLO_TIMEOUT_SEC * 1000 / HELLO_INTERVAL_MS && !registered; i++) {
+        if (udp_send_control(client_socket, &server_addr, UDP_HELLO) < 0) {
+            perror("hello failed");
+            exit(EXIT_FAILURE);
+        }
+        registered = udp_receiver_recv(&receiver, client_socket) > 0;
+    }
+    if (!registered) {
+        fprintf(stderr, "No data from the server within %d seconds\n", HELLO_TIMEOUT_SEC);
+        exit(EXIT_FAILURE);
+    }
+    /* Data comes from the server thread's own socket; the bye goes there */
+    struct sockaddr_in sender_addr = *udp_receiver_peer(&receiver);
+    printf("Registered successfully!\n\n");
+    
+    /* Initialize statistics */
+    ClientStats stats = {0, 0, 0.0, 0};
+    
+    /* Every message's one-way latency goes into the histogram */
+    LatencyHistogram latency_hist;
+    memset(&latency_hist, 0, sizeof(latency_hist));
+    
+    /* Open counters for this thread; they only run around the receive loop */
+    PerfCounters perf;
+    PerfSample perf_sample;
+    int perf_enabled = perf_counters && perf_counters_open(&perf) > 0;
+    if (perf_counters && !perf_enabled) {
+        fprintf(stderr, "Warning: perf_event_open failed, counters disabled\n");
+    }
+    
+    /* Record start time; the measured duration follows the warm-up */
+    long long start_time = get_time_us();
+    long long warmup_end = start_time + (warmup * 1000000LL);
+    long long end_time = warmup_end + (duration * 1000000LL);
+    int warming_up = warmup > 0;
+    
+    /* Per-interval throughput for the steady-state detector */
+    SteadyState steady;
+    int steady_enabled = steady_state && steady_state_init(&steady, get_time_ns(), steady_cv) == 0;
+    
+    /* Receive datagrams for specified duration; the batch received while
+     * registering is accounted first */
+    printf("Receiving data...\n");
+    if (perf_enabled && !warming_up) {
+        perf_counters_start(&perf);
+    }
+    int have_batch = 1;
+    while (get_time_us() < end_time) {
+        /* Warm-up over: drop everything recorded so far and start measuring */
+        if (warming_up && get_time_us() >= warmup_end) {
+            warming_up = 0;
+            start_time = get_time_us();
+            memset(&stats, 0, sizeof(stats));
+            memset(&latency_hist, 0, sizeof(latency_hist));
+            receiver.datagrams = 0;
+            receiver.lost = 0;
+            receiver.reordered = 0;
+            receiver.incomplete = 0;
+            receiver.recv_calls = 0;
+            receiver.buffers_received = 0;
+            receiver.payload_bytes = 0;
+            if (steady_enabled) {
+                steady.start_ns = get_time_ns();
+            }
+            if (perf_enabled) {
+                perf_counters_start(&perf);
+            }
+        }
+    
+        if (!have_batch && udp_receiver_recv(&receiver, client_socket) < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                continue;
+            }
+            perror("recvmmsg failed");
+            break;
+        }
+        have_batch = 0;
+    
+        uint64_t now_ns = udp_now_ns();
+        long long now_mono = get_time_ns();
+        const UdpHeader *header;
+        int payload;
+        while ((header = udp_receiver_next(&receiver, &payload)) != NULL) {
+            if (!udp_receiver_account(&receiver, header, payload)) {
+                continue;
+            }
+            long long latency_ns = now_ns > header->send_ns ?
+                                   (long long)(now_ns - header->send_ns) : 0;
+    
+            stats.total_bytes_received += message_size;
+            stats.total_messages_received++;
+    
+            latency_hist_record(&latency_hist, latency_ns);
+            if (steady_enabled && !warming_up) {
+                steady_state_record(&steady, now_mono, message_size, latency_ns);
+            }
+    
+            /* Sample latency every 100 messages to avoid overhead */
+            if (stats.total_messages_received % 100 == 0) {
+                stats.total_latency_us += latency_ns / 1000.0;
+                stats.latency_samples++;
+            }
+    
+            /* Print progress every 10000 messages */
+            if (stats.total_messages_received % 10000 == 0) {
+                double elapsed = (get_time_us() - start_time) / 1000000.0;
+                double throughput_gbps = (stats.total_bytes_received * 8.0) / (elapsed * 1e9);
+                printf("Progress: %lld messages, %.2f Gbps\n",
+                       stats.total_messages_received, throughput_gbps);
+            }
+        }
+    }
+    
+    /* Calculate final statistics */
+    long long actual_end = get_time_us();
+    if (perf_enabled) {
+        perf_counters_stop(&perf);
+        perf_counters_read(&perf, &perf_sample);
+        perf_counters_close(&perf);
+    }
+    double elapsed_seconds = (actual_end - start_time) / 1000000.0;
+    if (steady_enabled) {
+        steady_state_detect(&steady, get_time_ns());
+    }
+    
+    /* Tell the server thread to stop; closing the socket would also do via
+     * ICMP port unreachable, but that is rate limited */
+    for (int i = 0; i < 3; i++) {
+        udp_send_control(client_socket, &sender_addr, UDP_BYE);
+    }
+    
+    printf("\n=== Client Statistics ===\n");
+    printf("Total bytes received: %lld\n", stats.total_bytes_received);
+    printf("Total messages received: %lld\n", stats.total_messages_received);
+    printf("Elapsed time: %.2f seconds\n", elapsed_seconds);
+    printf("Throughput: %.2f Gbps\n",
+           (stats.total_bytes_received * 8.0) / (elapsed_seconds * 1e9));
+    printf("Average throughput: %.2f MB/s\n",
+           (stats.total_bytes_received / (1024.0 * 1024.0)) / elapsed_seconds);
+    
+    if (stats.latency_samples > 0) {
+        double avg_latency = stats.total_latency_us / stats.latency_samples;
+        printf("Average latency: %.2f µs\n", avg_latency);
+    }
+    if (latency_hist.samples > 0) {
+        printf("Latency p50/p99/p99.9: %.2f / %.2f / %.2f µs\n",
+               latency_hist_percentile(&latency_hist, 50.0) / 1000.0,
+               latency_hist_percentile(&latency_hist, 99.0) / 1000.0,
+               latency_hist_percentile(&latency_hist, 99.9) / 1000.0);
+    }
+    udp_receiver_print(&receiver);
+    if (steady_enabled) {
+        steady_state_print(&steady);
+    }
+    
+    if (perf_enabled) {
+        perf_sample_print("Hardware Counters (steady-state receive loop)",
+                          &perf_sample, stats.total_bytes_received);
+    }
+    
+    if (json_path) {
+        write_results_json(json_path, server_ip, message_size, elapsed_seconds, &stats,
+                           &latency_hist, perf_enabled ? &perf_sample : NULL, &receiver,
+                           warmup, steady_enabled ? &steady : NULL);
+    }
+    
+    udp_receiver_free(&receiver);
+    if (steady_enabled) {
+        steady_state_free(&steady);
+    }
+    close(client_socket);
+    return 0;
+}
@@ -0,0 +1,545 @@
+/*
+ * MT25018 - Graduate Systems PA02
+ * Part A4: UDP Implementation - Server
+ * Sends messages as datagrams with sendmmsg(), UDP GSO (UDP_SEGMENT) and
+ * optionally MSG_ZEROCOPY; each client registers with a hello datagram
+ */
+
+#define _GNU_SOURCE             /* sendmmsg(), recvmmsg() */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <errno.h>
+#include <signal.h>
+#include <getopt.h>
+#include <time.h>
+
+#include "MT25018_Common_PerfCounters.h"
+#include "MT25018_Common_Results.h"
+#include "MT25018_Common_Duplex.h"
+#include "MT25018_Common_Udp.h"
+#include "MT25018_Common_ReqResp.h"
+
+#define PORT 8080
+#define MAX_CLIENTS 100
+#define NUM_STRING_FIELDS 8
+/* Batches between checks for the client's bye */
+#define BYE_CHECK_INTERVAL 64
+
+/* Thread arguments */
+typedef struct {
+    struct sockaddr_in client_addr;
+    int message_size;
+    int thread_id;
+    int perf_counters;
+    int gso;
+    int zerocopy;
+    int batch;
+    int class_mark;
+} ThreadArgs;
+
+/* Per-client result, recorded when a handler thread exits */
+typedef struct {
+    int thread_id;
+    long long bytes_sent;
+    long long messages_sent;
+    double duration_sec;
+} ConnectionResult;
+
+/* Global statistics */
+typedef struct {
+    long long total_bytes_sent;
+    long long total_messages_sent;
+    long long total_datagrams_sent;
+    long long total_send_calls;
+    long long zerocopy_sends;
+    long long zerocopy_completed;
+    long long zerocopy_copied;
+    struct timeval start_time;
+    pthread_mutex_t stats_mutex;
+    int active_threads;
+    pthread_cond_t threads_done;
+    PerfSample perf_total;
+    ConnectionResult connections[MAX_CLIENTS];
+    int num_connections;
+} ServerStats;
+
+ServerStats global_stats = {
+    .stats_mutex = PTHREAD_MUTEX_INITIALIZER,
+    .threads_done = PTHREAD_COND_INITIALIZER
+};
+volatile int server_running = 1;
+
+/* True once the client has said bye or its port has gone away */
+int client_gone(int socket) {
+    char buf[64];
+    ssize_t n = recv(socket, buf, sizeof(buf), MSG_DONTWAIT);
+    if (n < 0) {
+        return errno == ECONNREFUSED;
+    }
+    return udp_control_kind(buf, n) == UDP_BYE;
+}
+
+/* Client handler thread: one connected UDP socket per client */
+void* client_handler(void *args) {
+    ThreadArgs *thread_args = (ThreadArgs *)args;
+    int message_size = thread_args->message_size;
+    int field_size = message_size / NUM_STRING_FIELDS;
+    
+    printf("[Thread %d] Started sending to %s:%d, %d datagram(s) per message\n",
+           thread_args->thread_id, inet_ntoa(thread_args->client_addr.sin_addr),
+           ntohs(thread_args->client_addr.sin_port), udp_segments(message_size));
+    
+    /* Datagrams leave from a socket of their own, connected to the client,
+     * so ICMP port unreachable reports the client's exit as ECONNREFUSED */
+    int client_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (client_socket < 0 ||
+        connect(client_socket, (struct sockaddr *)&thread_args->client_addr,
+                sizeof(thread_args->client_addr)) < 0) {
+        perror("UDP client socket failed");
+        if (client_socket >= 0) {
+            close(client_socket);
+        }
+        free(thread_args);
+        return NULL;
+    }
+    udp_set_buffer(client_socket, SO_SNDBUF, SO_SNDBUFFORCE);
+    if (thread_args->class_mark) {
+        traffic_class_mark(client_socket, TRAFFIC_BULK);
+    }
+    
+    int zerocopy = thread_args->zerocopy;
+    int opt = 1;
+    if (zerocopy && setsockopt(client_socket, SOL_SOCKET, SO_ZEROCOPY, &opt, sizeof(opt)) < 0) {
+        fprintf(stderr, "[Thread %d] Warning: SO_ZEROCOPY not supported on UDP, copying\n",
+                thread_args->thread_id);
+        zerocopy = 0;
+    }
+    
+    /* Same 8 heap-allocated fields as the TCP servers */
+    char *fields[NUM_STRING_FIELDS];
+    UdpSender sender;
+    if (duplex_alloc_fields(fields, NUM_STRING_FIELDS, field_size) < 0) {
+        close(client_socket);
+        free(thread_args);
+        return NULL;
+    }
+    if (udp_sender_init(&sender, fields, NUM_STRING_FIELDS, field_size, thread_args->gso,
+                        zerocopy, thread_args->batch) < 0) {
+        duplex_free_fields(fields, NUM_STRING_FIELDS);
+        close(client_socket);
+        free(thread_args);
+        return NULL;
+    }
+    
+    /* Open per-thread counters; they only run around the send loop */
+    PerfCounters perf;
+    int perf_enabled = thread_args->perf_counters && perf_counters_open(&perf) > 0;
+    if (thread_args->perf_counters && !perf_enabled) {
+        fprintf(stderr, "[Thread %d] Warning: perf_event_open failed, counters disabled\n",
+                thread_args->thread_id);
+    }
+    if (perf_enabled) {
+        perf_counters_start(&perf);
+    }
+    
+    struct timeval thread_start, thread_end;
+    gettimeofday(&thread_start, NULL);
+    
+    /* Send datagrams until the client says bye or goes away */
+    while (server_running) {
+        int datagrams = udp_sender_send(&sender, client_socket);
+        if (datagrams < 0) {
+            if (errno != ECONNREFUSED) {
+                perror("sendmmsg failed");
+            }
+            break;
+        }
+        if (sender.batches % BYE_CHECK_INTERVAL == 0 && client_gone(client_socket)) {
+            break;
+        }
+    }
+    
+    gettimeofday(&thread_end, NULL);
+    
+    PerfSample perf_sample;
+    if (perf_enabled) {
+        perf_counters_stop(&perf);
+        perf_counters_read(&perf, &perf_sample);
+        perf_counters_close(&perf);
+    }
+    udp_sender_drain(&sender, client_socket);
+    long long thread_messages = udp_sender_messages(&sender);
+    
+    /* Final stats update */
+    pthread_mutex_lock(&global_stats.stats_mutex);
+    global_stats.total_bytes_sent += sender.bytes;
+    global_stats.total_messages_sent += thread_messages;
+    global_stats.total_datagrams_sent += sender.datagrams;
+    global_stats.total_send_calls += sender.send_calls;
+    global_stats.zerocopy_sends += sender.zc_sends;
+    global_stats.zerocopy_completed += sender.zc_completed;
+    global_stats.zerocopy_copied += sender.zc_copied;
+    if (perf_enabled) {
+        perf_sample_add(&global_stats.perf_total, &perf_sample);
+    }
+    if (global_stats.num_connections < MAX_CLIENTS) {
+        ConnectionResult *conn = &global_stats.connections[global_stats.num_connections++];
+        conn->thread_id = thread_args->thread_id;
+        conn->bytes_sent = sender.bytes;
+        conn->messages_sent = thread_messages;
+        conn->duration_sec = (thread_end.tv_sec - thread_start.tv_sec) +
+                             (thread_end.tv_usec - thread_start.tv_usec) / 1000000.0;
+    }
+    pthread_mutex_unlock(&global_stats.stats_mutex);
+    
+    printf("[Thread %d] Client gone. Messages sent: %lld (%lld datagrams)\n",
+           thread_args->thread_id, thread_messages, sender.datagrams);
+    if (perf_enabled) {
+        char prefix[32];
+        snprintf(prefix, sizeof(prefix), "[Thread %d]", thread_args->thread_id);
+        perf_sample_print_brief(prefix, &perf_sample, sender.bytes);
+    }
+    
+    udp_sender_free(&sender);
+    duplex_free_fields(fields, NUM_STRING_FIELDS);
+    close(client_socket);
+    free(thread_args);
+    
+    /* Let main() know this handler is done */
+    pthread_mutex_lock(&global_stats.stats_mutex);
+    global_stats.active_threads--;
+    pthread_cond_signal(&global_stats.threads_done);
+    pthread_mutex_unlock(&global_stats.stats_mutex);
+    return NULL;
+}
+
+/* Signal handler for graceful shutdown */
+void signal_handler(int signum) {
+    (void)signum;  /* Unused parameter */
+    printf("\nShutdown signal received. Stopping server...\n");
+    server_running = 0;
+}
+
+/* Append this run's result record (one JSON line) to path */
+void write_results_json(const char *path, int message_size, int max_threads, double elapsed,
+                        int perf_counters, int gso, int zerocopy, int batch) {
+    JsonWriter w;
+    if (json_record_open(&w, path) < 0) {
+        return;
+    }
+    
+    pthread_mutex_lock(&global_stats.stats_mutex);
+    json_string(&w, "role", "server");
+    json_string(&w, "transport", "UDP");
+    json_int(&w, "message_size", message_size);
+    json_int(&w, "max_threads", max_threads);
+    json_int(&w, "bytes", global_stats.total_bytes_sent);
+    json_int(&w, "messages", global_stats.total_messages_sent);
+    json_double(&w, "elapsed_sec", elapsed);
+    json_double(&w, "throughput_gbps", (global_stats.total_bytes_sent * 8.0) / (elapsed * 1e9));
+    
+    json_begin_array(&w, "connections");
+    for (int i = 0; i < global_stats.num_connections; i++) {
+        ConnectionResult *conn = &global_stats.connections[i];
+        json_begin_object(&w, NULL);
+        json_int(&w, "thread_id", conn->thread_id);
+        json_int(&w, "bytes", conn->bytes_sent);
+        json_int(&w, "messages", conn->messages_sent);
+        json_double(&w, "duration_sec", conn->duration_sec);
+        json_double(&w, "throughput_gbps", conn->duration_sec > 0 ?
+                    (conn->bytes_sent * 8.0) / (conn->duration_sec * 1e9) : 0.0);
+        json_end_object(&w);
+    }
+    json_end_array(&w);
+    
+    json_begin_object(&w, "udp");
+    json_int(&w, "batch", batch);
+    json_int(&w, "gso", gso);
+    json_int(&w, "zerocopy", zerocopy);
+    json_int(&w, "datagrams", global_stats.total_datagrams_sent);
+    json_int(&w, "send_calls", global_stats.total_send_calls);
+    json_double(&w, "datagrams_per_call", global_stats.total_send_calls > 0 ?
+                (double)global_stats.total_datagrams_sent / global_stats.total_send_calls : 0.0);
+    if (zerocopy) {
+        json_int(&w, "zerocopy_sends", global_stats.zerocopy_sends);
+        json_int(&w, "zerocopy_completed", global_stats.zerocopy_completed);
+        json_int(&w, "zerocopy_copied", global_stats.zerocopy_copied);
+    }
+    json_end_object(&w);
+    
+    if (perf_counters) {
+        json_perf_sample(&w, "perf", &global_stats.perf_total, global_stats.total_bytes_sent);
+    }
+    pthread_mutex_unlock(&global_stats.stats_mutex);
+    
+    json_record_close(&w);
+}
+
+/* Print command line usage */
+void print_usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [options] <message_size> <max_threads>\n", prog);
+    fprintf(stderr, "  message_size: Total message size in bytes (must be multiple of 8)\n");
+    fprintf(stderr, "  max_threads: Maximum number of client threads\n");
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  --perf-counters  Count cycles/instructions/cache misses per thread\n");
+    fprintf(stderr, "                   around the send loop (perf_event_open)\n");
+    fprintf(stderr, "  --json PATH      Append a JSON-lines result record to PATH\n");
+    fprintf(stderr, "  --batch N        msghdrs per sendmmsg() call (default %d)\n",
+            UDP_DEFAULT_BATCH);
+    fprintf(stderr, "  --no-gso         One datagram per msghdr instead of up to %d\n",
+            UDP_MAX_GSO_SEGMENTS);
+    fprintf(stderr, "                   segmented by the kernel (UDP_SEGMENT)\n");
+    fprintf(stderr, "  --zerocopy       Send with MSG_ZEROCOPY (SO_ZEROCOPY on UDP)\n");
+    fprintf(stderr, "  --rr-port PORT   Also answer TCP request/response clients (--rr) on\n");
+    fprintf(stderr, "                   PORT, next to the bulk datagram streams\n");
+    fprintf(stderr, "  --class-mark     Mark bulk streams TC_PRIO_BULK/IPTOS_THROUGHPUT and\n");
+    fprintf(stderr, "                   request/response TC_PRIO_INTERACTIVE/IPTOS_LOWDELAY\n");
+}
+
+int main(int argc, char *argv[]) {
+    int perf_counters = 0;
+    const char *json_path = NULL;
+    int batch = UDP_DEFAULT_BATCH;
+    int gso = 1;
+    int zerocopy = 0;
+    int rr_port = 0;
+    int class_mark = 0;
+    
+    static struct option long_options[] = {
+        {"perf-counters", no_argument, 0, 'c'},
+        {"json", required_argument, 0, 'j'},
+        {"batch", required_argument, 0, 'b'},
+        {"no-gso", no_argument, 0, 'G'},
+        {"zerocopy", no_argument, 0, 'z'},
+        {"rr-port", required_argument, 0, 'o'},
+        {"class-mark", no_argument, 0, 'k'},
+        {0, 0, 0, 0}
+    };
+    
+    int opt_char;
+    while ((opt_char = getopt_long(argc, argv, "cj:b:Gzo:k", long_options, NULL)) != -1) {
+        switch (opt_char) {
+        case 'c':
+            perf_counters = 1;
+            break;
+        case 'j':
+            json_path = optarg;
+            break;
+        case 'b':
+            batch = atoi(optarg);
+            break;
+        case 'G':
+            gso = 0;
+            break;
+        case 'z':
+            zerocopy = 1;
+            break;
+        case 'o':
+            rr_port = atoi(optarg);
+            break;
+        case 'k':
+            class_mark = 1;
+            break;
+        default:
+            print_usage(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    
+    if (argc - optind != 2) {
+        print_usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    
+    int message_size = atoi(argv[optind]);
+    int max_threads = atoi(argv[optind + 1]);
+    
+    if (message_size % NUM_STRING_FIELDS != 0) {
+        fprintf(stderr, "Error: message_size must be divisible by %d\n", NUM_STRING_FIELDS);
+        exit(EXIT_FAILURE);
+    }
+    if (batch <= 0 || batch > 1024) {
+        fprintf(stderr, "Error: --batch must be between 1 and 1024\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    printf("=== MT25018 Part A4 Server (UDP) ===\n");
+    printf("Message size: %d bytes (%d bytes per field, %d datagram(s))\n",
+           message_size, message_size / NUM_STRING_FIELDS, udp_segments(message_size));
+    printf("Max threads: %d\n", max_threads);
+    printf("Using sendmmsg() with %d msghdrs per call%s%s\n", batch,
+           gso ? ", UDP GSO" : "", zerocopy ? ", MSG_ZEROCOPY" : "");
+    
+    /* Setup signal handlers (without SA_RESTART, so a blocked recvfrom() returns) */
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = signal_handler;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    
+    /* Create server socket; it only receives hellos */
+    int server_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (server_socket < 0) {
+        perror("socket creation failed");
+        exit(EXIT_FAILURE);
+    }
+    
+    int opt = 1;
+    if (setsockopt(server_socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
+        perror("setsockopt failed");
+        exit(EXIT_FAILURE);
+    }
+    
+    struct sockaddr_in server_addr;
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_addr.s_addr = INADDR_ANY;
+    server_addr.sin_port = htons(PORT);
+    
+    if (bind(server_socket, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
+        perror("bind failed");
+        exit(EXIT_FAILURE);
+    }
+    
+    printf("Server listening on UDP port %d...\n", PORT);
+    RrServer rr_server;
+    memset(&rr_server, 0, sizeof(rr_server));
+    if (rr_port > 0 && rr_server_start(&rr_server, rr_port, class_mark) < 0) {
+        exit(EXIT_FAILURE);
+    }
+    gettimeofday(&global_stats.start_time, NULL);
+    
+    /* One thread per client address; clients repeat their hello until data
+     * arrives, so repeats from a known address are ignored */
+    struct sockaddr_in known[MAX_CLIENTS];
+    int thread_count = 0;
+    
+    while (server_running && thread_count < max_threads && thread_count < MAX_CLIENTS) {
+        char buf[64];
+        struct sockaddr_in client_addr;
+        socklen_t client_len = sizeof(client_addr);
+    
+        ssize_t n = recvfrom(server_socket, buf, sizeof(buf), 0,
+                             (struct sockaddr *)&client_addr, &client_len);
+        if (n < 0) {
+            if (server_running) {
+                perror("recvfrom failed");
+            }
+            continue;
+        }
+        if (udp_control_kind(buf, n) != UDP_HELLO) {
+            continue;
+        }
+        int seen = 0;
+        for (int i = 0; i < thread_count; i++) {
+            if (known[i].sin_addr.s_addr == client_addr.sin_addr.s_addr &&
+                known[i].sin_port == client_addr.sin_port) {
+                seen = 1;
+                break;
+            }
+        }
+        if (seen) {
+            continue;
+        }
+    
+        printf("Client %d registered from %s:%d\n",
+               thread_count + 1,
+               inet_ntoa(client_addr.sin_addr),
+               ntohs(client_addr.sin_port));
+    
+        /* Create thread arguments */
+        ThreadArgs *args = (ThreadArgs *)malloc(sizeof(ThreadArgs));
+        args->client_addr = client_addr;
+        args->message_size = message_size;
+        args->thread_id = thread_count + 1;
+        args->perf_counters = perf_counters;
+        args->gso = gso;
+        args->zerocopy = zerocopy;
+        args->batch = batch;
+        args->class_mark = class_mark;
+    
+        pthread_mutex_lock(&global_stats.stats_mutex);
+        global_stats.active_threads++;
+        pthread_mutex_unlock(&global_stats.stats_mutex);
+    
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, client_handler, args) != 0) {
+            perror("pthread_create failed");
+            pthread_mutex_lock(&global_stats.stats_mutex);
+            global_stats.active_threads--;
+            pthread_mutex_unlock(&global_stats.stats_mutex);
+            free(args);
+            continue;
+        }
+    
+        pthread_detach(thread);
+        known[thread_count++] = client_addr;
+    }
+    
+    printf("Maximum threads reached or shutdown requested. Waiting for clients...\n");
+    
+    /* Wait for all threads to complete (at most 2 more seconds once
+     * shutdown has been requested) */
+    int shutdown_wait = 0;
+    pthread_mutex_lock(&global_stats.stats_mutex);
+    while (global_stats.active_threads > 0 && shutdown_wait < 2) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += 1;
+        pthread_cond_timedwait(&global_stats.threads_done, &global_stats.stats_mutex, &deadline);
+        if (!server_running) {
+            shutdown_wait++;
+        }
+    }
+    pthread_mutex_unlock(&global_stats.stats_mutex);
+    
+    /* Print final statistics */
+    struct timeval end_time;
+    gettimeofday(&end_time, NULL);
+    double elapsed = (end_time.tv_sec - global_stats.start_time.tv_sec) +
+                     (end_time.tv_usec - global_stats.start_time.tv_usec) / 1000000.0;
+    
+    pthread_mutex_lock(&global_stats.stats_mutex);
+    printf("\n=== Server Statistics ===\n");
+    printf("Total bytes sent: %lld\n", global_stats.total_bytes_sent);
+    printf("Total messages sent: %lld\n", global_stats.total_messages_sent);
+    printf("Total datagrams sent: %lld (%.1f per sendmmsg())\n",
+           global_stats.total_datagrams_sent, global_stats.total_send_calls > 0 ?
+           (double)global_stats.total_datagrams_sent / global_stats.total_send_calls : 0.0);
+    printf("Elapsed time: %.2f seconds\n", elapsed);
+    printf("Throughput: %.2f Gbps\n",
+           (global_stats.total_bytes_sent * 8.0) / (elapsed * 1e9));
+    if (zerocopy) {
+        printf("MSG_ZEROCOPY: %lld sends, %lld completed, %lld copied by the kernel\n",
+               global_stats.zerocopy_sends, global_stats.zerocopy_completed,
+               global_stats.zerocopy_copied);
+    }
+    
+    if (perf_counters) {
+        perf_sample_print("Hardware Counters (steady-state send loop)",
+                          &global_stats.perf_total, global_stats.total_bytes_sent);
+    }
+    pthread_mutex_unlock(&global_stats.stats_mutex);
+    
+    if (json_path) {
+        write_results_json(json_path, message_size, max_threads, elapsed, perf_counters,
+                           gso, zerocopy, batch);
+    }
+    
+    rr_server_stop(&rr_server);
+    if (rr_port > 0) {
+        rr_server_print(&rr_server);
+    }
+    close(server_socket);
+    pthread_mutex_destroy(&global_stats.stats_mutex);
+    
+    return 0;
+}
@@ -0,0 +1,226 @@
+#!/usr/bin/env python3
+"""
+MT25018 - Graduate Systems PA02
+Part C: Aggregate structured result records across all clients
+
+Reads the JSON-lines records written by the servers and clients (--json)
+and prints one aggregate per experiment:
+  - throughput summed over every client, plus per-client min/max and
+    Jain's fairness index
+  - latency percentiles from the merged client histograms
+  - server counters and client cycles summed over all clients
+  - with --netstack, the run's softirq time, segments, retransmits and
+    drops (MT25018_Part_C_netstack_snapshot.py delta output)
+
+With --repeats, the inputs are instead per-run aggregates (--format json
+output of repeated runs of one configuration); every metric is averaged
+and a NAME_ci95 half-width (Student t, 95%) is added.
+
+Usage:
+  python3 MT25018_Part_C_aggregate_results.py [--format shell|json] \\
+      [--server SERVER_JSON] [--netstack NETSTACK_JSON] CLIENT_JSON [CLIENT_JSON ...]
+  python3 MT25018_Part_C_aggregate_results.py --repeats RUN_JSON [RUN_JSON ...]
+
+--format shell (default) prints NAME=VALUE lines for the experiment runner.
+"""
+
+import argparse
+import json
+import math
+import sys
+
+# Two-sided 95% Student t critical values, indexed by degrees of freedom
+T_CRITICAL_95 = [
+    0.0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262,
+    2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093,
+    2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+]
+
+
+def load_records(path):
+    """Return every JSON record in a JSON-lines file (empty if missing)"""
+    records = []
+    try:
+        with open(path) as f:
+            for line in f:
+                line = line.strip()
+                if line:
+                    records.append(json.loads(line))
+    except (OSError, ValueError) as e:
+        print(f"Warning: could not read {path}: {e}", file=sys.stderr)
+    return records
+
+
+def bucket_lower_bound(index, sub_bits):
+    """Decode a bucket index (same scheme as MT25018_Common_Results.h)"""
+    sub_buckets = 1 << sub_bits
+    if index < sub_buckets:
+        return index
+    msb = index // sub_buckets + sub_bits - 1
+    sub = index % sub_buckets
+    return (sub_buckets + sub) << (msb - sub_bits)
+
+
+class MergedHistogram:
+    def __init__(self):
+        self.counts = {}
+        self.samples = 0
+        self.sum_ns = 0
+        self.max_ns = 0
+        self.sub_bits = 3
+
+    def add(self, hist):
+        self.sub_bits = hist.get("sub_bits", self.sub_bits)
+        self.samples += hist.get("samples", 0)
+        self.sum_ns += hist.get("sum_ns", 0)
+        self.max_ns = max(self.max_ns, hist.get("max_ns", 0))
+        for index, count in hist.get("buckets", []):
+            self.counts[index] = self.counts.get(index, 0) + count
+
+    def mean_us(self):
+        return self.sum_ns / self.samples / 1000.0 if self.samples else 0.0
+
+    def percentile_us(self, pct):
+        if not self.samples:
+            return 0.0
+        target = int(self.samples * pct / 100.0)
+        seen = 0
+        for index in sorted(self.counts):
+            seen += self.counts[index]
+            if seen > target:
+                return bucket_lower_bound(index, self.sub_bits) / 1000.0
+        return self.max_ns / 1000.0
+
+
+def jain_index(values):
+    """(sum x)^2 / (n * sum x^2): 1 when all equal, 1/n when one takes all"""
+    sum_sq = sum(v * v for v in values)
+    return sum(values) ** 2 / (len(values) * sum_sq) if sum_sq > 0 else 0.0
+
+
+def aggregate(server_records, client_records, netstack=None):
+    result = {}
+
+    throughputs = [c.get("throughput_gbps", 0.0) for c in client_records]
+    result["num_clients"] = len(client_records)
+    result["throughput_gbps"] = sum(throughputs)
+    result["total_bytes"] = sum(c.get("bytes", 0) for c in client_records)
+    result["total_messages"] = sum(c.get("messages", 0) for c in client_records)
+    result["duration_sec"] = max([c.get("elapsed_sec", 0.0) for c in client_records] or [0.0])
+    result["client_min_gbps"] = min(throughputs) if throughputs else 0.0
+    result["client_max_gbps"] = max(throughputs) if throughputs else 0.0
+    result["client_min_max_ratio"] = (result["client_min_gbps"] / result["client_max_gbps"]
+                                      if result["client_max_gbps"] > 0 else 0.0)
+    result["client_jain_index"] = jain_index(throughputs)
+
+    hist = MergedHistogram()
+    for c in client_records:
+        if "latency_ns" in c:
+            hist.add(c["latency_ns"])
+    result["latency_avg_us"] = hist.mean_us()
+    result["latency_p50_us"] = hist.percentile_us(50.0)
+    result["latency_p99_us"] = hist.percentile_us(99.0)
+    result["latency_p999_us"] = hist.percentile_us(99.9)
+
+    # Request/response clients: latency from each request's scheduled slot
+    intended = MergedHistogram()
+    for c in client_records:
+        if "intended_ns" in c.get("request_response", {}):
+            intended.add(c["request_response"]["intended_ns"])
+    if intended.samples:
+        result["rr_intended_p50_us"] = intended.percentile_us(50.0)
+        result["rr_intended_p99_us"] = intended.percentile_us(99.0)
+        result["rr_intended_p999_us"] = intended.percentile_us(99.9)
+
+    # Server counters (last server record wins if the file was appended twice)
+    perf = server_records[-1].get("perf", {}) if server_records else {}
+    for key in ("cycles", "instructions", "cache_misses", "l1d_misses",
+                "llc_misses", "context_switches", "ipc", "cycles_per_byte"):
+        result["server_" + key] = perf.get(key, 0)
+    # Per-connection fairness seen by the server (throughput / scheduler weight)
+    if server_records and "jain_index" in server_records[-1]:
+        result["server_jain_index"] = server_records[-1]["jain_index"]
+
+    client_cycles = sum(c.get("perf", {}).get("cycles", 0) for c in client_records)
+    result["client_cycles"] = client_cycles
+    result["client_cycles_per_byte"] = (client_cycles / result["total_bytes"]
+                                        if result["total_bytes"] else 0.0)
+
+    # Kernel-side cost the in-process counters miss (scalars only, so
+    # repeats can be averaged)
+    if netstack:
+        for key, value in netstack.items():
+            if isinstance(value, (int, float)):
+                result[key] = value
+        result["softirq_ns_per_byte"] = (netstack.get("softirq_sec", 0.0) * 1e9 / result["total_bytes"]
+                                         if result["total_bytes"] else 0.0)
+    return result
+
+
+def mean_ci95(values):
+    """Mean and 95% confidence half-width (0 for a single sample)"""
+    n = len(values)
+    if n == 0:
+        return 0.0, 0.0
+    mean = sum(values) / n
+    if n < 2:
+        return mean, 0.0
+    variance = sum((v - mean) ** 2 for v in values) / (n - 1)
+    t = T_CRITICAL_95[n - 1] if n - 1 < len(T_CRITICAL_95) else 1.960
+    return mean, t * math.sqrt(variance / n)
+
+
+def summarize_repeats(runs):
+    """Average per-run aggregates of one configuration"""
+    result = {"repeats": len(runs)}
+    keys = []
+    for run in runs:
+        keys.extend(k for k in run if k not in keys)
+    for key in keys:
+        raw = [run[key] for run in runs if key in run]
+        mean, ci95 = mean_ci95([float(v) for v in raw])
+        # Keep counters (bytes, cycles, ...) integral in the CSVs
+        result[key] = round(mean) if all(isinstance(v, int) for v in raw) else mean
+        result[key + "_ci95"] = ci95
+    return result
+
+
+def format_value(value):
+    if isinstance(value, float):
+        return f"{value:.3f}"
+    return str(value)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Aggregate MT25018 result records")
+    parser.add_argument("--server", help="server JSON-lines record file")
+    parser.add_argument("--netstack", help="softirq/network-stack delta record of the run")
+    parser.add_argument("--format", choices=("shell", "json"), default="shell")
+    parser.add_argument("--repeats", action="store_true",
+                        help="inputs are per-run aggregates to average with 95%% CIs")
+    parser.add_argument("files", nargs="+",
+                        help="client JSON-lines record files (or run aggregates with --repeats)")
+    args = parser.parse_args()
+
+    if args.repeats:
+        runs = []
+        for path in args.files:
+            runs.extend(load_records(path))
+        result = summarize_repeats(runs)
+    else:
+        server_records = load_records(args.server) if args.server else []
+        client_records = []
+        for path in args.files:
+            client_records.extend(r for r in load_records(path) if r.get("role") == "client")
+        netstack = load_records(args.netstack) if args.netstack else []
+        result = aggregate(server_records, client_records, netstack[-1] if netstack else None)
+
+    if args.format == "json":
+        print(json.dumps(result))
+    else:
+        for key, value in result.items():
+            print(f"{key}={format_value(value)}")
+
+
+if __name__ == "__main__":
+    main()
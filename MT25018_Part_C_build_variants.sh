@@ -0,0 +1,185 @@
+#!/bin/bash
+# MT25018 - Graduate Systems PA02
+# Part C: Build variant benchmark
+# Measures the plain -O2 build against the size-specialized, LTO and PGO
+# builds (make specialized / lto / pgo) on loopback and reports the speedup
+#
+#   train DIR   Short loopback run of every implementation with the binaries
+#               in DIR; used by `make pgo` to collect the training profiles
+#   compare     Runs every implementation, message size and build variant
+#               and writes MT25018_Part_C_Build_Speedup.csv
+#
+# Runs need no namespaces (and no sudo); port 8080 must be free.
+
+set -e
+
+BUILD_DIR="build"
+SPEEDUP_CSV="MT25018_Part_C_Build_Speedup.csv"
+WORK_DIR="experiment_results/build_variants"
+IMPLEMENTATIONS=("A1" "A2" "A3" "A4")
+IMPL_NAMES=("TwoCopy" "OneCopy" "ZeroCopy" "UDP")
+MESSAGE_SIZES=(512 4096 16384 65536)
+TRAIN_SIZES=(4096 65536)
+TRAIN_DURATION=2
+DURATION=5
+CLIENTS=2
+REPEATS=3
+
+usage() {
+    echo "Usage: $0 train DIR"
+    echo "       $0 compare [-d duration_sec] [-t clients] [-n repeats]"
+    echo "  -d S  Client test duration in seconds (default: $DURATION)"
+    echo "  -t N  Concurrent clients per run (default: $CLIENTS)"
+    echo "  -n N  Runs per build variant, reported as the median (default: $REPEATS)"
+}
+
+# Run one server with N clients on loopback and print the aggregate
+# NAME=VALUE lines (throughput_gbps, server_cycles_per_byte, ...)
+run_loopback() {
+    local server_bin=$1
+    local client_bin=$2
+    local msg_size=$3
+    local clients=$4
+    local duration=$5
+    local out_dir=$6
+    
+    mkdir -p "$out_dir"
+    rm -f "$out_dir"/*.json
+    
+    "$server_bin" --perf-counters --json "$out_dir/server.json" "$msg_size" "$clients" \
+        > "$out_dir/server.txt" 2>&1 &
+    local server_pid=$!
+    sleep 1
+    if ! kill -0 $server_pid 2>/dev/null; then
+        echo "Server failed to start: $server_bin" >&2
+        return 1
+    fi
+    
+    local client_pids=()
+    local client_jsons=()
+    for ((i=1; i<=clients; i++)); do
+        "$client_bin" --perf-counters --json "$out_dir/client_${i}.json" \
+            127.0.0.1 "$msg_size" "$duration" > "$out_dir/client_${i}.txt" 2>&1 &
+        client_pids+=($!)
+        client_jsons+=("$out_dir/client_${i}.json")
+    done
+    for pid in "${client_pids[@]}"; do
+        wait $pid || true
+    done
+    
+    # A clean exit also writes the PGO profile of an instrumented server
+    sleep 1
+    kill -INT $server_pid 2>/dev/null || true
+    wait $server_pid 2>/dev/null || true
+    
+    python3 MT25018_Part_C_aggregate_results.py --server "$out_dir/server.json" "${client_jsons[@]}"
+}
+
+train() {
+    local dir=$1
+    
+    for impl in "${IMPLEMENTATIONS[@]}"; do
+        for msg_size in "${TRAIN_SIZES[@]}"; do
+            echo "Training $impl with $msg_size-byte messages"
+            run_loopback "$dir/MT25018_Part_${impl}_Server" "$dir/MT25018_Part_${impl}_Client" \
+                "$msg_size" 2 "$TRAIN_DURATION" "$WORK_DIR/train" > /dev/null
+        done
+    done
+}
+
+# Binary of a build variant, empty when it was not built (or does not
+# exist for the implementation, like a specialized UDP build)
+variant_bin() {
+    local variant=$1
+    local impl=$2
+    local role=$3
+    local msg_size=$4
+    
+    local bin
+    case $variant in
+        plain) bin="MT25018_Part_${impl}_${role}" ;;
+        specialized) bin="$BUILD_DIR/specialized/MT25018_Part_${impl}_${role}_${msg_size}" ;;
+        *) bin="$BUILD_DIR/$variant/MT25018_Part_${impl}_${role}" ;;
+    esac
+    if [ -x "$bin" ]; then
+        echo "$(pwd)/$bin"
+    fi
+}
+
+# Median of the numbers on stdin
+median() {
+    sort -g | awk '{ v[NR] = $1 } END { if (NR == 0) print 0; else if (NR % 2) print v[(NR + 1) / 2]; else print (v[NR / 2] + v[NR / 2 + 1]) / 2 }'
+}
+
+compare() {
+    while getopts "d:t:n:h" opt; do
+        case $opt in
+            d) DURATION=$OPTARG ;;
+            t) CLIENTS=$OPTARG ;;
+            n) REPEATS=$OPTARG ;;
+            *) usage; exit 1 ;;
+        esac
+    done
+    
+    if [ -z "$(variant_bin plain A1 Server 0)" ]; then
+        echo "ERROR: build the plain binaries first (make)"
+        exit 1
+    fi
+    
+    echo "Implementation,MessageSize,Build,Throughput_Gbps,CyclesPerByte,Speedup,Repeats" > "$SPEEDUP_CSV"
+    for impl_idx in "${!IMPLEMENTATIONS[@]}"; do
+        local impl="${IMPLEMENTATIONS[$impl_idx]}"
+        for msg_size in "${MESSAGE_SIZES[@]}"; do
+            local plain_gbps=0
+            for variant in plain specialized lto pgo; do
+                local server_bin=$(variant_bin $variant $impl Server $msg_size)
+                local client_bin=$(variant_bin $variant $impl Client $msg_size)
+                if [ -z "$server_bin" ] || [ -z "$client_bin" ]; then
+                    continue
+                fi
+    
+                local gbps_runs=() cpb_runs=()
+                for ((rep=1; rep<=REPEATS; rep++)); do
+                    local throughput_gbps=0 server_cycles_per_byte=0 name value
+                    while IFS='=' read -r name value; do
+                        case "$name" in
+                            throughput_gbps) throughput_gbps=$value ;;
+                            server_cycles_per_byte) server_cycles_per_byte=$value ;;
+                        esac
+                    done < <(run_loopback "$server_bin" "$client_bin" "$msg_size" "$CLIENTS" "$DURATION" \
+                        "$WORK_DIR/run")
+                    gbps_runs+=("$throughput_gbps")
+                    cpb_runs+=("$server_cycles_per_byte")
+                done
+                local gbps=$(printf '%s\n' "${gbps_runs[@]}" | median)
+                local cpb=$(printf '%s\n' "${cpb_runs[@]}" | median)
+                if [ "$variant" = "plain" ]; then
+                    plain_gbps=$gbps
+                fi
+                local speedup=$(awk -v v="$gbps" -v p="$plain_gbps" 'BEGIN { printf "%.3f", (p > 0 ? v / p : 0) }')
+    
+                echo "${IMPL_NAMES[$impl_idx]},$msg_size,$variant,$gbps,$cpb,$speedup,$REPEATS" >> "$SPEEDUP_CSV"
+                echo "${IMPL_NAMES[$impl_idx]} | MsgSize=$msg_size | $variant: $gbps Gbps, $cpb cycles/byte, speedup ${speedup}x"
+            done
+        done
+    done
+    echo "Results saved to $SPEEDUP_CSV"
+}
+
+case "$1" in
+    train)
+        if [ -z "$2" ]; then
+            usage
+            exit 1
+        fi
+        train "$2"
+        ;;
+    compare)
+        shift
+        compare "$@"
+        ;;
+    *)
+        usage
+        exit 1
+        ;;
+esac
@@ -0,0 +1,247 @@
+#!/usr/bin/env python3
+"""
+MT25018 - Graduate Systems PA02
+Part C: Idle-connection scaling test
+
+Ramps one server (--persistent, --mem-account) on loopback up to thousands
+of mostly idle connections. An idle connection connects and never reads,
+so its handler thread blocks in send() once the socket buffers are full;
+that is the most memory a connection can pin. At every step:
+  - the idle connections are opened (and kept from the previous step)
+  - after --settle seconds the server's memory accounting row is read:
+    RSS growth, kernel socket memory, user buffers and reserved stacks
+  - one active client measures throughput next to the idle connections
+The ramp stops at the first step the server cannot hold: a failed
+connect, connections the server dropped (out of descriptors, threads or
+memory), or a server that exited. The thread-per-connection limits of the
+host (open files, threads-max, vm.max_map_count) are printed up front.
+
+Usage:
+  python3 MT25018_Part_C_idle_scaling.py [--impl A1|A2|A3] [--message-size N] \\
+      [--steps 0,100,250,...] [--settle S] [--duration S] [--rcvbuf BYTES]
+"""
+
+import argparse
+import csv
+import json
+import os
+import resource
+import signal
+import socket
+import subprocess
+import sys
+import time
+
+PORT = 8080
+IMPL_NAMES = {"A1": "TwoCopy", "A2": "OneCopy", "A3": "ZeroCopy"}
+DEFAULT_STEPS = "0,100,250,500,1000,2000,4000"
+
+
+def raise_fd_limit():
+    """Lift the soft open-file limit to the hard one (also for children)"""
+    soft, hard = resource.getrlimit(resource.RLIMIT_NOFILE)
+    if soft < hard:
+        resource.setrlimit(resource.RLIMIT_NOFILE, (hard, hard))
+
+
+def read_sysctl(path):
+    try:
+        with open(path) as f:
+            return f.read().strip()
+    except OSError:
+        return "?"
+
+
+def print_limits():
+    files = resource.getrlimit(resource.RLIMIT_NOFILE)[0]
+    procs = resource.getrlimit(resource.RLIMIT_NPROC)[0]
+    stack = resource.getrlimit(resource.RLIMIT_STACK)[0]
+    print(f"Open files: {files}, processes/threads (RLIMIT_NPROC): "
+          f"{'unlimited' if procs == resource.RLIM_INFINITY else procs}")
+    print(f"Thread stack (RLIMIT_STACK): "
+          f"{'unlimited' if stack == resource.RLIM_INFINITY else f'{stack // 1024} KB'}")
+    print(f"kernel.threads-max: {read_sysctl('/proc/sys/kernel/threads-max')}, "
+          f"vm.max_map_count: {read_sysctl('/proc/sys/vm/max_map_count')} "
+          f"(two maps per thread: stack and guard)")
+    print(f"net.ipv4.tcp_mem (pages): {read_sysctl('/proc/sys/net/ipv4/tcp_mem')}")
+
+
+def last_row(path):
+    """Last data row of the server's memory accounting CSV, or None"""
+    try:
+        with open(path) as f:
+            rows = list(csv.DictReader(f))
+    except OSError:
+        return None
+    return rows[-1] if rows else None
+
+
+def first_row(path):
+    try:
+        with open(path) as f:
+            for row in csv.DictReader(f):
+                return row
+    except OSError:
+        pass
+    return None
+
+
+def wait_for_tick(path, interval_sec):
+    """Wait for a memory accounting row taken after now"""
+    before = last_row(path)
+    deadline = time.time() + 5 * interval_sec + 1
+    while time.time() < deadline:
+        time.sleep(interval_sec / 2)
+        row = last_row(path)
+        if row is not None and (before is None or row["Time_sec"] != before["Time_sec"]):
+            return row
+    return last_row(path)
+
+
+def open_idle(count, rcvbuf, idle):
+    """Grow idle to count connections; returns an error string or None"""
+    while len(idle) < count:
+        s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        try:
+            if rcvbuf:
+                s.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, rcvbuf)
+            s.settimeout(5)
+            s.connect(("127.0.0.1", PORT))
+        except OSError as e:
+            s.close()
+            return f"connect {len(idle) + 1} failed: {e.strerror or e}"
+        idle.append(s)
+    return None
+
+
+def run_active(client_bin, message_size, duration, json_path):
+    """Throughput (Gbps) of one active client, 0 if it failed"""
+    if os.path.exists(json_path):
+        os.remove(json_path)
+    subprocess.run([client_bin, "--json", json_path, "127.0.0.1", str(message_size),
+                    str(duration)], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL,
+                   timeout=duration + 30)
+    try:
+        with open(json_path) as f:
+            return json.loads(f.read().strip().splitlines()[-1]).get("throughput_gbps", 0.0)
+    except (OSError, ValueError, IndexError):
+        return 0.0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Idle-connection scaling test")
+    parser.add_argument("--impl", choices=sorted(IMPL_NAMES), default="A2")
+    parser.add_argument("--message-size", type=int, default=4096)
+    parser.add_argument("--steps", default=DEFAULT_STEPS,
+                        help=f"comma-separated idle connection counts (default {DEFAULT_STEPS})")
+    parser.add_argument("--settle", type=float, default=2.0,
+                        help="seconds for the idle socket buffers to fill at each step")
+    parser.add_argument("--duration", type=int, default=3,
+                        help="active client duration in seconds (0 skips it)")
+    parser.add_argument("--rcvbuf", type=int, default=0,
+                        help="SO_RCVBUF of the idle connections (default: kernel default)")
+    parser.add_argument("--interval-ms", type=int, default=250,
+                        help="server memory accounting interval")
+    parser.add_argument("--out-dir", default="experiment_results/idle_scaling")
+    parser.add_argument("--csv", default="MT25018_Part_C_Idle_Scaling.csv")
+    args = parser.parse_args()
+
+    steps = sorted(int(s) for s in args.steps.split(","))
+    impl_name = IMPL_NAMES[args.impl]
+    server_bin = f"./MT25018_Part_{args.impl}_Server"
+    client_bin = f"./MT25018_Part_{args.impl}_Client"
+    if not (os.access(server_bin, os.X_OK) and os.access(client_bin, os.X_OK)):
+        print(f"ERROR: {server_bin} / {client_bin} not built (run make)", file=sys.stderr)
+        return 1
+
+    raise_fd_limit()
+    print("=" * 78)
+    print(f"MT25018 - Idle-Connection Scaling ({impl_name}, {args.message_size}-byte messages)")
+    print("=" * 78)
+    print_limits()
+
+    os.makedirs(args.out_dir, exist_ok=True)
+    mem_csv = os.path.join(args.out_dir, f"{impl_name}_memory.csv")
+    server_log = open(os.path.join(args.out_dir, f"{impl_name}_server.txt"), "w")
+    active_json = os.path.join(args.out_dir, f"{impl_name}_active.json")
+
+    # Room for every idle connection plus the active client
+    server = subprocess.Popen([server_bin, "--persistent", "--mem-account", mem_csv,
+                               "--mem-account-ms", str(args.interval_ms),
+                               str(args.message_size), str(steps[-1] + 1)],
+                              stdout=server_log, stderr=subprocess.STDOUT,
+                              preexec_fn=raise_fd_limit)
+    time.sleep(1)
+    if server.poll() is not None:
+        print("ERROR: server failed to start", file=sys.stderr)
+        return 1
+
+    interval_sec = args.interval_ms / 1000.0
+    baseline = first_row(mem_csv) or wait_for_tick(mem_csv, interval_sec)
+    baseline_rss_kb = int(baseline["RSS_KB"]) if baseline else 0
+
+    rows = []
+    idle = []
+    print(f"\n{'Idle':>6} {'Held':>6} {'RSS MB':>8} {'RSS/conn KB':>12} {'Sock MB':>8} "
+          f"{'Sock/conn KB':>13} {'Stacks MB':>10} {'Active Gbps':>12}  Status")
+    print("-" * 98)
+    try:
+        for step in steps:
+            status = open_idle(step, args.rcvbuf, idle) or "ok"
+            time.sleep(args.settle)
+            row = wait_for_tick(mem_csv, interval_sec)
+            if server.poll() is not None:
+                status = f"server exited ({server.returncode})"
+            held = int(row["Connections"]) if row else 0
+            if status == "ok" and held < len(idle):
+                status = f"server holds {held} of {len(idle)}"
+
+            rss_kb = int(row["RSS_KB"]) if row else 0
+            socket_kb = int(row["SocketTotal_KB"]) if row else 0
+            result = {
+                "Implementation": impl_name,
+                "MessageSize": args.message_size,
+                "IdleConnections": len(idle),
+                "ServerConnections": held,
+                "RSS_MB": round(rss_kb / 1024.0, 2),
+                "RSS_per_conn_KB": round((rss_kb - baseline_rss_kb) / held, 2) if held else 0.0,
+                "SocketMem_MB": round(socket_kb / 1024.0, 2),
+                "SocketMem_per_conn_KB": round(socket_kb / held, 2) if held else 0.0,
+                "UserBuffers_per_conn_KB": round(int(row["UserBuffers_KB"]) / held, 2)
+                                           if held else 0.0,
+                "ThreadStacks_MB": round(int(row["ThreadStacks_KB"]) / 1024.0, 1) if row else 0.0,
+                "Active_Gbps": 0.0,
+                "Status": status,
+            }
+            if status == "ok" and args.duration > 0:
+                result["Active_Gbps"] = run_active(client_bin, args.message_size, args.duration,
+                                                   active_json)
+            rows.append(result)
+            print(f"{result['IdleConnections']:>6} {held:>6} {result['RSS_MB']:>8.1f} "
+                  f"{result['RSS_per_conn_KB']:>12.1f} {result['SocketMem_MB']:>8.1f} "
+                  f"{result['SocketMem_per_conn_KB']:>13.1f} {result['ThreadStacks_MB']:>10.1f} "
+                  f"{result['Active_Gbps']:>12.3f}  {status}")
+            if status != "ok":
+                break
+    finally:
+        for s in idle:
+            s.close()
+        if server.poll() is None:
+            server.send_signal(signal.SIGINT)
+            try:
+                server.wait(timeout=10)
+            except subprocess.TimeoutExpired:
+                server.kill()
+        server_log.close()
+
+    with open(args.csv, "w", newline="") as f:
+        writer = csv.DictWriter(f, fieldnames=list(rows[0].keys()))
+        writer.writeheader()
+        writer.writerows(rows)
+    print(f"\nResults written to {args.csv}")
+    print(f"Server memory time series: {mem_csv}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,284 @@
+#!/usr/bin/env python3
+"""
+MT25018 - Graduate Systems PA02
+Part C: Mixed-workload interference benchmark
+
+Bulk streams and latency-sensitive request/response flows share one
+server. For every implementation the same server process streams
+--bulk-size messages to --bulk-flows clients at full speed and answers
+--rr-flows request/response clients (--rr-size bytes, one request every
+--rr-interval-us) on its --rr-port. Scenarios:
+  alone   request/response flows only (the baseline)
+  mixed   request/response next to the bulk streams
+  marked  as mixed, with --class-mark on every socket (with --mark):
+          bulk TC_PRIO_BULK/IPTOS_THROUGHPUT, request/response
+          TC_PRIO_INTERACTIVE/IPTOS_LOWDELAY
+The p99 inflation is the request/response p99 over the baseline's.
+Round trips are timed from the send; the "sched" columns time every
+request slot from when it was due instead, so a stall also counts
+against the requests it held back (no coordinated omission).
+
+On loopback (the default) the flows compete for CPU and socket locks
+only. With --rate the server and clients run in a namespace pair joined
+by a veth link whose server side is a tbf bottleneck of that rate (needs
+root). Its queue holds --queue-packets; in the marked scenario it is a
+prio qdisc (pfifo_fast without sch_prio), one band per traffic class,
+otherwise a FIFO.
+
+Usage:
+  python3 MT25018_Part_C_interference.py [--impls A1,A2,A3,A4] [--bulk-size N] \\
+      [--bulk-flows N] [--rr-size N] [--rr-flows N] [--rr-interval-us US] \\
+      [--duration S] [--mark] [--rate RATE] [--queue-packets N]
+"""
+
+import argparse
+import csv
+import json
+import os
+import signal
+import subprocess
+import sys
+import time
+
+RR_PORT = 8081
+IMPL_NAMES = {"A1": "TwoCopy", "A2": "OneCopy", "A3": "ZeroCopy", "A4": "UDP"}
+SERVER_NS = "mix_srv_ns"
+CLIENT_NS = "mix_cli_ns"
+VETH_SRV = "mix_veth_srv"
+VETH_CLI = "mix_veth_cli"
+SERVER_IP = "10.9.1.1"
+CLIENT_IP = "10.9.1.2"
+
+
+def sh(*cmd, check=True):
+    return subprocess.run(list(cmd), check=check, stdout=subprocess.DEVNULL,
+                          stderr=subprocess.DEVNULL).returncode
+
+
+def in_ns(ns, cmd):
+    return ["ip", "netns", "exec", ns] + cmd if ns else cmd
+
+
+def setup_namespaces():
+    cleanup_namespaces()
+    sh("ip", "netns", "add", SERVER_NS)
+    sh("ip", "netns", "add", CLIENT_NS)
+    sh("ip", "link", "add", VETH_SRV, "type", "veth", "peer", "name", VETH_CLI)
+    sh("ip", "link", "set", VETH_SRV, "netns", SERVER_NS)
+    sh("ip", "link", "set", VETH_CLI, "netns", CLIENT_NS)
+    for ns, dev, ip in ((SERVER_NS, VETH_SRV, SERVER_IP), (CLIENT_NS, VETH_CLI, CLIENT_IP)):
+        sh(*in_ns(ns, ["ip", "addr", "add", f"{ip}/24", "dev", dev]))
+        sh(*in_ns(ns, ["ip", "link", "set", dev, "up"]))
+        sh(*in_ns(ns, ["ip", "link", "set", "lo", "up"]))
+
+
+def cleanup_namespaces():
+    sh("ip", "netns", "del", SERVER_NS, check=False)
+    sh("ip", "netns", "del", CLIENT_NS, check=False)
+
+
+def apply_bottleneck(rate, queue_packets, prio):
+    """tbf bottleneck on the server's egress with a FIFO or a per-class
+    inner queue; returns the inner qdisc. prio (or pfifo_fast, where
+    sch_prio is missing) with the default priomap puts TC_PRIO_INTERACTIVE
+    in band 0 and TC_PRIO_BULK in band 2. Every band holds queue_packets
+    (txqueuelen), like the FIFO."""
+    tc = ["tc", "qdisc"]
+    sh(*in_ns(SERVER_NS, ["ip", "link", "set", "dev", VETH_SRV, "txqueuelen", str(queue_packets)]))
+    sh(*in_ns(SERVER_NS, tc + ["del", "dev", VETH_SRV, "root"]), check=False)
+    sh(*in_ns(SERVER_NS, tc + ["add", "dev", VETH_SRV, "root", "handle", "1:", "tbf", "rate", rate,
+                               "burst", "64kb", "latency", "100ms"]))
+    child = tc + ["add", "dev", VETH_SRV, "parent", "1:1", "handle", "10:"]
+    if not prio:
+        sh(*in_ns(SERVER_NS, child + ["pfifo", "limit", str(queue_packets)]))
+        return "fifo"
+    for qdisc in ("prio", "pfifo_fast"):
+        if sh(*in_ns(SERVER_NS, child + [qdisc]), check=False) == 0:
+            return qdisc
+    raise RuntimeError("neither prio nor pfifo_fast is available")
+
+
+def aggregate(paths):
+    """Merged client results (throughput sum, latency percentiles)"""
+    paths = [p for p in paths if os.path.exists(p)]
+    if not paths:
+        return {}
+    out = subprocess.run([sys.executable, "MT25018_Part_C_aggregate_results.py", "--format", "json"]
+                         + paths, capture_output=True, text=True)
+    try:
+        return json.loads(out.stdout)
+    except ValueError:
+        return {}
+
+
+def run_scenario(impl, scenario, args, ns_mode, out_dir):
+    mark = scenario == "marked"
+    bulk = scenario != "alone"
+    server_ns, client_ns = (SERVER_NS, CLIENT_NS) if ns_mode else (None, None)
+    server_ip = SERVER_IP if ns_mode else "127.0.0.1"
+    queue = apply_bottleneck(args.rate, args.queue_packets, prio=mark) if ns_mode else "loopback"
+
+    run_dir = os.path.join(out_dir, f"{IMPL_NAMES[impl]}_{scenario}")
+    os.makedirs(run_dir, exist_ok=True)
+    for name in os.listdir(run_dir):
+        os.remove(os.path.join(run_dir, name))
+
+    # The UDP server has no persistent mode; it ends with its bulk clients
+    server_cmd = [f"./MT25018_Part_{impl}_Server", "--rr-port", str(RR_PORT)]
+    if impl != "A4":
+        server_cmd.append("--persistent")
+    if mark:
+        server_cmd.append("--class-mark")
+    server_cmd += [str(args.bulk_size), str(max(args.bulk_flows, 1))]
+    server_log = open(os.path.join(run_dir, "server.txt"), "w")
+    server = subprocess.Popen(in_ns(server_ns, server_cmd), stdout=server_log,
+                              stderr=subprocess.STDOUT)
+    time.sleep(1)
+    if server.poll() is not None:
+        server_log.close()
+        print(f"ERROR: {server_cmd[0]} failed to start", file=sys.stderr)
+        return None
+
+    procs, bulk_jsons, rr_jsons = [], [], []
+    if bulk:
+        # Bulk streams start first and outlast the request/response flows
+        for i in range(args.bulk_flows):
+            path = os.path.join(run_dir, f"bulk_{i + 1}.json")
+            cmd = [f"./MT25018_Part_{impl}_Client"]
+            if mark and impl != "A4":
+                cmd.append("--class-mark")
+            cmd += ["--json", path, server_ip, str(args.bulk_size), str(args.duration + 2)]
+            procs.append(subprocess.Popen(in_ns(client_ns, cmd), stdout=subprocess.DEVNULL,
+                                          stderr=subprocess.DEVNULL))
+            bulk_jsons.append(path)
+        time.sleep(1)
+    # Request/response is TCP for every implementation; UDP runs use A1's client
+    rr_client = f"./MT25018_Part_{impl if impl != 'A4' else 'A1'}_Client"
+    for i in range(args.rr_flows):
+        path = os.path.join(run_dir, f"rr_{i + 1}.json")
+        cmd = [rr_client, "--rr", str(RR_PORT), "--rr-interval", str(args.rr_interval_us)]
+        if mark:
+            cmd.append("--class-mark")
+        cmd += ["--json", path, server_ip, str(args.rr_size), str(args.duration)]
+        procs.append(subprocess.Popen(in_ns(client_ns, cmd), stdout=subprocess.DEVNULL,
+                                      stderr=subprocess.DEVNULL))
+        rr_jsons.append(path)
+
+    for p in procs:
+        try:
+            p.wait(timeout=args.duration + 30)
+        except subprocess.TimeoutExpired:
+            p.kill()
+    if server.poll() is None:
+        server.send_signal(signal.SIGINT)
+        try:
+            server.wait(timeout=10)
+        except subprocess.TimeoutExpired:
+            server.kill()
+    server_log.close()
+
+    rr = aggregate(rr_jsons)
+    bulk_result = aggregate(bulk_jsons)
+    return {
+        "Implementation": IMPL_NAMES[impl],
+        "Scenario": scenario,
+        "Queue": queue,
+        "BulkSize": args.bulk_size,
+        "BulkFlows": args.bulk_flows if bulk else 0,
+        "RRSize": args.rr_size,
+        "RRFlows": args.rr_flows,
+        "Bulk_Gbps": round(bulk_result.get("throughput_gbps", 0.0), 3),
+        "RR_Requests": rr.get("total_messages", 0),
+        "RR_P50_us": round(rr.get("latency_p50_us", 0.0), 2),
+        "RR_P99_us": round(rr.get("latency_p99_us", 0.0), 2),
+        "RR_P999_us": round(rr.get("latency_p999_us", 0.0), 2),
+        "RR_Sched_P50_us": round(rr.get("rr_intended_p50_us", 0.0), 2),
+        "RR_Sched_P99_us": round(rr.get("rr_intended_p99_us", 0.0), 2),
+        "RR_Sched_P999_us": round(rr.get("rr_intended_p999_us", 0.0), 2),
+        "P99_Inflation": 0.0,
+        "Sched_P99_Inflation": 0.0,
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Mixed-workload interference benchmark")
+    parser.add_argument("--impls", default="A1,A2,A3",
+                        help="comma-separated implementations carrying the bulk streams")
+    parser.add_argument("--bulk-size", type=int, default=65536)
+    parser.add_argument("--bulk-flows", type=int, default=2)
+    parser.add_argument("--rr-size", type=int, default=64)
+    parser.add_argument("--rr-flows", type=int, default=2)
+    parser.add_argument("--rr-interval-us", type=int, default=1000)
+    parser.add_argument("--duration", type=int, default=5,
+                        help="request/response duration in seconds")
+    parser.add_argument("--mark", action="store_true",
+                        help="add the marked scenario (SO_PRIORITY/IP_TOS per class)")
+    parser.add_argument("--rate", help="bottleneck rate, e.g. 1gbit (namespaces, needs root)")
+    parser.add_argument("--queue-packets", type=int, default=1000,
+                        help="bottleneck queue length per band in packets (default 1000)")
+    parser.add_argument("--out-dir", default="experiment_results/interference")
+    parser.add_argument("--csv", default="MT25018_Part_C_Interference.csv")
+    args = parser.parse_args()
+
+    impls = args.impls.split(",")
+    for impl in impls:
+        if impl not in IMPL_NAMES:
+            print(f"ERROR: unknown implementation {impl}", file=sys.stderr)
+            return 1
+        for role in ("Server", "Client"):
+            if not os.access(f"./MT25018_Part_{impl}_{role}", os.X_OK):
+                print(f"ERROR: ./MT25018_Part_{impl}_{role} not built (run make)", file=sys.stderr)
+                return 1
+    if args.rate and os.geteuid() != 0:
+        print("ERROR: --rate needs root for the network namespaces", file=sys.stderr)
+        return 1
+
+    scenarios = ["alone", "mixed"] + (["marked"] if args.mark else [])
+    print("=" * 116)
+    print(f"MT25018 - Mixed-Workload Interference ({args.bulk_flows} x {args.bulk_size}-byte bulk, "
+          f"{args.rr_flows} x {args.rr_size}-byte request/response every {args.rr_interval_us} us)")
+    print(f"Network: {f'{args.rate} bottleneck, {args.queue_packets}-packet queue' if args.rate else 'loopback'}")
+    print("=" * 116)
+    print(f"{'Implementation':<15} {'Scenario':<8} {'Queue':<9} {'Bulk Gbps':>10} {'RR reqs':>8} "
+          f"{'p50 us':>9} {'p99 us':>9} {'p99.9 us':>9} {'p99 x':>7} "
+          f"{'sched p99':>10} {'sched x':>8}")
+    print("-" * 116)
+
+    rows = []
+    if args.rate:
+        setup_namespaces()
+    try:
+        for impl in impls:
+            baseline_p99 = baseline_sched_p99 = 0.0
+            for scenario in scenarios:
+                row = run_scenario(impl, scenario, args, bool(args.rate), args.out_dir)
+                if row is None:
+                    continue
+                if scenario == "alone":
+                    baseline_p99 = row["RR_P99_us"]
+                    baseline_sched_p99 = row["RR_Sched_P99_us"]
+                if baseline_p99 > 0:
+                    row["P99_Inflation"] = round(row["RR_P99_us"] / baseline_p99, 2)
+                if baseline_sched_p99 > 0:
+                    row["Sched_P99_Inflation"] = round(row["RR_Sched_P99_us"] / baseline_sched_p99, 2)
+                rows.append(row)
+                print(f"{row['Implementation']:<15} {scenario:<8} {row['Queue']:<9} "
+                      f"{row['Bulk_Gbps']:>10.3f} {row['RR_Requests']:>8} {row['RR_P50_us']:>9.1f} "
+                      f"{row['RR_P99_us']:>9.1f} {row['RR_P999_us']:>9.1f} {row['P99_Inflation']:>7.2f} "
+                      f"{row['RR_Sched_P99_us']:>10.1f} {row['Sched_P99_Inflation']:>8.2f}")
+    finally:
+        if args.rate:
+            cleanup_namespaces()
+
+    if not rows:
+        return 1
+    with open(args.csv, "w", newline="") as f:
+        writer = csv.DictWriter(f, fieldnames=list(rows[0].keys()))
+        writer.writeheader()
+        writer.writerows(rows)
+    print(f"\nResults written to {args.csv}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+"""
+MT25018 - Graduate Systems PA02
+Part C: Per-message latency breakdown from kernel timestamps
+
+Joins the SO_TIMESTAMPING trace lines written by the servers ("tx" lines)
+and clients ("rx" lines) with --timestamps PATH on (client port, message
+index) and splits each sampled message's latency into:
+  - user->kernel: server send() entry until the last byte reaches the
+                  packet scheduler (includes the TCP send queue)
+  - kernel queue: packet scheduler to driver hand-off (qdisc, veth xmit)
+  - wire/veth:    driver hand-off to the client's RX software timestamp
+  - kernel->user: RX timestamp until the client's receive returns
+The servers and clients must share a clock (same host, e.g. the runner's
+network namespaces); both sides use CLOCK_REALTIME. Client ports are
+reused over time, so use one trace file per run.
+
+Trace line formats:
+  tx,<transport>,<port>,<message>,<user_ns>,<sched_ns>,<sent_ns>,<ack_ns>
+  rx,<transport>,<port>,<message>,<rx_ns>,<user_ns>
+
+Usage:
+  python3 MT25018_Part_C_latency_breakdown.py TRACE [TRACE ...] [--csv OUT]
+"""
+
+import argparse
+import csv
+import sys
+
+COMPONENTS = ["user->kernel", "kernel queue", "wire/veth", "kernel->user", "total"]
+
+
+def percentile(values, pct):
+    """Nearest-rank percentile of a sorted list"""
+    if not values:
+        return 0.0
+    index = min(len(values) - 1, int(len(values) * pct / 100.0))
+    return values[index]
+
+
+def load_traces(paths):
+    """Return ({(port, message): tx fields}, {(port, message): rx fields})"""
+    tx, rx = {}, {}
+    for path in paths:
+        with open(path) as f:
+            for row in csv.reader(f):
+                try:
+                    if len(row) == 8 and row[0] == "tx":
+                        tx[(row[2], row[3])] = (row[1], [int(v) for v in row[4:8]])
+                    elif len(row) == 6 and row[0] == "rx":
+                        rx[(row[2], row[3])] = (row[1], [int(v) for v in row[4:6]])
+                except ValueError:
+                    continue
+    return tx, rx
+
+
+def breakdown(tx_times, rx_times):
+    """Component latencies in microseconds, or None if a timestamp is missing"""
+    user_ns, sched_ns, sent_ns, _ack_ns = tx_times
+    rx_ns, recv_ns = rx_times
+    if not (user_ns and sched_ns and sent_ns and rx_ns and recv_ns):
+        return None
+    parts = [sched_ns - user_ns, sent_ns - sched_ns, rx_ns - sent_ns, recv_ns - rx_ns,
+             recv_ns - user_ns]
+    if min(parts) < 0:
+        return None
+    return [p / 1000.0 for p in parts]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Kernel timestamp latency breakdown")
+    parser.add_argument("traces", nargs="+", help="trace files written with --timestamps")
+    parser.add_argument("--csv", help="also write the summary to this CSV file")
+    args = parser.parse_args()
+
+    tx, rx = load_traces(args.traces)
+    per_transport = {}
+    unmatched = 0
+    for key, (transport, tx_times) in tx.items():
+        if key not in rx:
+            unmatched += 1
+            continue
+        parts = breakdown(tx_times, rx[key][1])
+        if parts is None:
+            unmatched += 1
+            continue
+        samples = per_transport.setdefault(transport, [[] for _ in COMPONENTS])
+        for i, value in enumerate(parts):
+            samples[i].append(value)
+
+    if not per_transport:
+        print(f"ERROR: no matching tx/rx samples ({len(tx)} tx, {len(rx)} rx lines)",
+              file=sys.stderr)
+        return 1
+
+    print("=" * 78)
+    print("MT25018 - Per-Message Latency Breakdown (SO_TIMESTAMPING)")
+    print("=" * 78)
+    print(f"{'Transport':<10} {'Component':<14} {'Samples':>8} {'p50 us':>10} "
+          f"{'p99 us':>10} {'avg us':>10} {'share':>7}")
+    print("-" * 78)
+
+    rows = []
+    for transport in sorted(per_transport):
+        samples = per_transport[transport]
+        total_avg = sum(samples[-1]) / len(samples[-1])
+        for name, values in zip(COMPONENTS, samples):
+            values.sort()
+            avg = sum(values) / len(values)
+            share = avg / total_avg * 100.0 if total_avg > 0 else 0.0
+            print(f"{transport:<10} {name:<14} {len(values):>8} {percentile(values, 50):>10.2f} "
+                  f"{percentile(values, 99):>10.2f} {avg:>10.2f} {share:>6.1f}%")
+            rows.append([transport, name, len(values), f"{percentile(values, 50):.3f}",
+                         f"{percentile(values, 99):.3f}", f"{avg:.3f}", f"{share:.1f}"])
+        print("-" * 78)
+    print(f"Unmatched or incomplete samples: {unmatched}")
+
+    if args.csv:
+        with open(args.csv, "w", newline="") as f:
+            writer = csv.writer(f)
+            writer.writerow(["Transport", "Component", "Samples", "P50_us", "P99_us",
+                             "Avg_us", "Share_pct"])
+            writer.writerows(rows)
+        print(f"Summary written to {args.csv}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
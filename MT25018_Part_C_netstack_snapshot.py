@@ -0,0 +1,207 @@
+#!/usr/bin/env python3
+"""
+MT25018 - Graduate Systems PA02
+Part C: Softirq and network-stack accounting of one run
+
+The in-process perf counters only see the server and client threads. A
+good part of a copy's cost runs in softirq context (NET_RX on the
+receiving path, NET_TX when a queue is kicked), often on behalf of the
+other process, so the runner snapshots the kernel's own counters around
+every run:
+
+  snapshot  Reads /proc/softirqs, per-CPU /proc/stat, /proc/interrupts,
+            /proc/net/snmp and /proc/net/netstat into a JSON file. Run it
+            with `ip netns exec NS` so the /proc/net files are the
+            namespace's own; the CPU counters are system-wide.
+  delta     Turns before/after snapshots of the server and client
+            namespaces into one JSON record for the aggregator.
+
+Softirq CPU time comes from the softirq column of /proc/stat (USER_HZ
+ticks), summed over the CPUs of the run (--cpus, all when empty). The
+kernel does not split that time by softirq type, so the NET_RX/NET_TX
+share is estimated from their share of the softirq counts.
+
+Usage:
+  ip netns exec server_ns python3 MT25018_Part_C_netstack_snapshot.py snapshot before.json
+  python3 MT25018_Part_C_netstack_snapshot.py delta [--cpus 0-3] \\
+      SERVER_BEFORE SERVER_AFTER CLIENT_BEFORE CLIENT_AFTER > netstack.json
+"""
+
+import argparse
+import json
+import os
+import sys
+
+SNMP_FIELDS = {
+    "Ip": ("InDiscards", "OutDiscards"),
+    "Tcp": ("InSegs", "OutSegs", "RetransSegs", "InErrs"),
+    "Udp": ("InDatagrams", "OutDatagrams", "InErrors", "RcvbufErrors", "SndbufErrors"),
+}
+NETSTAT_FIELDS = {
+    "TcpExt": ("ListenDrops", "TCPBacklogDrop", "TCPRcvQDrop", "TCPZeroWindowDrop",
+               "TCPOFODrop", "TCPLossProbes", "TCPTimeouts"),
+}
+# Counters that each mean a packet was dropped somewhere in the stack
+DROP_COUNTERS = ("Ip.InDiscards", "Ip.OutDiscards", "Tcp.InErrs", "Udp.InErrors",
+                 "Udp.SndbufErrors", "TcpExt.ListenDrops", "TcpExt.TCPBacklogDrop",
+                 "TcpExt.TCPRcvQDrop", "TcpExt.TCPZeroWindowDrop")
+
+
+def read_lines(path):
+    try:
+        with open(path) as f:
+            return f.read().splitlines()
+    except OSError as e:
+        print(f"Warning: could not read {path}: {e}", file=sys.stderr)
+        return []
+
+
+def read_softirqs():
+    """{type: [count per CPU]}"""
+    lines = read_lines("/proc/softirqs")
+    result = {}
+    for line in lines[1:]:
+        name, _, counts = line.partition(":")
+        result[name.strip()] = [int(c) for c in counts.split()]
+    return result
+
+
+def read_cpu_softirq_ticks():
+    """[softirq ticks per CPU] from /proc/stat"""
+    ticks = {}
+    for line in read_lines("/proc/stat"):
+        fields = line.split()
+        if fields and fields[0].startswith("cpu") and fields[0] != "cpu":
+            ticks[int(fields[0][3:])] = int(fields[7])
+    return [ticks.get(cpu, 0) for cpu in range(max(ticks) + 1)] if ticks else []
+
+
+def read_interrupts():
+    """[interrupts per CPU] summed over every IRQ line"""
+    lines = read_lines("/proc/interrupts")
+    if not lines:
+        return []
+    num_cpus = len(lines[0].split())
+    totals = [0] * num_cpus
+    for line in lines[1:]:
+        counts = line.partition(":")[2].split()[:num_cpus]
+        for cpu, count in enumerate(counts):
+            if count.isdigit():
+                totals[cpu] += int(count)
+    return totals
+
+
+def read_proc_net(path, wanted):
+    """Selected counters of a /proc/net/snmp style file (header/value line pairs)"""
+    result = {}
+    lines = read_lines(path)
+    for header, values in zip(lines[::2], lines[1::2]):
+        proto, _, names = header.partition(":")
+        if proto not in wanted:
+            continue
+        counters = dict(zip(names.split(), values.partition(":")[2].split()))
+        for name in wanted[proto]:
+            if name in counters:
+                result[f"{proto}.{name}"] = int(counters[name])
+    return result
+
+
+def snapshot(path):
+    record = {
+        "softirqs": read_softirqs(),
+        "softirq_ticks": read_cpu_softirq_ticks(),
+        "interrupts": read_interrupts(),
+        "net": {**read_proc_net("/proc/net/snmp", SNMP_FIELDS),
+                **read_proc_net("/proc/net/netstat", NETSTAT_FIELDS)},
+        "clock_ticks": os.sysconf("SC_CLK_TCK"),
+    }
+    with open(path, "w") as f:
+        json.dump(record, f)
+    return 0
+
+
+def parse_cpus(spec, num_cpus):
+    """taskset list ("0-3,6") to CPU indices; all CPUs when empty"""
+    if not spec:
+        return list(range(num_cpus))
+    cpus = set()
+    for part in spec.split(","):
+        first, _, last = part.partition("-")
+        cpus.update(range(int(first), int(last or first) + 1))
+    return sorted(cpu for cpu in cpus if cpu < num_cpus)
+
+
+def cpu_delta(before, after, cpus):
+    return sum(after[cpu] - before[cpu] for cpu in cpus
+               if cpu < len(before) and cpu < len(after))
+
+
+def net_delta(before, after):
+    return {name: after[name] - before.get(name, 0) for name in after}
+
+
+def load(path):
+    try:
+        with open(path) as f:
+            return json.load(f)
+    except (OSError, ValueError) as e:
+        print(f"Warning: could not read {path}: {e}", file=sys.stderr)
+        return None
+
+
+def delta(args):
+    snaps = [load(p) for p in (args.server_before, args.server_after,
+                               args.client_before, args.client_after)]
+    if any(s is None for s in snaps):
+        return 1
+    server_before, server_after, client_before, client_after = snaps
+
+    # CPU counters are system-wide: the server namespace's pair covers the run
+    cpus = parse_cpus(args.cpus, len(server_after["softirq_ticks"]))
+    softirqs = {name: cpu_delta(server_before["softirqs"].get(name, []), counts, cpus)
+                for name, counts in server_after["softirqs"].items()}
+    total_softirqs = sum(softirqs.values())
+    net_softirqs = softirqs.get("NET_RX", 0) + softirqs.get("NET_TX", 0)
+    softirq_sec = (cpu_delta(server_before["softirq_ticks"], server_after["softirq_ticks"], cpus)
+                   / server_after["clock_ticks"])
+
+    server = net_delta(server_before["net"], server_after["net"])
+    client = net_delta(client_before["net"], client_after["net"])
+    record = {
+        "softirq_sec": softirq_sec,
+        "net_softirq_sec_est": (softirq_sec * net_softirqs / total_softirqs
+                                if total_softirqs else 0.0),
+        "net_rx_softirqs": softirqs.get("NET_RX", 0),
+        "net_tx_softirqs": softirqs.get("NET_TX", 0),
+        "interrupts": cpu_delta(server_before["interrupts"], server_after["interrupts"], cpus),
+        "server_out_segs": server.get("Tcp.OutSegs", 0) + server.get("Udp.OutDatagrams", 0),
+        "client_in_segs": client.get("Tcp.InSegs", 0) + client.get("Udp.InDatagrams", 0),
+        "retrans_segs": server.get("Tcp.RetransSegs", 0) + client.get("Tcp.RetransSegs", 0),
+        "drops": sum(side.get(name, 0) for side in (server, client) for name in DROP_COUNTERS),
+        "server_net": server,
+        "client_net": client,
+    }
+    print(json.dumps(record))
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Softirq and network-stack counters of a run")
+    sub = parser.add_subparsers(dest="command", required=True)
+    snap = sub.add_parser("snapshot", help="write the current counters to a JSON file")
+    snap.add_argument("output")
+    dlt = sub.add_parser("delta", help="JSON record of the counters' change over a run")
+    dlt.add_argument("--cpus", default="", help="CPU list of the run (taskset format)")
+    dlt.add_argument("server_before")
+    dlt.add_argument("server_after")
+    dlt.add_argument("client_before")
+    dlt.add_argument("client_after")
+    args = parser.parse_args()
+
+    if args.command == "snapshot":
+        return snapshot(args.output)
+    return delta(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
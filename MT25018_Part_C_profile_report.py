@@ -0,0 +1,239 @@
+#!/usr/bin/env python3
+"""
+MT25018 - Graduate Systems PA02
+Part C: Call-graph profiles of the profiling pass (-c in the runner)
+
+  fold     Reads `perf script` output (perf record -g) on stdin and prints
+           one folded stack per line, root first: "comm;f1;f2;leaf COUNT".
+           Kernel frames get a _[k] suffix.
+  report   Merges folded files of one configuration and side (server or
+           client), renders a flame graph SVG and appends the top kernel
+           and user symbols to a CSV: self share (samples with the symbol
+           as the leaf) and inclusive share (samples with it anywhere on
+           the stack).
+
+Needs no FlameGraph checkout; the SVG is drawn here.
+
+Usage:
+  perf script -i perf.data | python3 MT25018_Part_C_profile_report.py fold > stacks.folded
+  python3 MT25018_Part_C_profile_report.py report --name TwoCopy --size 65536 --threads 4 \\
+      --side server --svg server.svg --csv MT25018_Part_C_Profile_Symbols.csv FOLDED [FOLDED ...]
+"""
+
+import argparse
+import csv
+import html
+import os
+import re
+import sys
+import zlib
+
+FRAME_RE = re.compile(r"^\s*([0-9a-fA-F]+)\s+(.*?)\s+\((.*)\)\s*$")
+USER_PSEUDO_DSOS = ("[unknown]", "[vdso]", "[vsyscall]", "[heap]", "[stack]", "[anon]")
+KERNEL_SUFFIX = "_[k]"
+CSV_FIELDS = ["Implementation", "MessageSize", "ThreadCount", "Side", "Space", "Rank",
+              "Symbol", "Self_Pct", "Inclusive_Pct", "Self_Samples"]
+
+SVG_WIDTH = 1200
+FRAME_HEIGHT = 16
+FONT_SIZE = 12
+CHAR_WIDTH = 7.0
+
+
+def is_kernel(dso):
+    return dso.startswith("[") and dso not in USER_PSEUDO_DSOS
+
+
+def clean_symbol(symbol, dso):
+    symbol = re.sub(r"\+0x[0-9a-fA-F]+$", "", symbol)
+    if symbol == "[unknown]":
+        symbol = f"[{os.path.basename(dso)}]" if dso and dso not in USER_PSEUDO_DSOS else symbol
+    return symbol.replace(";", ":")
+
+
+def fold(lines):
+    """Folded stack -> sample count"""
+    stacks = {}
+    comm, frames = None, []
+
+    def flush():
+        if comm is not None and frames:
+            key = ";".join([comm] + frames[::-1])
+            stacks[key] = stacks.get(key, 0) + 1
+
+    for line in lines:
+        line = line.rstrip("\n")
+        if not line.strip():
+            flush()
+            comm, frames = None, []
+        elif not line[0].isspace():
+            flush()
+            comm, frames = line.split()[0].replace(";", ":"), []
+        elif comm is not None:
+            m = FRAME_RE.match(line)
+            if not m:
+                continue
+            _, symbol, dso = m.groups()
+            name = clean_symbol(symbol, dso)
+            frames.append(name + KERNEL_SUFFIX if is_kernel(dso) else name)
+    flush()
+    return stacks
+
+
+def load_folded(paths):
+    stacks = {}
+    for path in paths:
+        try:
+            with open(path) as f:
+                for line in f:
+                    stack, _, count = line.rstrip("\n").rpartition(" ")
+                    if stack and count.isdigit():
+                        stacks[stack] = stacks.get(stack, 0) + int(count)
+        except OSError as e:
+            print(f"Warning: could not read {path}: {e}", file=sys.stderr)
+    return stacks
+
+
+def top_symbols(stacks):
+    """Per symbol: (self samples, inclusive samples); total samples"""
+    self_counts, incl_counts, total = {}, {}, 0
+    for stack, count in stacks.items():
+        frames = stack.split(";")[1:]   # without the comm root
+        total += count
+        if not frames:
+            continue
+        self_counts[frames[-1]] = self_counts.get(frames[-1], 0) + count
+        for frame in set(frames):
+            incl_counts[frame] = incl_counts.get(frame, 0) + count
+    return self_counts, incl_counts, total
+
+
+def build_tree(stacks):
+    root = {"name": "all", "value": 0, "children": {}}
+    for stack, count in stacks.items():
+        root["value"] += count
+        node = root
+        for frame in stack.split(";"):
+            child = node["children"].setdefault(frame, {"name": frame, "value": 0, "children": {}})
+            child["value"] += count
+            node = child
+    return root
+
+
+def tree_depth(node):
+    return 1 + max((tree_depth(c) for c in node["children"].values()), default=0)
+
+
+def frame_color(name):
+    """Flame graph palette: kernel frames orange, user frames red to yellow"""
+    h = zlib.crc32(name.encode()) & 0xffff
+    if name.endswith(KERNEL_SUFFIX):
+        return f"rgb({200 + h % 55},{110 + (h >> 8) % 60},{20 + h % 40})"
+    return f"rgb({205 + h % 50},{(h >> 4) % 200},{(h >> 8) % 55})"
+
+
+def render_svg(stacks, title, path):
+    root = build_tree(stacks)
+    total = root["value"]
+    depth = tree_depth(root)
+    height = (depth + 2) * FRAME_HEIGHT + 20
+    scale = SVG_WIDTH / total if total else 0.0
+    out = [f'<svg xmlns="http://www.w3.org/2000/svg" width="{SVG_WIDTH}" height="{height}" '
+           f'font-family="Verdana" font-size="{FONT_SIZE}">',
+           f'<rect width="100%" height="100%" fill="#f8f8f8"/>',
+           f'<text x="{SVG_WIDTH / 2}" y="{FRAME_HEIGHT}" text-anchor="middle">'
+           f'{html.escape(title)} ({total} samples)</text>']
+
+    def draw(node, x, level):
+        width = node["value"] * scale
+        if width < 0.1:
+            return
+        y = height - (level + 1) * FRAME_HEIGHT
+        pct = 100.0 * node["value"] / total
+        name = html.escape(node["name"])
+        out.append(f'<g><title>{name} ({node["value"]} samples, {pct:.2f}%)</title>'
+                   f'<rect x="{x:.2f}" y="{y}" width="{width:.2f}" height="{FRAME_HEIGHT - 1}" '
+                   f'fill="{frame_color(node["name"])}" rx="2"/>')
+        chars = int((width - 6) / CHAR_WIDTH)
+        if chars >= 3:
+            label = node["name"] if len(node["name"]) <= chars else node["name"][:chars - 2] + ".."
+            out.append(f'<text x="{x + 3:.2f}" y="{y + FRAME_HEIGHT - 4}">{html.escape(label)}</text>')
+        out.append("</g>")
+        child_x = x
+        for child in sorted(node["children"].values(), key=lambda c: c["name"]):
+            draw(child, child_x, level + 1)
+            child_x += child["value"] * scale
+
+    if total:
+        draw(root, 0.0, 0)
+    out.append("</svg>")
+    with open(path, "w") as f:
+        f.write("\n".join(out) + "\n")
+
+
+def report(args):
+    stacks = load_folded(args.folded)
+    self_counts, incl_counts, total = top_symbols(stacks)
+    if total == 0:
+        print(f"No samples for {args.name} {args.side}", file=sys.stderr)
+        return 1
+    if args.svg:
+        os.makedirs(os.path.dirname(args.svg) or ".", exist_ok=True)
+        render_svg(stacks, f"{args.name} {args.side}, {args.size}B x {args.threads}", args.svg)
+
+    rows = []
+    for space in ("kernel", "user"):
+        # Ranked by self share, then inclusive share (tcp_sendmsg is mostly callees)
+        symbols = [s for s in incl_counts if s.endswith(KERNEL_SUFFIX) == (space == "kernel")]
+        symbols.sort(key=lambda s: (-self_counts.get(s, 0), -incl_counts[s], s))
+        for rank, symbol in enumerate(symbols[:args.top], 1):
+            rows.append({
+                "Implementation": args.name,
+                "MessageSize": args.size,
+                "ThreadCount": args.threads,
+                "Side": args.side,
+                "Space": space,
+                "Rank": rank,
+                "Symbol": symbol[:-len(KERNEL_SUFFIX)] if space == "kernel" else symbol,
+                "Self_Pct": round(100.0 * self_counts.get(symbol, 0) / total, 2),
+                "Inclusive_Pct": round(100.0 * incl_counts[symbol] / total, 2),
+                "Self_Samples": self_counts.get(symbol, 0),
+            })
+
+    if args.csv:
+        new_file = not os.path.exists(args.csv) or os.path.getsize(args.csv) == 0
+        with open(args.csv, "a", newline="") as f:
+            writer = csv.DictWriter(f, fieldnames=CSV_FIELDS)
+            if new_file:
+                writer.writeheader()
+            writer.writerows(rows)
+    for row in rows[:3]:
+        print(f"    {args.side} {row['Space']}: {row['Symbol']} {row['Self_Pct']}% self, "
+              f"{row['Inclusive_Pct']}% inclusive")
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Fold perf call graphs into flame graphs")
+    sub = parser.add_subparsers(dest="command", required=True)
+    sub.add_parser("fold", help="perf script output on stdin to folded stacks on stdout")
+    rep = sub.add_parser("report", help="flame graph SVG and top symbols of folded stacks")
+    rep.add_argument("--name", required=True, help="configuration (Implementation column)")
+    rep.add_argument("--size", type=int, required=True)
+    rep.add_argument("--threads", type=int, required=True)
+    rep.add_argument("--side", choices=("server", "client"), required=True)
+    rep.add_argument("--svg", help="flame graph output")
+    rep.add_argument("--csv", help="append the top symbols to this CSV")
+    rep.add_argument("--top", type=int, default=15, help="symbols per space (default 15)")
+    rep.add_argument("folded", nargs="+")
+    args = parser.parse_args()
+
+    if args.command == "fold":
+        for stack, count in sorted(fold(sys.stdin).items()):
+            print(f"{stack} {count}")
+        return 0
+    return report(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,384 @@
+#!/usr/bin/env python3
+"""
+MT25018 - Graduate Systems PA02
+Part C: Performance regression gate
+
+Compares freshly measured metrics CSVs against the committed baseline
+CSVs (MT25018_Part_C_{Throughput,Latency,Perf}_Metrics.csv) for every
+configuration present in the current run. Three metrics are gated:
+  - throughput (higher is better)
+  - tail latency, p99 (lower is better)
+  - server cycles per byte (lower is better)
+
+A configuration regresses on a metric only if the change is both larger
+than the tolerance AND statistically significant (one-sided t-test,
+p < alpha). Welch's test is used when both sides carry repeat/CI columns;
+a one-sample test against the baseline value when only the current run
+has repeats. The current run needs at least 2 repeats; a change beyond the
+tolerance without variance on either side cannot be tested and is
+reported as UNTESTABLE, which fails the gate.
+
+Baselines older than the cycles-per-byte column only have whole-process
+`perf stat` cycles (CPU_Cycles), while current runs count the send loops
+in-process. Their cycles/byte (CPU_Cycles / TotalBytes) is shown for
+reference but reported as NOT-GATED, since the two are not the same
+quantity. Baselines without p99 are gated on average latency, and those
+rows say so.
+
+Missing data fails the gate: a baseline configuration within --sizes and
+--threads that the current run did not produce, and a gated metric the
+baseline has but the current run reports as absent or zero.
+
+Usage:
+  python3 MT25018_Part_C_regression_gate.py --current-dir DIR [--baseline-dir .]
+      [--sizes 4096,65536] [--threads 1,4]
+      [--alpha 0.05] [--throughput-tol 5] [--latency-tol 10] [--cpb-tol 5]
+
+Exit status is 1 if any configuration regressed, is missing or is
+untestable, and 2 if the current run has fewer than 2 repeats.
+"""
+
+import argparse
+import csv
+import math
+import os
+import sys
+
+THROUGHPUT_CSV = "MT25018_Part_C_Throughput_Metrics.csv"
+LATENCY_CSV = "MT25018_Part_C_Latency_Metrics.csv"
+PERF_CSV = "MT25018_Part_C_Perf_Metrics.csv"
+
+# Two-sided 95% Student t critical values (same table as the aggregator),
+# used to turn CI95 half-widths back into standard deviations
+T_CRITICAL_95 = [
+    0.0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262,
+    2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093,
+    2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+]
+
+
+# ============================================================================
+# Student t distribution (no scipy dependency)
+# ============================================================================
+
+def betacf(a, b, x):
+    """Continued fraction for the incomplete beta function"""
+    tiny = 1e-30
+    qab, qap, qam = a + b, a + 1.0, a - 1.0
+    c, d = 1.0, 1.0 - qab * x / qap
+    d = 1.0 / (d if abs(d) > tiny else tiny)
+    h = d
+    for m in range(1, 201):
+        m2 = 2 * m
+        aa = m * (b - m) * x / ((qam + m2) * (a + m2))
+        d = 1.0 + aa * d
+        d = 1.0 / (d if abs(d) > tiny else tiny)
+        c = 1.0 + aa / c
+        c = c if abs(c) > tiny else tiny
+        h *= d * c
+        aa = -(a + m) * (qab + m) * x / ((a + m2) * (qap + m2))
+        d = 1.0 + aa * d
+        d = 1.0 / (d if abs(d) > tiny else tiny)
+        c = 1.0 + aa / c
+        c = c if abs(c) > tiny else tiny
+        delta = d * c
+        h *= delta
+        if abs(delta - 1.0) < 1e-12:
+            break
+    return h
+
+
+def betainc(a, b, x):
+    """Regularized incomplete beta I_x(a, b)"""
+    if x <= 0.0:
+        return 0.0
+    if x >= 1.0:
+        return 1.0
+    lbeta = math.lgamma(a + b) - math.lgamma(a) - math.lgamma(b)
+    front = math.exp(lbeta + a * math.log(x) + b * math.log(1.0 - x))
+    if x < (a + 1.0) / (a + b + 2.0):
+        return front * betacf(a, b, x) / a
+    return 1.0 - front * betacf(b, a, 1.0 - x) / b
+
+
+def t_sf(t, df):
+    """P(T > t) for Student t with df degrees of freedom"""
+    x = df / (df + t * t)
+    tail = 0.5 * betainc(df / 2.0, 0.5, x)
+    return tail if t > 0 else 1.0 - tail
+
+
+# ============================================================================
+# Loading
+# ============================================================================
+
+def to_float(value, default=0.0):
+    try:
+        return float(value)
+    except (TypeError, ValueError):
+        return default
+
+
+def load_csv(directory, name):
+    """Rows keyed by (Implementation, MessageSize, ThreadCount)"""
+    path = os.path.join(directory, name)
+    rows = {}
+    if not os.path.exists(path):
+        return rows
+    with open(path) as f:
+        for row in csv.DictReader(f):
+            key = (row["Implementation"], int(row["MessageSize"]), int(row["ThreadCount"]))
+            rows[key] = row
+    return rows
+
+
+class Sample:
+    """Mean, standard deviation and count of one metric for one configuration"""
+
+    def __init__(self, mean, ci95=0.0, n=1):
+        self.mean = mean
+        self.n = max(int(n), 1)
+        if self.n >= 2 and ci95 > 0:
+            t = T_CRITICAL_95[self.n - 1] if self.n - 1 < len(T_CRITICAL_95) else 1.960
+            self.std = ci95 * math.sqrt(self.n) / t
+        else:
+            self.std = 0.0
+
+    def has_variance(self):
+        return self.n >= 2 and self.std > 0
+
+    def scaled(self, factor):
+        result = Sample(self.mean * factor, 0.0, self.n)
+        result.std = self.std * factor
+        return result
+
+
+def extract_samples(directory):
+    """Per configuration: {metric: Sample} from the three CSVs of a directory
+
+    "legacy" marks rows from CSVs written before throughput was summed over
+    all clients (no Clients column): those measured only the first client,
+    so they are compared through throughput_per_client.
+    """
+    throughput = load_csv(directory, THROUGHPUT_CSV)
+    latency = load_csv(directory, LATENCY_CSV)
+    perf = load_csv(directory, PERF_CSV)
+
+    samples = {}
+    for key, row in throughput.items():
+        n = to_float(row.get("Repeats"), 1)
+        legacy = "Clients" not in row
+        clients = 1 if legacy else (to_float(row.get("Clients"), key[2]) or 1)
+
+        total = Sample(to_float(row["Throughput_Gbps"]),
+                       to_float(row.get("Throughput_CI95_Gbps")), n)
+        metrics = {
+            "legacy": legacy,
+            "throughput": total,
+            "throughput_per_client": total.scaled(1.0 / clients),
+        }
+
+        lat = latency.get(key)
+        if lat is not None:
+            metrics["avg_latency"] = Sample(to_float(lat["Latency_us"]),
+                                            to_float(lat.get("Latency_CI95_us")), n)
+            if "P99_us" in lat:
+                metrics["p99_latency"] = Sample(to_float(lat["P99_us"]),
+                                                to_float(lat.get("P99_CI95_us")), n)
+
+        p = perf.get(key)
+        if p is not None and "CyclesPerByte" in p:
+            metrics["cycles_per_byte"] = Sample(to_float(p["CyclesPerByte"]),
+                                                to_float(p.get("CyclesPerByte_CI95")), n)
+        elif p is not None and to_float(p.get("CPU_Cycles")) > 0:
+            # Server cycles cover every client; legacy TotalBytes only the first.
+            # Whole-process perf stat cycles: for reference, not gated
+            total_bytes = to_float(row.get("TotalBytes")) * (key[2] if legacy else 1)
+            if total_bytes > 0:
+                metrics["cycles_per_byte"] = Sample(to_float(p["CPU_Cycles"]) / total_bytes)
+                metrics["cycles_per_byte_derived"] = True
+
+        samples[key] = metrics
+    return samples
+
+
+# ============================================================================
+# Comparison
+# ============================================================================
+
+def regression_p_value(baseline, current, higher_is_better):
+    """One-sided p-value that current is worse than baseline (None if untestable)"""
+    diff = current.mean - baseline.mean
+    if higher_is_better:
+        diff = -diff
+
+    if baseline.has_variance() and current.has_variance():
+        # Welch's t-test from summary statistics
+        vb = baseline.std ** 2 / baseline.n
+        vc = current.std ** 2 / current.n
+        se = math.sqrt(vb + vc)
+        df = (vb + vc) ** 2 / (vb ** 2 / (baseline.n - 1) + vc ** 2 / (current.n - 1))
+    elif current.has_variance():
+        # One-sample t-test against the baseline value
+        se = current.std / math.sqrt(current.n)
+        df = current.n - 1
+    elif baseline.has_variance():
+        se = baseline.std / math.sqrt(baseline.n)
+        df = baseline.n - 1
+    else:
+        return None
+
+    if se == 0:
+        return 0.0 if diff > 0 else 1.0
+    return t_sf(diff / se, df)
+
+
+def compare_metric(baseline, current, higher_is_better, tolerance_pct, alpha):
+    """Return (verdict, change_pct, p_value, note)"""
+    if baseline.mean == 0:
+        return "NO-DATA", 0.0, None, "not in baseline"
+    if current.mean == 0:
+        return "MISSING", 0.0, None, "no current data"
+
+    change_pct = (current.mean - baseline.mean) / baseline.mean * 100.0
+    worse_pct = -change_pct if higher_is_better else change_pct
+    p_value = regression_p_value(baseline, current, higher_is_better)
+
+    if p_value is None:
+        if worse_pct > tolerance_pct:
+            return "UNTESTABLE", change_pct, None, "no variance"
+        return "OK", change_pct, None, "no variance"
+
+    note = ""
+    if worse_pct > tolerance_pct and p_value < alpha:
+        return "REGRESSED", change_pct, p_value, note
+    if worse_pct < -tolerance_pct and 1.0 - p_value < alpha:
+        return "IMPROVED", change_pct, p_value, note
+    return "OK", change_pct, p_value, note
+
+
+def parse_int_list(text):
+    return [int(v) for v in text.split(",") if v]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="MT25018 performance regression gate")
+    parser.add_argument("--baseline-dir", default=".", help="directory with baseline CSVs")
+    parser.add_argument("--current-dir", required=True, help="directory with current CSVs")
+    parser.add_argument("--alpha", type=float, default=0.05, help="significance level")
+    parser.add_argument("--throughput-tol", type=float, default=5.0,
+                        help="allowed throughput drop in percent")
+    parser.add_argument("--latency-tol", type=float, default=10.0,
+                        help="allowed tail latency increase in percent")
+    parser.add_argument("--cpb-tol", type=float, default=5.0,
+                        help="allowed cycles-per-byte increase in percent")
+    parser.add_argument("--sizes", type=parse_int_list, default=None,
+                        help="message sizes the current run covers (default: all)")
+    parser.add_argument("--threads", type=parse_int_list, default=None,
+                        help="thread counts the current run covers (default: all)")
+    args = parser.parse_args()
+
+    baseline = extract_samples(args.baseline_dir)
+    current = extract_samples(args.current_dir)
+    if not current:
+        print(f"ERROR: no current results in {args.current_dir}", file=sys.stderr)
+        return 2
+    few = sorted(key for key, m in current.items() if m["throughput"].n < 2)
+    if few:
+        impl, size, threads = few[0]
+        print(f"ERROR: {len(few)} current configuration(s) have fewer than 2 repeats "
+              f"(e.g. {impl} {size}B x{threads}); rerun with -n 2 or more", file=sys.stderr)
+        return 2
+
+    print("=" * 100)
+    print("MT25018 - Performance Regression Gate")
+    print(f"Baseline: {args.baseline_dir}   Current: {args.current_dir}   alpha={args.alpha}")
+    print("=" * 100)
+    print(f"{'Configuration':<26} {'Metric':<20} {'Baseline':>11} {'Current':>11} "
+          f"{'Change':>8} {'p-value':>8}  Verdict")
+    print("-" * 100)
+
+    regressions = []
+    missing = []
+    untestable = []
+    not_gated = False
+    expected = [key for key in baseline
+                if (args.sizes is None or key[1] in args.sizes)
+                and (args.threads is None or key[2] in args.threads)]
+    for key in sorted(set(current) | set(expected)):
+        impl, size, threads = key
+        config = f"{impl} {size}B x{threads}"
+        if key not in current:
+            print(f"{config:<26} MISSING (no current results)")
+            missing.append(f"{config}: no current results")
+            continue
+        if key not in baseline:
+            print(f"{config:<26} (not in baseline)")
+            continue
+
+        # Pick the metric variants the baseline can be compared on
+        base = baseline[key]
+        gated = [
+            # (metric, label, higher_is_better, tolerance)
+            ("throughput_per_client", "Thrpt/client (Gbps)", True, args.throughput_tol)
+            if base["legacy"] else
+            ("throughput", "Throughput (Gbps)", True, args.throughput_tol),
+            ("p99_latency", "p99 latency (us)", False, args.latency_tol)
+            if "p99_latency" in base else
+            ("avg_latency", "Avg latency (us)*", False, args.latency_tol),
+            ("cycles_per_byte", "Cycles/byte", False, args.cpb_tol),
+        ]
+
+        for metric, label, higher_is_better, tolerance in gated:
+            b = base.get(metric)
+            c = current[key].get(metric)
+            if b is None:
+                print(f"{config:<26} {label:<20} {'-':>11} {'-':>11} {'':>8} {'-':>8}  "
+                      f"NO-DATA (missing in baseline)")
+                continue
+            if metric == "cycles_per_byte" and base.get("cycles_per_byte_derived"):
+                # Reported for reference only (see the ** footnote)
+                current_text = f"{c.mean:>11.3f}" if c is not None else f"{'-':>11}"
+                change_text = (f"{(c.mean - b.mean) / b.mean * 100.0:>+7.1f}%"
+                               if c is not None and b.mean else f"{'':>8}")
+                print(f"{config:<26} {label + '**':<20} {b.mean:>11.3f} {current_text} "
+                      f"{change_text} {'-':>8}  NOT-GATED")
+                not_gated = True
+                continue
+            if c is None:
+                print(f"{config:<26} {label:<20} {b.mean:>11.3f} {'-':>11} {'':>8} {'-':>8}  "
+                      f"MISSING (missing in current)")
+                missing.append(f"{config}: {label} missing")
+                continue
+
+            verdict, change_pct, p_value, note = compare_metric(
+                b, c, higher_is_better, tolerance, args.alpha)
+            p_text = f"{p_value:.3f}" if p_value is not None else "-"
+            suffix = f" ({note})" if note else ""
+            print(f"{config:<26} {label:<20} {b.mean:>11.3f} {c.mean:>11.3f} "
+                  f"{change_pct:>+7.1f}% {p_text:>8}  {verdict}{suffix}")
+            if verdict == "REGRESSED":
+                regressions.append(f"{config}: {label} {change_pct:+.1f}%")
+            elif verdict == "MISSING":
+                missing.append(f"{config}: {label} {note}")
+            elif verdict == "UNTESTABLE":
+                untestable.append(f"{config}: {label} {change_pct:+.1f}% without variance")
+
+    print("-" * 100)
+    if any(not baseline[key].get("p99_latency") for key in current if key in baseline):
+        print("* baseline has no p99 column: tail latency is gated on average latency")
+    if not_gated:
+        print("** baseline cycles/byte is whole-process perf stat (CPU_Cycles / TotalBytes), "
+              "current is in-process send-loop counters: not comparable, not gated")
+    if regressions or missing or untestable:
+        print(f"FAIL: {len(regressions)} regression(s), {len(missing)} missing, "
+              f"{len(untestable)} untestable")
+        for r in regressions + missing + untestable:
+            print(f"  - {r}")
+        return 1
+    print("PASS: no significant regressions")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -2,15 +2,78 @@
 # MT25018 - Graduate Systems PA02
 # Part C: Automated Experiment Script
 # Runs experiments across message sizes and thread counts
-# Collects perf stats and application-level metrics
+# Collects in-process hardware counters and application-level metrics
 # USES SEPARATE NETWORK NAMESPACES FOR CLIENT AND SERVER
+#
+# Sweep engine:
+#   - every configuration is repeated N times (-n) and reported as the mean
+#     with a 95% confidence interval
+#   - up to J configurations run at once (-j), each in its own namespace
+#     pair on a disjoint CPU set
+#   - every completed run is cached under $CACHE_DIR, keyed by the binary
+#     hashes and parameters, so an interrupted sweep resumes where it
+#     stopped and unchanged binaries are never re-measured (-f to discard)
+#   - -g runs a quick subset of the matrix into $OUTPUT_DIR/regression and
+#     gates it against the committed CSVs (MT25018_Part_C_regression_gate.py)
+#   - -r adds client receive strategies as a matrix dimension; rows of a
+#     non-native strategy are named Implementation-strategy
+#   - -i samples TCP_INFO of every server connection each MS milliseconds
+#     and collects the per-connection time series into one CSV
+#   - -w excludes a warm-up phase from every client's measurement and -s
+#     reports only each client's automatically detected steady window
+#   - -p adds WAN emulation profiles (tc netem delay/jitter/loss plus a tbf
+#     rate limit on both veth ends) as a matrix dimension; rows of a
+#     non-ideal profile are named Implementation@profile
+#   - -u adds the UDP transport (Part A4: sendmmsg/recvmmsg with GSO/GRO)
+#     as an implementation; it runs with the native receive path only
+#   - -m adds MPTCP path counts as a matrix dimension: each slot gets one
+#     veth pair per path and the server announces the extra addresses as
+#     MPTCP endpoints; rows over N paths are named Implementation+mptcpN
+#     (TCP copy transports only: SO_ZEROCOPY fails on MPTCP sockets)
+#   - -q adds server scheduling modes (fair turns of a shared worker pool,
+#     MT25018_Common_FairSched.h) as a matrix dimension; rows of wrr/drr
+#     are named Implementation~mode. Every row reports Jain's fairness
+#     index over the per-client throughput
+#   - every run snapshots softirqs, interrupts and the SNMP/netstat
+#     counters of both namespaces before and after the clients run
+#     (MT25018_Part_C_netstack_snapshot.py); softirq time, segments,
+#     retransmits and drops go to the perf metrics CSV
+#   - -c adds one call-graph profiling run per configuration (perf record
+#     -g on server and clients, never part of the reported metrics); its
+#     stacks become flame graphs in $OUTPUT_DIR/flamegraphs and the top
+#     kernel/user symbols a CSV (MT25018_Part_C_profile_report.py)
 
 set -e  # Exit on error
 
+usage() {
+    echo "Usage: sudo $0 [-j parallel_jobs] [-n repeats] [-d duration_sec] [-r strategies] [-i ms] [-w sec] [-s] [-p profiles] [-u] [-m paths] [-q modes] [-c] [-f] [-g]"
+    echo "  -j N  Run up to N configurations concurrently (default: 1)"
+    echo "  -n N  Repeat each configuration N times (default: 1)"
+    echo "  -d S  Client test duration in seconds (default: 10)"
+    echo "  -r L  Comma-separated client receive strategies (default: native):"
+    echo "        native, field, waitall, bulk, iovec, ring"
+    echo "  -i MS Sample TCP_INFO of every connection each MS milliseconds and write"
+    echo "        the per-connection time series next to the metrics CSVs"
+    echo "  -w S  Warm-up: clients receive for S seconds before measuring"
+    echo "  -s    Steady state: report only each client's steady window"
+    echo "  -p L  Comma-separated network profiles (default: ideal):"
+    echo "        ideal, datacenter, metro, cross-region, lossy"
+    echo "  -u    Also measure the UDP transport (Part A4)"
+    echo "  -m L  Comma-separated MPTCP path counts (default: 0 = plain TCP, max 8),"
+    echo "        e.g. 0,1,2,4; the UDP transport runs with 0 only"
+    echo "  -q L  Comma-separated server scheduling modes (default: none):"
+    echo "        none, wrr, drr; the UDP transport runs with none only"
+    echo "  -c    Call-graph profiling: one extra perf record -g run per configuration,"
+    echo "        folded into flame graphs and a top-symbol CSV (needs perf)"
+    echo "  -f    Fresh sweep: discard cached results first"
+    echo "  -g    Regression gate: run a quick subset (default 3 repeats of 5s) and"
+    echo "        compare against the committed metrics CSVs; exits 1 on regression"
+}
+
 # Check if running as root (required for namespaces)
 if [ "$EUID" -ne 0 ]; then
     echo "ERROR: This script must be run with sudo for network namespace support"
-    echo "Usage: sudo $0"
+    usage
     exit 1
 fi
 
@@ -19,18 +82,129 @@ SERVER_NS="server_ns"
 CLIENT_NS="client_ns"
 VETH_SRV="veth_srv"
 VETH_CLI="veth_cli"
-SRV_IP="10.1.1.1"
-CLI_IP="10.1.1.2"
-SERVER_IP="$SRV_IP"  # Server IP in namespace
-TEST_DURATION=10        # Duration for each client test in seconds
+TEST_DURATION=          # Duration for each client test in seconds (default 10)
 OUTPUT_DIR="experiment_results"
-PERF_EVENTS="cycles,instructions,cache-misses,L1-dcache-load-misses,LLC-load-misses,context-switches"
+CACHE_DIR="$OUTPUT_DIR/cache"
+PARALLEL_JOBS=1
+REPEATS=
+FRESH=0
+GATE=0
+RECV_STRATEGIES=(native)
+TCPINFO_MS=             # TCP_INFO sampling interval; empty disables sampling
+WARMUP=0                # Unmeasured client warm-up in seconds
+STEADY=0
+NET_PROFILES=(ideal)
+UDP=0
+MPTCP_PATHS=(0)         # 0 = plain TCP, N = MPTCP over N veth pairs
+SCHED_MODES=(none)      # none = thread per connection, wrr/drr = fair turns
+CALLGRAPH=0
+PERF_FREQ=999           # perf record sampling frequency (Hz) of the profiling runs
+NUM_CPUS=$(nproc)
+
+while getopts "j:n:d:r:i:w:sp:um:q:cfgh" opt; do
+    case $opt in
+        j) PARALLEL_JOBS=$OPTARG ;;
+        n) REPEATS=$OPTARG ;;
+        d) TEST_DURATION=$OPTARG ;;
+        r) IFS=',' read -ra RECV_STRATEGIES <<< "$OPTARG" ;;
+        i) TCPINFO_MS=$OPTARG ;;
+        w) WARMUP=$OPTARG ;;
+        s) STEADY=1 ;;
+        p) IFS=',' read -ra NET_PROFILES <<< "$OPTARG" ;;
+        u) UDP=1 ;;
+        m) IFS=',' read -ra MPTCP_PATHS <<< "$OPTARG" ;;
+        q) IFS=',' read -ra SCHED_MODES <<< "$OPTARG" ;;
+        c) CALLGRAPH=1 ;;
+        f) FRESH=1 ;;
+        g) GATE=1 ;;
+        *) usage; exit 1 ;;
+    esac
+done
+
+# Each concurrent configuration needs at least one CPU of its own
+if [ "$PARALLEL_JOBS" -gt "$NUM_CPUS" ]; then
+    echo "Limiting parallel jobs to $NUM_CPUS (one disjoint CPU set per job)"
+    PARALLEL_JOBS=$NUM_CPUS
+fi
+
+if [ "$CALLGRAPH" -eq 1 ] && ! command -v perf > /dev/null; then
+    echo "ERROR: -c needs perf (linux-tools) on the PATH"
+    exit 1
+fi
 
 # Experiment parameters
 MESSAGE_SIZES=(512 4096 16384 65536)      # 512B, 4KB, 16KB, 64KB
 THREAD_COUNTS=(1 2 4 8)                    # Number of concurrent clients
 IMPLEMENTATIONS=("A1" "A2" "A3")
 IMPL_NAMES=("TwoCopy" "OneCopy" "ZeroCopy")
+if [ "$UDP" -eq 1 ]; then
+    IMPLEMENTATIONS+=("A4")
+    IMPL_NAMES+=("UDP")
+fi
+
+# WAN emulation profiles: netem arguments and tbf rate/burst applied to
+# each veth end, so the delay is one-way and the RTT is twice that.
+# netem orders its queue by each packet's own jittered send time, so
+# jitter alone reorders packets; with a rate, a packet is never sent
+# before the one queued ahead of it, so every jittered profile has one
+declare -A PROFILE_NETEM=(
+    [datacenter]="delay 25us 5us rate 25gbit"
+    [metro]="delay 1ms 100us rate 10gbit"
+    [cross-region]="delay 35ms 2ms distribution normal rate 1gbit"
+    [lossy]="delay 20ms 5ms loss 1% rate 100mbit"
+)
+declare -A PROFILE_RATE=(
+    [datacenter]="25gbit"
+    [metro]="10gbit"
+    [cross-region]="1gbit"
+    [lossy]="100mbit"
+)
+declare -A PROFILE_BURST=(
+    [datacenter]="4mb"
+    [metro]="2mb"
+    [cross-region]="512kb"
+    [lossy]="128kb"
+)
+for profile in "${NET_PROFILES[@]}"; do
+    if [ "$profile" != "ideal" ] && [ -z "${PROFILE_NETEM[$profile]}" ]; then
+        echo "ERROR: unknown network profile '$profile'"
+        usage
+        exit 1
+    fi
+done
+
+# Every slot gets as many veth pairs as the largest path count needs
+MAX_PATHS=1
+for paths in "${MPTCP_PATHS[@]}"; do
+    if ! [[ "$paths" =~ ^[0-9]+$ ]] || [ "$paths" -gt 8 ]; then
+        echo "ERROR: MPTCP path count must be 0-8, got '$paths'"
+        usage
+        exit 1
+    fi
+    if [ "$paths" -gt "$MAX_PATHS" ]; then
+        MAX_PATHS=$paths
+    fi
+done
+
+# Metrics CSVs go to the main directory; the regression gate measures a
+# quick subset into its own directory so the committed baseline is kept
+if [ "$GATE" -eq 1 ]; then
+    MESSAGE_SIZES=(4096 65536)
+    THREAD_COUNTS=(1 4)
+    REPEATS=${REPEATS:-3}
+    TEST_DURATION=${TEST_DURATION:-5}
+    RESULTS_DIR="$OUTPUT_DIR/regression"
+else
+    RESULTS_DIR="."
+fi
+REPEATS=${REPEATS:-1}
+TEST_DURATION=${TEST_DURATION:-10}
+THROUGHPUT_CSV="$RESULTS_DIR/MT25018_Part_C_Throughput_Metrics.csv"
+LATENCY_CSV="$RESULTS_DIR/MT25018_Part_C_Latency_Metrics.csv"
+PERF_CSV="$RESULTS_DIR/MT25018_Part_C_Perf_Metrics.csv"
+TCPINFO_CSV="$RESULTS_DIR/MT25018_Part_C_TcpInfo_TimeSeries.csv"
+SYMBOLS_CSV="$RESULTS_DIR/MT25018_Part_C_Profile_Symbols.csv"
+FLAMEGRAPH_DIR="$OUTPUT_DIR/flamegraphs"
 
 # Colors for output
 RED='\033[0;31m'
@@ -45,45 +219,181 @@ echo "WITH NETWORK NAMESPACE ISOLATION"
 echo "=========================================="
 echo ""
 
-# Function to setup network namespaces
+# Per-slot names: slot 0 keeps the original names and 10.1.1.0/24,
+# slot N uses server_nsN/veth_srvN/... and 10.1.(N+1).0/24
+slot_suffix() {
+    if [ "$1" -eq 0 ]; then echo ""; else echo "$1"; fi
+}
+slot_server_ns() { echo "${SERVER_NS}$(slot_suffix $1)"; }
+slot_client_ns() { echo "${CLIENT_NS}$(slot_suffix $1)"; }
+slot_veth_srv() { echo "${VETH_SRV}$(slot_suffix $1)"; }
+slot_veth_cli() { echo "${VETH_CLI}$(slot_suffix $1)"; }
+slot_srv_ip() { echo "10.1.$(($1 + 1)).1"; }
+slot_cli_ip() { echo "10.1.$(($1 + 1)).2"; }
+
+# Extra MPTCP paths: path K (1..7) of slot N is veth_srvNpK/veth_cliNpK
+# on 10.(K+1).(N+1).0/24; path 0 is the slot's main veth pair
+slot_path_srv() { if [ "$2" -eq 0 ]; then slot_veth_srv $1; else echo "$(slot_veth_srv $1)p$2"; fi; }
+slot_path_cli() { if [ "$2" -eq 0 ]; then slot_veth_cli $1; else echo "$(slot_veth_cli $1)p$2"; fi; }
+slot_path_srv_ip() { echo "10.$(($2 + 1)).$(($1 + 1)).1"; }
+slot_path_cli_ip() { echo "10.$(($2 + 1)).$(($1 + 1)).2"; }
+
+# CPU list for a slot's server or client side
+# Serial sweeps are not pinned. Parallel slots get disjoint CPU ranges,
+# split between server and client when a slot has two or more CPUs.
+slot_cpus() {
+    local slot=$1
+    local role=$2
+    
+    if [ "$PARALLEL_JOBS" -le 1 ]; then
+        echo ""
+        return
+    fi
+    
+    local per_slot=$((NUM_CPUS / PARALLEL_JOBS))
+    local first=$((slot * per_slot))
+    local last=$((first + per_slot - 1))
+    if [ $per_slot -ge 2 ]; then
+        local half=$((first + per_slot / 2))
+        if [ "$role" = "server" ]; then
+            last=$((half - 1))
+        else
+            first=$half
+        fi
+    fi
+    echo "${first}-${last}"
+}
+
+# Function to setup network namespaces for one slot
 setup_namespaces() {
-    echo "Setting up network namespaces..."
+    local slot=$1
+    local server_ns=$(slot_server_ns $slot)
+    local client_ns=$(slot_client_ns $slot)
+    local veth_srv=$(slot_veth_srv $slot)
+    local veth_cli=$(slot_veth_cli $slot)
+    local srv_ip=$(slot_srv_ip $slot)
+    local cli_ip=$(slot_cli_ip $slot)
+    
+    echo "Setting up network namespaces (slot $slot)..."
     
     # Delete existing namespaces if they exist
-    ip netns del $SERVER_NS 2>/dev/null || true
-    ip netns del $CLIENT_NS 2>/dev/null || true
+    ip netns del $server_ns 2>/dev/null || true
+    ip netns del $client_ns 2>/dev/null || true
     
     # Create namespaces
-    ip netns add $SERVER_NS
-    ip netns add $CLIENT_NS
+    ip netns add $server_ns
+    ip netns add $client_ns
     
     # Create veth pair
-    ip link add $VETH_SRV type veth peer name $VETH_CLI
+    ip link add $veth_srv type veth peer name $veth_cli
     
     # Move veth ends to namespaces
-    ip link set $VETH_SRV netns $SERVER_NS
-    ip link set $VETH_CLI netns $CLIENT_NS
+    ip link set $veth_srv netns $server_ns
+    ip link set $veth_cli netns $client_ns
     
     # Configure server namespace
-    ip netns exec $SERVER_NS ip addr add ${SRV_IP}/24 dev $VETH_SRV
-    ip netns exec $SERVER_NS ip link set $VETH_SRV up
-    ip netns exec $SERVER_NS ip link set lo up
+    ip netns exec $server_ns ip addr add ${srv_ip}/24 dev $veth_srv
+    ip netns exec $server_ns ip link set $veth_srv up
+    ip netns exec $server_ns ip link set lo up
     
     # Configure client namespace
-    ip netns exec $CLIENT_NS ip addr add ${CLI_IP}/24 dev $VETH_CLI
-    ip netns exec $CLIENT_NS ip link set $VETH_CLI up
-    ip netns exec $CLIENT_NS ip link set lo up
+    ip netns exec $client_ns ip addr add ${cli_ip}/24 dev $veth_cli
+    ip netns exec $client_ns ip link set $veth_cli up
+    ip netns exec $client_ns ip link set lo up
+    
+    # One more veth pair per extra MPTCP path, each on its own subnet
+    local path dev_srv dev_cli
+    for ((path=1; path<MAX_PATHS; path++)); do
+        dev_srv=$(slot_path_srv $slot $path)
+        dev_cli=$(slot_path_cli $slot $path)
+        ip link add $dev_srv type veth peer name $dev_cli
+        ip link set $dev_srv netns $server_ns
+        ip link set $dev_cli netns $client_ns
+        ip netns exec $server_ns ip addr add $(slot_path_srv_ip $slot $path)/24 dev $dev_srv
+        ip netns exec $server_ns ip link set $dev_srv up
+        ip netns exec $client_ns ip addr add $(slot_path_cli_ip $slot $path)/24 dev $dev_cli
+        ip netns exec $client_ns ip link set $dev_cli up
+    done
     
     echo -e "${GREEN}Network namespaces configured:${NC}"
-    echo "  Server namespace: $SERVER_NS ($SRV_IP)"
-    echo "  Client namespace: $CLIENT_NS ($CLI_IP)"
+    echo "  Server namespace: $server_ns ($srv_ip) cpus: $(slot_cpus $slot server)"
+    echo "  Client namespace: $client_ns ($cli_ip) cpus: $(slot_cpus $slot client)"
+    if [ $MAX_PATHS -gt 1 ]; then
+        echo "  MPTCP paths: $MAX_PATHS"
+    fi
 }
 
-# Function to cleanup network namespaces
+# Shape both veth ends of every path of a slot with a network profile
+# ("ideal" removes any shaping). netem delays, jitters and drops; a tbf
+# child limits the rate, so each MPTCP path gets the profile's rate.
+apply_profile() {
+    local slot=$1
+    local profile=$2
+    
+    local side path ns dev
+    for ((path=0; path<MAX_PATHS; path++)); do
+        for side in server client; do
+            if [ "$side" = "server" ]; then
+                ns=$(slot_server_ns $slot)
+                dev=$(slot_path_srv $slot $path)
+            else
+                ns=$(slot_client_ns $slot)
+                dev=$(slot_path_cli $slot $path)
+            fi
+            ip netns exec $ns tc qdisc del dev $dev root 2>/dev/null || true
+            if [ "$profile" = "ideal" ]; then
+                continue
+            fi
+            ip netns exec $ns tc qdisc add dev $dev root handle 1: netem \
+                ${PROFILE_NETEM[$profile]} limit 100000 || return 1
+            ip netns exec $ns tc qdisc add dev $dev parent 1:1 handle 10: tbf \
+                rate ${PROFILE_RATE[$profile]} burst ${PROFILE_BURST[$profile]} latency 200ms || return 1
+        done
+    done
+}
+
+# Configure the MPTCP path manager of a slot for a run over N paths: the
+# server announces the address of every extra path (signal endpoints) and
+# the client accepts them, opening one subflow per path
+apply_paths() {
+    local slot=$1
+    local paths=$2
+    local server_ns=$(slot_server_ns $slot)
+    local client_ns=$(slot_client_ns $slot)
+    
+    if [ $MAX_PATHS -le 1 ]; then
+        return 0
+    fi
+    ip netns exec $server_ns ip mptcp endpoint flush || return 1
+    local extra=$((paths > 1 ? paths - 1 : 0))
+    ip netns exec $server_ns ip mptcp limits set subflows $extra add_addr_accepted $extra || return 1
+    ip netns exec $client_ns ip mptcp limits set subflows $extra add_addr_accepted $extra || return 1
+    local path
+    for ((path=1; path<paths; path++)); do
+        ip netns exec $server_ns ip mptcp endpoint add $(slot_path_srv_ip $slot $path) \
+            dev $(slot_path_srv $slot $path) signal || return 1
+    done
+}
+
+# Function to cleanup network namespaces of every slot
 cleanup_namespaces() {
     echo "Cleaning up network namespaces..."
-    ip netns del $SERVER_NS 2>/dev/null || true
-    ip netns del $CLIENT_NS 2>/dev/null || true
+    for ((slot=0; slot<PARALLEL_JOBS; slot++)); do
+        ip netns del $(slot_server_ns $slot) 2>/dev/null || true
+        ip netns del $(slot_client_ns $slot) 2>/dev/null || true
+    done
+}
+
+# Stop running experiments and remove namespaces on Ctrl-C; completed
+# runs stay cached, so rerunning the script resumes the sweep
+on_interrupt() {
+    echo -e "\n${RED}Interrupted - stopping running experiments${NC}"
+    pkill -f "MT25018_Part_A" 2>/dev/null || true
+    kill $(jobs -p) 2>/dev/null || true
+    wait 2>/dev/null || true
+    cleanup_namespaces
+    echo "Completed runs are cached in $CACHE_DIR; rerun to resume."
+    exit 130
 }
 
 # Cleanup any previous server processes and namespaces
@@ -96,163 +406,533 @@ sleep 1
 mkdir -p "$OUTPUT_DIR"
 echo -e "${GREEN}Created output directory: $OUTPUT_DIR${NC}"
 
-# Compile all implementations
-echo -e "\n${YELLOW}Compiling all implementations...${NC}"
-make clean
-make all
+if [ "$FRESH" -eq 1 ]; then
+    echo "Discarding cached results in $CACHE_DIR"
+    rm -rf "$CACHE_DIR"
+fi
+mkdir -p "$CACHE_DIR"
+# Runs that were interrupted mid-way are never reused
+rm -rf "$CACHE_DIR"/*.partial
 
-if [ $? -ne 0 ]; then
+# Compile all implementations (make only rebuilds what changed)
+echo -e "\n${YELLOW}Compiling all implementations...${NC}"
+if ! make all; then
     echo -e "${RED}Compilation failed!${NC}"
     exit 1
 fi
 echo -e "${GREEN}Compilation successful!${NC}"
 
-# Setup network namespaces once for all experiments
-setup_namespaces
-
-# Initialize CSV files with headers (in main directory)
-echo "Implementation,MessageSize,ThreadCount,Throughput_Gbps,TotalBytes,TotalMessages,Duration_sec" > "MT25018_Part_C_Throughput_Metrics.csv"
-echo "Implementation,MessageSize,ThreadCount,Latency_us" > "MT25018_Part_C_Latency_Metrics.csv"
-echo "Implementation,MessageSize,ThreadCount,CPU_Cycles,CacheMisses,L1_Misses,LLC_Misses,ContextSwitches" > "MT25018_Part_C_Perf_Metrics.csv"
+# Fair scheduler workers for a run with N clients: one per server CPU of
+# a slot, but fewer than the clients so that turns actually queue
+sched_workers() {
+    local thread_count=$1
+    local cpus=$NUM_CPUS
+    if [ "$PARALLEL_JOBS" -gt 1 ]; then
+        cpus=$((NUM_CPUS / PARALLEL_JOBS))
+        if [ $cpus -ge 2 ]; then
+            cpus=$((cpus / 2))
+        fi
+    fi
+    if [ $cpus -ge "$thread_count" ]; then
+        cpus=$((thread_count - 1))
+    fi
+    echo $((cpus > 0 ? cpus : 1))
+}
 
-echo -e "\n${YELLOW}Starting experiments...${NC}"
-echo "This will take approximately $((${#MESSAGE_SIZES[@]} * ${#THREAD_COUNTS[@]} * ${#IMPLEMENTATIONS[@]} * ($TEST_DURATION + 5))) seconds"
-echo ""
+# Hash the binaries so cached results are invalidated by any rebuild
+declare -A BINARY_HASH
+for impl in "${IMPLEMENTATIONS[@]}"; do
+    BINARY_HASH[$impl]=$(cat "MT25018_Part_${impl}_Server" "MT25018_Part_${impl}_Client" | sha256sum | cut -c1-16)
+done
+# ... and by any change to the scripts whose output is cached with a run
+SCRIPT_HASH=$(cat MT25018_Part_C_aggregate_results.py MT25018_Part_C_netstack_snapshot.py \
+    MT25018_Part_C_profile_report.py | sha256sum | cut -c1-16)
 
-# Function to extract metric from perf output
-extract_perf_metric() {
-    local perf_file=$1
-    local metric_name=$2
+# Row name of an implementation measured with a client receive strategy,
+# network profile, MPTCP path count and server scheduling mode
+config_name() {
+    local impl_name=$1
+    local strategy=$2
+    local profile=$3
+    local paths=$4
+    local sched=$5
     
-    # For hybrid CPUs (cpu_atom/cpu_core), sum both values
-    local total=0
+    local name="$impl_name"
+    if [ "$strategy" != "native" ]; then
+        name="${name}-${strategy}"
+    fi
+    if [ "$profile" != "ideal" ]; then
+        name="${name}@${profile}"
+    fi
+    if [ "$paths" -gt 0 ]; then
+        name="${name}+mptcp${paths}"
+    fi
+    if [ "$sched" != "none" ]; then
+        name="${name}~${sched}"
+    fi
+    echo "$name"
+}
+
+# Cache key for one run: readable prefix plus a hash of everything that
+# affects the measurement, including how many jobs share the machine
+# (which sets each run's CPU set) and the scripts that produce result.json
+run_key() {
+    local impl=$1
+    local impl_name=$2
+    local msg_size=$3
+    local thread_count=$4
+    local rep=$5
+    local strategy=$6
+    local profile=$7
+    local paths=$8
+    local sched=$9
     
-    # Search for lines containing the metric name
-    while IFS= read -r line; do
-        # Skip lines that say "not supported"
-        if echo "$line" | grep -q "<not supported>"; then
-            continue
-        fi
-        
-        # Check if line contains the metric
-        if echo "$line" | grep -q "$metric_name"; then
-            # Extract the first number (remove commas and whitespace)
-            local value=$(echo "$line" | awk '{print $1}' | tr -d ',' | tr -d ' ')
-            
-            # Add to total if it's a valid number
-            if [[ "$value" =~ ^[0-9]+$ ]]; then
-                total=$((total + value))
-            fi
+    local params="impl=$impl size=$msg_size threads=$thread_count duration=$TEST_DURATION rep=$rep bin=${BINARY_HASH[$impl]}"
+    params="$params jobs=$PARALLEL_JOBS cpus=$NUM_CPUS scripts=$SCRIPT_HASH"
+    if [ "$strategy" != "native" ]; then
+        params="$params recv=$strategy"
+    fi
+    if [ "$profile" != "ideal" ]; then
+        params="$params profile=$profile netem=${PROFILE_NETEM[$profile]} rate=${PROFILE_RATE[$profile]}"
+    fi
+    if [ "$paths" -gt 0 ]; then
+        params="$params mptcp=$paths"
+    fi
+    if [ "$sched" != "none" ]; then
+        params="$params sched=$sched workers=$(sched_workers "$thread_count")"
+    fi
+    if [ -n "$TCPINFO_MS" ]; then
+        params="$params tcpinfo=$TCPINFO_MS"
+    fi
+    if [ "$WARMUP" -gt 0 ]; then
+        params="$params warmup=$WARMUP"
+    fi
+    if [ "$STEADY" -eq 1 ]; then
+        params="$params steady=1"
+    fi
+    local hash=$(echo "$params" | sha256sum | cut -c1-12)
+    echo "${impl_name}_${msg_size}_${thread_count}_r${rep}_${hash}"
+}
+
+# Assign the aggregator's name=value lines to the caller's variables of
+# the same name; names the caller has not declared are ignored
+read_metrics() {
+    local metric_name metric_value
+    while IFS='=' read -r metric_name metric_value; do
+        if [[ "$metric_name" =~ ^[a-z0-9_]+$ ]] && declare -p "$metric_name" > /dev/null 2>&1; then
+            printf -v "$metric_name" '%s' "$metric_value"
         fi
-    done < "$perf_file"
-    
-    echo "$total"
+    done < <(python3 MT25018_Part_C_aggregate_results.py --repeats "$@")
 }
 
-# Function to run a single experiment
+# Stop the server of the run in progress; run_experiment runs in its own
+# background subshell and installs this as its EXIT trap, so the slot's
+# port is freed even when a step fails and set -e leaves early
+RUN_SERVER_PID=""
+stop_run_server() {
+    if [ -n "$RUN_SERVER_PID" ]; then
+        kill -SIGTERM $RUN_SERVER_PID 2>/dev/null || true
+        wait $RUN_SERVER_PID 2>/dev/null || true
+        RUN_SERVER_PID=""
+    fi
+}
+
+# Function to run a single experiment in a slot and cache its result
+# (always started in the background)
 run_experiment() {
     local impl=$1
     local impl_name=$2
     local msg_size=$3
     local thread_count=$4
+    local rep=$5
+    local slot=$6
+    local key=$7
+    local strategy=$8
+    local profile=$9
+    local paths=${10}
+    local sched=${11}
+    
+    local label="$impl_name | MsgSize=$msg_size | Threads=$thread_count | Run $rep/$REPEATS"
+    
+    # The profiling run records call graphs of server and clients
+    local callgraph=0
+    if [ "$rep" = "profile" ]; then
+        callgraph=1
+        label="$impl_name | MsgSize=$msg_size | Threads=$thread_count | Call-graph profile"
+    fi
+    local perf_record=(perf record -g -F "$PERF_FREQ" -q -o)
+    echo -e "${YELLOW}Running: $label (slot $slot)${NC}"
     
-    echo -e "${YELLOW}Running: $impl_name | MsgSize=$msg_size | Threads=$thread_count${NC}"
+    local server_ns=$(slot_server_ns $slot)
+    local client_ns=$(slot_client_ns $slot)
+    local server_ip=$(slot_srv_ip $slot)
     
-    # Get absolute paths
+    # Pin server and clients to the slot's CPU set when running in parallel
+    local server_pin=()
+    local client_pin=()
+    if [ -n "$(slot_cpus $slot server)" ]; then
+        server_pin=(taskset -c "$(slot_cpus $slot server)")
+        client_pin=(taskset -c "$(slot_cpus $slot client)")
+    fi
+    
+    # Get absolute paths; outputs go to a partial directory until complete
     local server_bin="$(pwd)/MT25018_Part_${impl}_Server"
     local client_bin="$(pwd)/MT25018_Part_${impl}_Client"
-    local perf_output="$(pwd)/$OUTPUT_DIR/perf_${impl_name}_${msg_size}_${thread_count}.txt"
-    local client_output="$(pwd)/$OUTPUT_DIR/client_${impl_name}_${msg_size}_${thread_count}.txt"
+    local work_dir="$(pwd)/$CACHE_DIR/${key}.partial"
+    local server_output="$work_dir/server.txt"
+    local server_json="$work_dir/server.json"
+    local client_output="$work_dir/client"
+    
+    rm -rf "$work_dir"
+    mkdir -p "$work_dir"
+    
+    if ! apply_profile $slot "$profile"; then
+        echo -e "${RED}Could not apply network profile $profile (is sch_netem available?) ($label)${NC}"
+        return 1
+    fi
+    if ! apply_paths $slot "$paths"; then
+        echo -e "${RED}Could not configure MPTCP endpoints (is MPTCP enabled?) ($label)${NC}"
+        return 1
+    fi
+    
+    local server_opts=()
+    if [ -n "$TCPINFO_MS" ] && [ "$impl" != "A4" ]; then
+        server_opts=(--tcp-info "$work_dir/tcp_info.csv" --tcp-info-ms "$TCPINFO_MS")
+    fi
+    if [ "$paths" -gt 0 ]; then
+        server_opts+=(--mptcp)
+    fi
+    if [ "$sched" != "none" ]; then
+        server_opts+=(--sched "$sched" --sched-workers "$(sched_workers "$thread_count")")
+    fi
+    
+    # Kernel counters of both namespaces around the run: softirqs,
+    # interrupts and per-CPU softirq time are system-wide, so they are
+    # summed over the slot's CPUs (all CPUs when not pinned)
+    local netstack=(python3 "$(pwd)/MT25018_Part_C_netstack_snapshot.py")
+    local run_cpus=""
+    if [ -n "$(slot_cpus $slot server)" ]; then
+        run_cpus="$(slot_cpus $slot server),$(slot_cpus $slot client)"
+    fi
+    ip netns exec $server_ns "${netstack[@]}" snapshot "$work_dir/netstack_server_before.json"
+    ip netns exec $client_ns "${netstack[@]}" snapshot "$work_dir/netstack_client_before.json"
     
-    # Start server with perf in server namespace
-    ip netns exec $SERVER_NS perf stat -e "$PERF_EVENTS" -o "$perf_output" \
-        "$server_bin" "$msg_size" "$thread_count" > /dev/null 2>&1 &
-    local server_pid=$!
+    # Start server in server namespace; each handler thread counts only its send loop
+    local server_prefix=()
+    if [ "$callgraph" -eq 1 ]; then
+        server_prefix=("${perf_record[@]}" "$work_dir/server.perf.data" --)
+    fi
+    ip netns exec $server_ns "${server_pin[@]}" "${server_prefix[@]}" "$server_bin" --perf-counters --json "$server_json" \
+        "${server_opts[@]}" "$msg_size" "$thread_count" > "$server_output" 2>&1 &
+    RUN_SERVER_PID=$!
+    trap stop_run_server EXIT
     
     # Give server time to start
     sleep 2
     
     # Check if server is running
-    if ! kill -0 $server_pid 2>/dev/null; then
-        echo -e "${RED}Server failed to start!${NC}"
+    if ! kill -0 $RUN_SERVER_PID 2>/dev/null; then
+        echo -e "${RED}Server failed to start! ($label)${NC}"
         return 1
     fi
     
     # Start clients in client namespace
     local client_pids=()
+    local client_jsons=()
+    local client_opts=()
+    if [ "$strategy" != "native" ]; then
+        client_opts=(--recv-strategy "$strategy")
+    fi
+    if [ "$WARMUP" -gt 0 ]; then
+        client_opts+=(--warmup "$WARMUP")
+    fi
+    if [ "$STEADY" -eq 1 ]; then
+        client_opts+=(--steady-state)
+    fi
+    if [ "$paths" -gt 0 ]; then
+        client_opts+=(--mptcp)
+    fi
+    local client_prefix=()
     for ((i=1; i<=thread_count; i++)); do
-        ip netns exec $CLIENT_NS "$client_bin" "$SERVER_IP" "$msg_size" "$TEST_DURATION" \
-            > "${client_output}_${i}.txt" 2>&1 &
+        if [ "$callgraph" -eq 1 ]; then
+            client_prefix=("${perf_record[@]}" "$work_dir/client_${i}.perf.data" --)
+        fi
+        ip netns exec $client_ns "${client_pin[@]}" "${client_prefix[@]}" "$client_bin" --perf-counters \
+            "${client_opts[@]}" --json "${client_output}_${i}.json" \
+            "$server_ip" "$msg_size" "$TEST_DURATION" > "${client_output}_${i}.txt" 2>&1 &
         client_pids+=($!)
+        client_jsons+=("${client_output}_${i}.json")
     done
     
     # Wait for all clients to complete
+    local client_failed=0
     for pid in "${client_pids[@]}"; do
-        wait $pid
+        wait $pid || client_failed=1
     done
+    ip netns exec $server_ns "${netstack[@]}" snapshot "$work_dir/netstack_server_after.json"
+    ip netns exec $client_ns "${netstack[@]}" snapshot "$work_dir/netstack_client_after.json"
     
     # Give server time to flush stats
     sleep 2
     
-    # Stop server
-    kill -SIGTERM $server_pid 2>/dev/null || true
-    wait $server_pid 2>/dev/null || true
+    # Stop server (perf record passes the SIGTERM on to it)
+    stop_run_server
+    if [ $client_failed -eq 1 ]; then
+        echo -e "${RED}A client failed, see ${client_output}_*.txt ($label)${NC}"
+        return 1
+    fi
+    
+    # Fold the recorded stacks right away; perf.data files are large
+    if [ "$callgraph" -eq 1 ]; then
+        local data
+        for data in "$work_dir"/*.perf.data; do
+            perf script -i "$data" 2>/dev/null \
+                | python3 MT25018_Part_C_profile_report.py fold > "${data%.perf.data}.folded"
+            rm -f "$data"
+        done
+    fi
     
-    # Extract application-level metrics from first client
-    local throughput=$(grep "Throughput:" "${client_output}_1.txt" | awk '{print $2}')
-    local latency=$(grep "Average latency:" "${client_output}_1.txt" | awk '{print $3}')
-    local total_bytes=$(grep "Total bytes received:" "${client_output}_1.txt" | awk '{print $4}')
-    local total_msgs=$(grep "Total messages received:" "${client_output}_1.txt" | awk '{print $4}')
-    local duration=$(grep "Elapsed time:" "${client_output}_1.txt" | awk '{print $3}')
+    "${netstack[@]}" delta --cpus "$run_cpus" \
+        "$work_dir"/netstack_{server,client}_{before,after}.json > "$work_dir/netstack.json" || true
     
-    # Handle missing latency (set default)
-    if [ -z "$latency" ]; then
-        latency="0.0"
+    # Aggregate the structured records of every client (and the server)
+    if ! python3 MT25018_Part_C_aggregate_results.py --format json --server "$server_json" \
+        --netstack "$work_dir/netstack.json" "${client_jsons[@]}" > "$work_dir/result.json"; then
+        echo -e "${RED}Could not aggregate the run's records ($label)${NC}"
+        return 1
     fi
     
-    # Extract perf metrics
-    local cpu_cycles=$(extract_perf_metric "$perf_output" "cycles")
-    local instructions=$(extract_perf_metric "$perf_output" "instructions")
-    local cache_misses=$(extract_perf_metric "$perf_output" "cache-misses")
-    local l1_misses=$(extract_perf_metric "$perf_output" "L1-dcache-load-misses")
-    local llc_misses=$(extract_perf_metric "$perf_output" "LLC-load-misses")
-    local ctx_switches=$(extract_perf_metric "$perf_output" "context-switches")
+    # Publish the run atomically so resumed sweeps only see complete runs
+    if ! mv "$work_dir" "$(pwd)/$CACHE_DIR/$key"; then
+        echo -e "${RED}Could not publish the run to $CACHE_DIR/$key ($label)${NC}"
+        return 1
+    fi
+    
+    local throughput_gbps=0 latency_p99_us=0 server_cycles_per_byte=0
+    read_metrics "$CACHE_DIR/$key/result.json"
+    echo -e "${GREEN}[OK] $label: ${throughput_gbps} Gbps, p99 ${latency_p99_us} us, ${server_cycles_per_byte} cycles/byte${NC}"
+}
+
+# Sweep variants: every receive strategy under every network profile
+# over every MPTCP path count with every server scheduling mode
+VARIANTS=()
+for sched in "${SCHED_MODES[@]}"; do
+    for paths in "${MPTCP_PATHS[@]}"; do
+        for profile in "${NET_PROFILES[@]}"; do
+            for strategy in "${RECV_STRATEGIES[@]}"; do
+                VARIANTS+=("$strategy $profile $paths $sched")
+            done
+        done
+    done
+done
+
+# Build the job list, skipping runs that are already cached
+JOBS=()
+CACHED=0
+for impl_idx in "${!IMPLEMENTATIONS[@]}"; do
+    impl="${IMPLEMENTATIONS[$impl_idx]}"
+    for variant in "${VARIANTS[@]}"; do
+        read -r strategy profile paths sched <<< "$variant"
+        # The UDP client has a single receive path of its own, no MPTCP and
+        # no scheduler on the server; ZeroCopy's SO_ZEROCOPY fails on MPTCP
+        # sockets, so its MPTCP rows would measure copying sends
+        if [ "$impl" = "A4" ] && { [ "$strategy" != "native" ] || [ "$paths" -gt 0 ] || [ "$sched" != "none" ]; }; then
+            continue
+        fi
+        if [ "$impl" = "A3" ] && [ "$paths" -gt 0 ]; then
+            continue
+        fi
+        impl_name=$(config_name "${IMPL_NAMES[$impl_idx]}" "$strategy" "$profile" "$paths" "$sched")
+        for msg_size in "${MESSAGE_SIZES[@]}"; do
+            for thread_count in "${THREAD_COUNTS[@]}"; do
+                for ((rep=1; rep<=REPEATS; rep++)); do
+                    key=$(run_key "$impl" "$impl_name" "$msg_size" "$thread_count" "$rep" "$strategy" "$profile" "$paths" "$sched")
+                    if [ -f "$CACHE_DIR/$key/result.json" ]; then
+                        CACHED=$((CACHED + 1))
+                    else
+                        JOBS+=("$impl $impl_name $msg_size $thread_count $rep $key $strategy $profile $paths $sched")
+                    fi
+                done
+                # One extra call-graph run, never counted as a repeat
+                if [ "$CALLGRAPH" -eq 1 ]; then
+                    key=$(run_key "$impl" "$impl_name" "$msg_size" "$thread_count" "profile" "$strategy" "$profile" "$paths" "$sched")
+                    if [ -f "$CACHE_DIR/$key/result.json" ]; then
+                        CACHED=$((CACHED + 1))
+                    else
+                        JOBS+=("$impl $impl_name $msg_size $thread_count profile $key $strategy $profile $paths $sched")
+                    fi
+                fi
+            done
+        done
+    done
+done
+
+echo -e "\n${YELLOW}Starting experiments...${NC}"
+echo "Runs: $((${#JOBS[@]} + CACHED)) total, $CACHED cached, ${#JOBS[@]} to run"
+echo "Parallel jobs: $PARALLEL_JOBS, repeats per configuration: $REPEATS"
+echo "Client receive strategies: ${RECV_STRATEGIES[*]}"
+echo "Network profiles: ${NET_PROFILES[*]}"
+echo "MPTCP path counts: ${MPTCP_PATHS[*]}"
+echo "Server scheduling modes: ${SCHED_MODES[*]}"
+if [ -n "$TCPINFO_MS" ]; then
+    echo "TCP_INFO sampling every $TCPINFO_MS ms"
+fi
+if [ "$WARMUP" -gt 0 ] || [ "$STEADY" -eq 1 ]; then
+    echo "Client warm-up: ${WARMUP}s, steady-state detection: $([ "$STEADY" -eq 1 ] && echo on || echo off)"
+fi
+if [ "$CALLGRAPH" -eq 1 ]; then
+    echo "Call-graph profiling: one perf record -g run per configuration at $PERF_FREQ Hz"
+fi
+echo "This will take approximately $(( (${#JOBS[@]} * ($TEST_DURATION + WARMUP + 5) + PARALLEL_JOBS - 1) / PARALLEL_JOBS )) seconds"
+echo ""
+
+# Setup one namespace pair per slot
+if [ ${#JOBS[@]} -gt 0 ]; then
+    for ((slot=0; slot<PARALLEL_JOBS; slot++)); do
+        setup_namespaces $slot
+    done
+fi
+
+trap on_interrupt INT TERM
+
+# Run all experiments, keeping at most one per slot
+SLOT_PIDS=()
+for job in "${JOBS[@]}"; do
+    read -r impl impl_name msg_size thread_count rep key strategy profile paths sched <<< "$job"
+    
+    # Find a free slot, waiting for any running experiment if none is free
+    free_slot=-1
+    while [ $free_slot -lt 0 ]; do
+        for ((slot=0; slot<PARALLEL_JOBS; slot++)); do
+            pid=${SLOT_PIDS[$slot]}
+            if [ -z "$pid" ] || ! kill -0 "$pid" 2>/dev/null; then
+                free_slot=$slot
+                break
+            fi
+        done
+        if [ $free_slot -lt 0 ]; then
+            wait -n 2>/dev/null || true
+        fi
+    done
+    
+    run_experiment "$impl" "$impl_name" "$msg_size" "$thread_count" "$rep" "$free_slot" "$key" "$strategy" "$profile" "$paths" "$sched" &
+    SLOT_PIDS[$free_slot]=$!
+done
+
+# Wait for the remaining experiments (failed runs are simply not cached)
+for pid in "${SLOT_PIDS[@]}"; do
+    wait "$pid" 2>/dev/null || true
+done
+
+trap - INT TERM
+
+# Initialize CSV files with headers (in main directory, or the gate's)
+mkdir -p "$RESULTS_DIR"
+echo "Implementation,MessageSize,ThreadCount,Throughput_Gbps,TotalBytes,TotalMessages,Duration_sec,Clients,Client_Min_Gbps,Client_Max_Gbps,Client_MinMax_Ratio,Repeats,Throughput_CI95_Gbps,Jain_Index" > "$THROUGHPUT_CSV"
+echo "Implementation,MessageSize,ThreadCount,Latency_us,P50_us,P99_us,P999_us,Latency_CI95_us,P99_CI95_us" > "$LATENCY_CSV"
+echo "Implementation,MessageSize,ThreadCount,CPU_Cycles,CacheMisses,L1_Misses,LLC_Misses,ContextSwitches,Instructions,IPC,CyclesPerByte,Client_CPU_Cycles,Client_CyclesPerByte,CyclesPerByte_CI95,Softirq_sec,NetSoftirq_sec_est,NetRx_Softirqs,NetTx_Softirqs,Softirq_ns_per_byte,Interrupts,Out_Segs,Retrans_Segs,Drops" > "$PERF_CSV"
+if [ -n "$TCPINFO_MS" ]; then
+    echo "Implementation,MessageSize,ThreadCount,Repeat,Time_sec,Thread,Port,RTT_us,RTTVar_us,Cwnd,Ssthresh,Unacked,Retrans,TotalRetrans,NotSent_bytes,DeliveryRate_Mbps,Busy_us,RwndLimited_us,SndbufLimited_us,BytesAcked" > "$TCPINFO_CSV"
+fi
+if [ "$CALLGRAPH" -eq 1 ]; then
+    echo "Implementation,MessageSize,ThreadCount,Side,Space,Rank,Symbol,Self_Pct,Inclusive_Pct,Self_Samples" > "$SYMBOLS_CSV"
+    mkdir -p "$FLAMEGRAPH_DIR"
+fi
+
+# Function to summarize the cached repeats of one configuration into the CSVs
+write_csv_rows() {
+    local impl=$1
+    local impl_name=$2
+    local msg_size=$3
+    local thread_count=$4
+    local strategy=$5
+    local profile=$6
+    local paths=$7
+    local sched=$8
+    
+    local results=()
+    for ((rep=1; rep<=REPEATS; rep++)); do
+        local key=$(run_key "$impl" "$impl_name" "$msg_size" "$thread_count" "$rep" "$strategy" "$profile" "$paths" "$sched")
+        if [ -f "$CACHE_DIR/$key/result.json" ]; then
+            results+=("$CACHE_DIR/$key/result.json")
+        fi
+        # Per-connection TCP_INFO samples, tagged with their configuration
+        if [ -n "$TCPINFO_MS" ] && [ -f "$CACHE_DIR/$key/tcp_info.csv" ]; then
+            tail -n +2 "$CACHE_DIR/$key/tcp_info.csv" \
+                | sed "s/^/$impl_name,$msg_size,$thread_count,$rep,/" >> "$TCPINFO_CSV"
+        fi
+    done
+    
+    if [ ${#results[@]} -eq 0 ]; then
+        echo -e "${RED}No completed runs for $impl_name | MsgSize=$msg_size | Threads=$thread_count${NC}"
+        MISSING=$((MISSING + 1))
+        return
+    fi
+    
+    local repeats=0 num_clients=0 throughput_gbps=0 throughput_gbps_ci95=0
+    local total_bytes=0 total_messages=0 duration_sec=0
+    local client_min_gbps=0 client_max_gbps=0 client_min_max_ratio=0 client_jain_index=0
+    local latency_avg_us=0 latency_avg_us_ci95=0 latency_p50_us=0
+    local latency_p99_us=0 latency_p99_us_ci95=0 latency_p999_us=0
+    local server_cycles=0 server_instructions=0 server_cache_misses=0 server_l1d_misses=0
+    local server_llc_misses=0 server_context_switches=0 server_ipc=0
+    local server_cycles_per_byte=0 server_cycles_per_byte_ci95=0
+    local client_cycles=0 client_cycles_per_byte=0
+    local softirq_sec=0 net_softirq_sec_est=0 net_rx_softirqs=0 net_tx_softirqs=0
+    local softirq_ns_per_byte=0 interrupts=0 server_out_segs=0 retrans_segs=0 drops=0
+    read_metrics "${results[@]}"
     
     # Write to 3 separate CSV files
-    echo "$impl_name,$msg_size,$thread_count,$throughput,$total_bytes,$total_msgs,$duration" \
-        >> "MT25018_Part_C_Throughput_Metrics.csv"
+    echo "$impl_name,$msg_size,$thread_count,$throughput_gbps,$total_bytes,$total_messages,$duration_sec,$num_clients,$client_min_gbps,$client_max_gbps,$client_min_max_ratio,$repeats,$throughput_gbps_ci95,$client_jain_index" \
+        >> "$THROUGHPUT_CSV"
     
-    echo "$impl_name,$msg_size,$thread_count,$latency" \
-        >> "MT25018_Part_C_Latency_Metrics.csv"
+    echo "$impl_name,$msg_size,$thread_count,$latency_avg_us,$latency_p50_us,$latency_p99_us,$latency_p999_us,$latency_avg_us_ci95,$latency_p99_us_ci95" \
+        >> "$LATENCY_CSV"
     
-    echo "$impl_name,$msg_size,$thread_count,$cpu_cycles,$cache_misses,$l1_misses,$llc_misses,$ctx_switches" \
-        >> "MT25018_Part_C_Perf_Metrics.csv"
+    echo "$impl_name,$msg_size,$thread_count,$server_cycles,$server_cache_misses,$server_l1d_misses,$server_llc_misses,$server_context_switches,$server_instructions,$server_ipc,$server_cycles_per_byte,$client_cycles,$client_cycles_per_byte,$server_cycles_per_byte_ci95,$softirq_sec,$net_softirq_sec_est,$net_rx_softirqs,$net_tx_softirqs,$softirq_ns_per_byte,$interrupts,$server_out_segs,$retrans_segs,$drops" \
+        >> "$PERF_CSV"
     
     # Display collected metrics
-    echo -e "${GREEN}Metrics Collected:${NC}"
-    echo "  Application-level:"
-    echo "    - Throughput: ${throughput} Gbps"
-    echo "    - Latency: ${latency} us"
-    echo "  perf stat:"
-    echo "    - CPU Cycles: ${cpu_cycles}"
-    echo "    - L1 Cache Misses: ${l1_misses}"
-    echo "    - LLC Cache Misses: ${llc_misses}"
-    echo "    - Context Switches: ${ctx_switches}"
-    
-    echo -e "${GREEN}[OK] Completed${NC}"
-    echo ""
+    echo -e "${GREEN}$impl_name | MsgSize=$msg_size | Threads=$thread_count ($repeats runs):${NC}"
+    echo "    - Throughput: ${throughput_gbps} ± ${throughput_gbps_ci95} Gbps (sum of ${num_clients} clients, min ${client_min_gbps} / max ${client_max_gbps}, Jain ${client_jain_index})"
+    echo "    - Latency: avg ${latency_avg_us} ± ${latency_avg_us_ci95} us, p99 ${latency_p99_us} ± ${latency_p99_us_ci95} us"
+    echo "    - Cycles/Byte: server ${server_cycles_per_byte} ± ${server_cycles_per_byte_ci95}, client ${client_cycles_per_byte}"
+    echo "    - Softirq: ${softirq_sec}s (~${net_softirq_sec_est}s NET_RX/NET_TX, ${softirq_ns_per_byte} ns/byte), ${server_out_segs} segments, ${retrans_segs} retransmits, ${drops} drops"
+    
+    # Flame graphs and top symbols of the configuration's profiling run
+    if [ "$CALLGRAPH" -eq 1 ]; then
+        local profile_dir="$CACHE_DIR/$(run_key "$impl" "$impl_name" "$msg_size" "$thread_count" "profile" "$strategy" "$profile" "$paths" "$sched")"
+        local side
+        for side in server client; do
+            local folded=("$profile_dir/$side"*.folded)
+            if [ ! -f "${folded[0]}" ]; then
+                continue
+            fi
+            python3 MT25018_Part_C_profile_report.py report --name "$impl_name" --size "$msg_size" \
+                --threads "$thread_count" --side $side --csv "$SYMBOLS_CSV" \
+                --svg "$FLAMEGRAPH_DIR/${impl_name}_${msg_size}_${thread_count}_${side}.svg" \
+                "${folded[@]}" || true
+        done
+    fi
 }
 
-# Run all experiments
+echo -e "\n${YELLOW}Summarizing results...${NC}"
+MISSING=0
 for impl_idx in "${!IMPLEMENTATIONS[@]}"; do
     impl="${IMPLEMENTATIONS[$impl_idx]}"
-    impl_name="${IMPL_NAMES[$impl_idx]}"
-    
-    echo -e "\n${GREEN}========== Testing $impl_name Implementation ==========${NC}\n"
-    
-    for msg_size in "${MESSAGE_SIZES[@]}"; do
-        for thread_count in "${THREAD_COUNTS[@]}"; do
-            run_experiment "$impl" "$impl_name" "$msg_size" "$thread_count"
+    for variant in "${VARIANTS[@]}"; do
+        read -r strategy profile paths sched <<< "$variant"
+        if [ "$impl" = "A4" ] && { [ "$strategy" != "native" ] || [ "$paths" -gt 0 ] || [ "$sched" != "none" ]; }; then
+            continue
+        fi
+        if [ "$impl" = "A3" ] && [ "$paths" -gt 0 ]; then
+            continue
+        fi
+        impl_name=$(config_name "${IMPL_NAMES[$impl_idx]}" "$strategy" "$profile" "$paths" "$sched")
+        for msg_size in "${MESSAGE_SIZES[@]}"; do
+            for thread_count in "${THREAD_COUNTS[@]}"; do
+                write_csv_rows "$impl" "$impl_name" "$msg_size" "$thread_count" "$strategy" "$profile" "$paths" "$sched"
+            done
         done
     done
 done
@@ -260,12 +940,22 @@ done
 echo -e "\n${GREEN}=========================================="
 echo "All experiments completed!"
 echo "==========================================${NC}"
+if [ $MISSING -gt 0 ]; then
+    echo -e "${RED}$MISSING configurations have no completed runs; rerun to resume.${NC}"
+fi
 echo ""
 echo "Results saved to:"
-echo "  - MT25018_Part_C_Throughput_Metrics.csv (main directory)"
-echo "  - MT25018_Part_C_Latency_Metrics.csv (main directory)"
-echo "  - MT25018_Part_C_Perf_Metrics.csv (main directory)"
-echo "  - Individual logs and perf outputs in: $OUTPUT_DIR/"
+echo "  - $THROUGHPUT_CSV"
+echo "  - $LATENCY_CSV"
+echo "  - $PERF_CSV"
+if [ -n "$TCPINFO_MS" ]; then
+    echo "  - $TCPINFO_CSV"
+fi
+if [ "$CALLGRAPH" -eq 1 ]; then
+    echo "  - $SYMBOLS_CSV"
+    echo "  - Flame graphs in: $FLAMEGRAPH_DIR/"
+fi
+echo "  - Individual server/client logs per run in: $CACHE_DIR/"
 echo ""
 
 # Cleanup network namespaces
@@ -273,6 +963,23 @@ cleanup_namespaces
 
 echo -e "${GREEN}Network namespaces cleaned up.${NC}"
 
+# Regression gate: compare against the committed baseline and stop here
+if [ "$GATE" -eq 1 ]; then
+    echo -e "\n${YELLOW}Comparing against committed baseline...${NC}"
+    gate_sizes=$(IFS=','; echo "${MESSAGE_SIZES[*]}")
+    gate_threads=$(IFS=','; echo "${THREAD_COUNTS[*]}")
+    if python3 MT25018_Part_C_regression_gate.py --baseline-dir . --current-dir "$RESULTS_DIR" \
+        --sizes "$gate_sizes" --threads "$gate_threads" && [ $MISSING -eq 0 ]; then
+        echo -e "${GREEN}Regression gate passed.${NC}"
+        exit 0
+    fi
+    if [ $MISSING -gt 0 ]; then
+        echo -e "${RED}$MISSING configurations have no completed runs.${NC}"
+    fi
+    echo -e "${RED}Regression gate failed.${NC}"
+    exit 1
+fi
+
 # Generate plots automatically
 echo -e "\n${YELLOW}Generating plots...${NC}"
 python3 MT25018_Plot1_Throughput_vs_MessageSize.py
@@ -0,0 +1,284 @@
+#!/usr/bin/env python3
+"""
+MT25018 - Graduate Systems PA02
+Part C: Offline analyzer for the binary event traces (--trace)
+
+Reads one or more trace files written by the servers and clients
+(MT25018_Common_Trace.h) and reconstructs every send/receive call from its
+begin/end events. Several files (e.g. the server's and a client's trace of
+the same run) are aligned on the wall clock recorded when each was opened.
+It prints:
+  - per connection: calls, bytes, throughput, call latency, errors and
+    events lost to ring wrap-around
+  - per interval (--interval-ms): calls, bytes, throughput, call latency
+    percentiles, errors and zero-copy completions; intervals whose
+    throughput falls below --dip-threshold times the median are flagged
+    as dips
+  - the longest calls (--top), the usual suspects behind a dip
+Intervals are summarised and dips listed; the full interval table is
+written only with --csv. --timeline writes one row per call.
+
+Usage:
+  python3 MT25018_Part_C_trace_analyze.py [--interval-ms MS] [--dip-threshold F] \\
+      [--top N] [--timeline CSV] [--csv CSV] TRACE [TRACE ...]
+"""
+
+import argparse
+import csv
+import struct
+import sys
+
+TRACE_MAGIC = b"MT25TRC1"
+HEADER_SIZE = 128
+FILE_HEADER = struct.Struct("<8sIIIIQQdII8s16s")
+RING_HEADER = struct.Struct("<QII48x")
+EVENT = struct.Struct("<QiBBH")
+
+SEND_BEGIN, SEND_END, RECV_BEGIN, RECV_END, ZEROCOPY_DONE, CONN_START, CONN_END = range(1, 8)
+OP_NAMES = {SEND_END: "send", RECV_END: "recv"}
+BEGIN_OF = {SEND_END: SEND_BEGIN, RECV_END: RECV_BEGIN}
+# TransportPath of the adaptive sender (MT25018_Common_Adaptive.h)
+PATH_NAMES = ["TwoCopy", "OneCopy", "ZeroCopy"]
+
+
+def cstr(raw):
+    return raw.split(b"\0", 1)[0].decode(errors="replace")
+
+
+def percentile(sorted_values, pct):
+    if not sorted_values:
+        return 0.0
+    index = min(len(sorted_values) - 1, int(pct / 100.0 * len(sorted_values)))
+    return sorted_values[index]
+
+
+def median(values):
+    values = sorted(values)
+    if not values:
+        return 0.0
+    mid = len(values) // 2
+    return values[mid] if len(values) % 2 else (values[mid - 1] + values[mid]) / 2
+
+
+def load_trace(path):
+    """Header fields and, per ring, the surviving events oldest first"""
+    with open(path, "rb") as f:
+        data = f.read()
+    if len(data) < HEADER_SIZE or data[:8] != TRACE_MAGIC:
+        raise ValueError(f"{path}: not a trace file")
+    (_, version, num_rings, ring_events, event_size, start_ticks, start_realtime_ns,
+     ticks_per_ns, closed, _, role, transport) = FILE_HEADER.unpack_from(data)
+    if event_size != EVENT.size:
+        raise ValueError(f"{path}: event size {event_size}, expected {EVENT.size}")
+
+    trace = {
+        "path": path,
+        "version": version,
+        "role": cstr(role),
+        "transport": cstr(transport),
+        "start_ticks": start_ticks,
+        "start_ns": start_realtime_ns,
+        "ticks_per_ns": ticks_per_ns if ticks_per_ns > 0 else 1.0,
+        "closed": closed,
+        "rings": [],
+    }
+    ring_bytes = RING_HEADER.size + ring_events * EVENT.size
+    for ring in range(num_rings):
+        base = HEADER_SIZE + ring * ring_bytes
+        head, owner, _ = RING_HEADER.unpack_from(data, base)
+        count = min(head, ring_events)
+        events = []
+        for k in range(head - count, head):
+            offset = base + RING_HEADER.size + (k % ring_events) * EVENT.size
+            events.append(EVENT.unpack_from(data, offset))
+        trace["rings"].append({"index": ring, "head": head, "lost": head - count,
+                               "open": owner != 0, "events": events})
+    return trace
+
+
+def reconstruct(trace, origin_ns):
+    """Calls (begin/end pairs) and zero-copy completions of one trace; times
+    are in ns since origin_ns on the wall clock"""
+    offset_ns = trace["start_ns"] - origin_ns
+    rate = trace["ticks_per_ns"]
+    start_ticks = trace["start_ticks"]
+
+    def to_ns(ticks):
+        return offset_ns + (ticks - start_ticks) / rate
+
+    ops, completions, connections = [], [], []
+    for ring in trace["rings"]:
+        conn = None
+        pending = {}
+        for ticks, value, etype, err, aux in ring["events"]:
+            if etype == CONN_START or conn is None:
+                # Thread 0: the connection's start was overwritten
+                conn = {"role": trace["role"], "ring": ring["index"],
+                        "thread": value if etype == CONN_START else 0,
+                        "seq": len(connections), "lost": ring["lost"] if conn is None else 0,
+                        "ops": 0, "bytes": 0, "errors": 0, "latencies": [],
+                        "first_ns": to_ns(ticks), "last_ns": to_ns(ticks)}
+                connections.append(conn)
+                pending = {}
+                if etype == CONN_START:
+                    continue
+            t = to_ns(ticks)
+            conn["last_ns"] = t
+            if etype in (SEND_BEGIN, RECV_BEGIN):
+                pending[etype] = t
+            elif etype in BEGIN_OF:
+                begin = pending.pop(BEGIN_OF[etype], None)
+                if begin is None:
+                    continue  # begin was overwritten by the ring
+                op = {"role": trace["role"], "ring": ring["index"], "conn": conn["seq"],
+                      "thread": conn["thread"], "op": OP_NAMES[etype], "start_ns": begin,
+                      "end_ns": t, "bytes": max(value, 0), "errno": err if value < 0 else 0,
+                      "path": PATH_NAMES[aux] if trace["transport"] == "Adaptive"
+                              and aux < len(PATH_NAMES) else trace["transport"]}
+                ops.append(op)
+                conn["ops"] += 1
+                conn["bytes"] += op["bytes"]
+                conn["errors"] += 1 if value < 0 else 0
+                conn["latencies"].append((t - begin) / 1000.0)
+            elif etype == ZEROCOPY_DONE:
+                completions.append({"time_ns": t, "sends": value, "copied": aux})
+    return ops, completions, connections
+
+
+def print_connections(connections):
+    print(f"\n{'Role':<7} {'Ring':>5} {'Thread':>7} {'Calls':>10} {'MB':>10} {'Gbps':>8} "
+          f"{'Mean us':>9} {'p99 us':>9} {'Max us':>10} {'Errors':>7} {'Lost ev':>8}")
+    print("-" * 98)
+    for c in connections:
+        if c["ops"] == 0:
+            continue
+        span_ns = c["last_ns"] - c["first_ns"]
+        latencies = sorted(c["latencies"])
+        gbps = c["bytes"] * 8 / span_ns if span_ns > 0 else 0.0
+        print(f"{c['role']:<7} {c['ring']:>5} {c['thread']:>7} {c['ops']:>10} "
+              f"{c['bytes'] / 1e6:>10.1f} {gbps:>8.3f} {sum(latencies) / len(latencies):>9.2f} "
+              f"{percentile(latencies, 99):>9.2f} {latencies[-1]:>10.2f} {c['errors']:>7} "
+              f"{c['lost']:>8}")
+
+
+def interval_rows(role, ops, completions, interval_ns, dip_threshold):
+    """Per-interval statistics of one role; calls count in the interval they end"""
+    if not ops:
+        return []
+    buckets = {}
+    for op in ops:
+        b = buckets.setdefault(int(op["end_ns"] // interval_ns), {"lat": [], "bytes": 0, "errors": 0,
+                                                                "zc": 0, "zc_copied": 0})
+        b["lat"].append((op["end_ns"] - op["start_ns"]) / 1000.0)
+        b["bytes"] += op["bytes"]
+        b["errors"] += 1 if op["errno"] else 0
+    for done in completions:
+        b = buckets.get(int(done["time_ns"] // interval_ns))
+        if b is not None:
+            b["zc"] += done["sends"]
+            b["zc_copied"] += done["sends"] if done["copied"] else 0
+
+    first, last = min(buckets), max(buckets)
+    rows = []
+    for index in range(first, last + 1):
+        b = buckets.get(index, {"lat": [], "bytes": 0, "errors": 0, "zc": 0, "zc_copied": 0})
+        lat = sorted(b["lat"])
+        rows.append({
+            "Role": role,
+            "Interval_ms": round(index * interval_ns / 1e6, 3),
+            "Calls": len(lat),
+            "Bytes": b["bytes"],
+            "Throughput_Gbps": round(b["bytes"] * 8 / interval_ns, 4),
+            "Mean_us": round(sum(lat) / len(lat), 2) if lat else 0.0,
+            "P50_us": round(percentile(lat, 50), 2),
+            "P99_us": round(percentile(lat, 99), 2),
+            "Max_us": round(lat[-1], 2) if lat else 0.0,
+            "Errors": b["errors"],
+            "ZeroCopy_Completed": b["zc"],
+            "ZeroCopy_Copied": b["zc_copied"],
+            "Dip": 0,
+        })
+    # The first and last intervals are partial; they set no baseline
+    inner = rows[1:-1] if len(rows) > 2 else rows
+    baseline = median([r["Throughput_Gbps"] for r in inner])
+    for r in inner:
+        if baseline > 0 and r["Throughput_Gbps"] < dip_threshold * baseline:
+            r["Dip"] = 1
+    return rows
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Analyze binary event traces")
+    parser.add_argument("traces", nargs="+", help="trace files written with --trace")
+    parser.add_argument("--interval-ms", type=float, default=100.0,
+                        help="interval length for the per-interval statistics (default 100)")
+    parser.add_argument("--dip-threshold", type=float, default=0.5,
+                        help="flag intervals below this fraction of the median throughput")
+    parser.add_argument("--top", type=int, default=10, help="longest calls to list (default 10)")
+    parser.add_argument("--timeline", help="write one CSV row per call to this file")
+    parser.add_argument("--csv", help="write the per-interval statistics to this CSV")
+    args = parser.parse_args()
+
+    try:
+        traces = [load_trace(path) for path in args.traces]
+    except (OSError, ValueError) as e:
+        print(f"ERROR: {e}", file=sys.stderr)
+        return 1
+
+    origin_ns = min(t["start_ns"] for t in traces)
+    interval_ns = args.interval_ms * 1e6
+    all_ops, all_rows = [], []
+    for trace in traces:
+        ops, completions, connections = reconstruct(trace, origin_ns)
+        events = sum(r["head"] for r in trace["rings"])
+        lost = sum(r["lost"] for r in trace["rings"])
+        print("=" * 98)
+        print(f"{trace['path']}: {trace['role']} {trace['transport']}, {len(trace['rings'])} rings, "
+              f"{events} events ({lost} overwritten), {len(ops)} calls"
+              f"{'' if trace['closed'] else ', not closed (process crashed or still running)'}")
+        print(f"Start offset: {(trace['start_ns'] - origin_ns) / 1e6:.3f} ms, "
+              f"tick rate {trace['ticks_per_ns']:.4f} ticks/ns")
+        print_connections(connections)
+
+        rows = interval_rows(trace["role"], ops, completions, interval_ns, args.dip_threshold)
+        dips = [r for r in rows if r["Dip"]]
+        if rows:
+            baseline = median([r["Throughput_Gbps"] for r in (rows[1:-1] if len(rows) > 2 else rows)])
+            print(f"\nIntervals: {len(rows)} x {args.interval_ms:g} ms, median {baseline:.3f} Gbps, "
+                  f"{len(dips)} dips below {args.dip_threshold:g}x")
+            for r in dips:
+                print(f"  dip at {r['Interval_ms']:.1f} ms: {r['Throughput_Gbps']:.3f} Gbps, "
+                      f"{r['Calls']} calls, max call {r['Max_us']:.1f} us, {r['Errors']} errors")
+        all_ops.extend(ops)
+        all_rows.extend(rows)
+
+    if args.top > 0 and all_ops:
+        print(f"\nLongest {args.top} calls:")
+        for op in sorted(all_ops, key=lambda o: o["start_ns"] - o["end_ns"])[:args.top]:
+            print(f"  {op['role']} ring {op['ring']} thread {op['thread']}: {op['op']} at "
+                  f"{op['start_ns'] / 1e6:.3f} ms took {(op['end_ns'] - op['start_ns']) / 1000:.1f} us "
+                  f"({op['bytes']} bytes{', errno ' + str(op['errno']) if op['errno'] else ''})")
+
+    if args.csv and all_rows:
+        with open(args.csv, "w", newline="") as f:
+            writer = csv.DictWriter(f, fieldnames=list(all_rows[0].keys()))
+            writer.writeheader()
+            writer.writerows(all_rows)
+        print(f"\nInterval statistics written to {args.csv}")
+
+    if args.timeline:
+        with open(args.timeline, "w", newline="") as f:
+            writer = csv.writer(f)
+            writer.writerow(["Role", "Ring", "Connection", "Thread", "Op", "Path", "Start_us",
+                             "Duration_us", "Bytes", "Errno"])
+            for op in sorted(all_ops, key=lambda o: o["start_ns"]):
+                writer.writerow([op["role"], op["ring"], op["conn"], op["thread"], op["op"],
+                                 op["path"], round(op["start_ns"] / 1000.0, 3),
+                                 round((op["end_ns"] - op["start_ns"]) / 1000.0, 3),
+                                 op["bytes"], op["errno"]])
+        print(f"Timeline written to {args.timeline}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())